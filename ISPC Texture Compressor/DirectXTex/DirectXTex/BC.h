@@ -322,4 +322,8 @@ void D3DXEncodeBC6HU(_Out_writes_(16) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BL
 void D3DXEncodeBC6HS(_Out_writes_(16) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor, _In_ DWORD flags);
 void D3DXEncodeBC7(_Out_writes_(16) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor, _In_ DWORD flags);
 
+void D3DXEncodeBC7Seeded(_Out_writes_(16) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor, _In_reads_(2) const XMVECTOR *pEndpoints);
+    // Mode 6 only, also trying known endpoints (e.g. those of a BC1-3 block being transcoded) as the starting point;
+    // keeps the lower-error result, so it is never worse than D3DXEncodeBC7 with BC_FLAGS_FORCE_BC7_MODE6
+
 } // namespace
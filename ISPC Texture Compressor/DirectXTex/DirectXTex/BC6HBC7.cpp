@@ -765,6 +765,7 @@ namespace
     public:
         void Decode(_Out_writes_(NUM_PIXELS_PER_BLOCK) HDRColorA* pOut) const;
         void Encode(DWORD flags, _In_reads_(NUM_PIXELS_PER_BLOCK) const HDRColorA* const pIn);
+        void EncodeSeeded(_In_reads_(NUM_PIXELS_PER_BLOCK) const HDRColorA* const pIn, _In_reads_(2) const HDRColorA* pEndpoints);
 
     private:
         struct ModeInfo
@@ -2835,6 +2836,44 @@ void D3DX_BC7::Encode(DWORD flags, const HDRColorA* const pIn)
     *this = final;
 }
 
+// Mode 6 only; refines both the usual starting endpoints and the given ones and keeps whichever
+// has the lower error, so the block is never worse than the mode 6 only (BC_FLAGS_FORCE_BC7_MODE6) encode
+_Use_decl_annotations_
+void D3DX_BC7::EncodeSeeded(const HDRColorA* const pIn, const HDRColorA* pEndpoints)
+{
+    assert(pIn && pEndpoints);
+
+    EncodeParams EP(pIn);
+
+    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+    {
+        EP.aLDRPixels[i].r = uint8_t(std::max<float>(0.0f, std::min<float>(255.0f, pIn[i].r * 255.0f + 0.01f)));
+        EP.aLDRPixels[i].g = uint8_t(std::max<float>(0.0f, std::min<float>(255.0f, pIn[i].g * 255.0f + 0.01f)));
+        EP.aLDRPixels[i].b = uint8_t(std::max<float>(0.0f, std::min<float>(255.0f, pIn[i].b * 255.0f + 0.01f)));
+        EP.aLDRPixels[i].a = uint8_t(std::max<float>(0.0f, std::min<float>(255.0f, pIn[i].a * 255.0f + 0.01f)));
+    }
+
+    EP.uMode = 6;
+
+    RoughMSE(&EP, 0, 0);
+    const float fMSEQuick = Refine(&EP, 0, 0, 0);
+    const D3DX_BC7 quick = *this;
+
+    HDRColorA epA = pEndpoints[0];
+    HDRColorA epB = pEndpoints[1];
+    epA.Clamp(0.0f, 1.0f);
+    epB.Clamp(0.0f, 1.0f);
+    epA *= 255.0f;
+    epB *= 255.0f;
+    EP.aEndPts[0][0].A = epA.ToLDRColorA();
+    EP.aEndPts[0][0].B = epB.ToLDRColorA();
+
+    if (Refine(&EP, 0, 0, 0) >= fMSEQuick)
+    {
+        *this = quick;
+    }
+}
+
 
 //-------------------------------------------------------------------------------------
 _Use_decl_annotations_
@@ -3564,3 +3603,10 @@ void DirectX::D3DXEncodeBC7(uint8_t *pBC, const XMVECTOR *pColor, DWORD flags)
     static_assert(sizeof(D3DX_BC7) == 16, "D3DX_BC7 should be 16 bytes");
     reinterpret_cast<D3DX_BC7*>(pBC)->Encode(flags, reinterpret_cast<const HDRColorA*>(pColor));
 }
+
+_Use_decl_annotations_
+void DirectX::D3DXEncodeBC7Seeded(uint8_t *pBC, const XMVECTOR *pColor, const XMVECTOR *pEndpoints)
+{
+    assert(pBC && pColor && pEndpoints);
+    reinterpret_cast<D3DX_BC7*>(pBC)->EncodeSeeded(reinterpret_cast<const HDRColorA*>(pColor), reinterpret_cast<const HDRColorA*>(pEndpoints));
+}
@@ -15,6 +15,7 @@
 
 #include <algorithm>
 #include <functional>
+#include <string>
 #include <vector>
 
 #if !defined(__d3d11_h__) && !defined(__d3d11_x_h__) && !defined(__d3d12_h__) && !defined(__d3d12_x_h__)
@@ -65,6 +66,7 @@ namespace DirectX
         CP_FLAGS_YMM                = 0x4,      // Assume pitch is 32-byte aligned instead of BYTE aligned
         CP_FLAGS_ZMM                = 0x8,      // Assume pitch is 64-byte aligned instead of BYTE aligned
         CP_FLAGS_PAGE4K             = 0x200,    // Assume pitch is 4096-byte aligned instead of BYTE aligned
+        CP_FLAGS_PAD_CRITICAL_STRIDE = 0x400,   // Pitch is 64-byte aligned and padded to avoid cache-aliasing strides
         CP_FLAGS_BAD_DXTN_TAILS     = 0x1000,   // BC formats with malformed mipchain blocks smaller than 4x4
         CP_FLAGS_24BPP              = 0x10000,  // Override with a legacy 24 bits-per-pixel format size
         CP_FLAGS_16BPP              = 0x20000,  // Override with a legacy 16 bits-per-pixel format size
@@ -165,6 +167,11 @@ namespace DirectX
         DDS_FLAGS_BAD_DXTN_TAILS        = 0x40,
             // Some older DXTn DDS files incorrectly handle mipchain tails for blocks smaller than 4x4
 
+        DDS_FLAGS_MEMORY_MAPPED         = 0x80,
+            // LoadFromDDSFile maps the file copy-on-write and points the images into the view rather than reading it,
+            // when the payload needs no conversion (otherwise it is read as usual); pixels may only be 4-byte aligned.
+            // Desktop only; elsewhere the flag is ignored and the file is read
+
         DDS_FLAGS_FORCE_DX10_EXT        = 0x10000,
             // Always use the 'DX10' header extension for DDS writer (i.e. don't try to write DX9 compatible DDS files)
 
@@ -172,6 +179,14 @@ namespace DirectX
             // DDS_FLAGS_FORCE_DX10_EXT including miscFlags2 information (result may not be compatible with D3DX10 or D3DX11)
     };
 
+    enum TGA_FLAGS
+    {
+        TGA_FLAGS_NONE                  = 0x0,
+
+        TGA_FLAGS_RLE                   = 0x1,
+            // Writes run-length encoded (RLE) pixel data rather than uncompressed scanlines
+    };
+
     enum WIC_FLAGS
     {
         WIC_FLAGS_NONE                  = 0x0,
@@ -242,6 +257,96 @@ namespace DirectX
         _Out_ TexMetadata& metadata,
         _In_opt_ std::function<void __cdecl(IWICMetadataQueryReader*)> getMQR = nullptr);
 
+    //---------------------------------------------------------------------------------
+    // Allocator for ScratchImage and Blob memory. Blocks must be at least 64-byte aligned;
+    // Free is passed the size given to Allocate. An allocator must outlive every ScratchImage
+    // and Blob initialized while it was installed, as they return their memory to it
+    class IImageAllocator
+    {
+    public:
+        virtual ~IImageAllocator() = default;
+
+        virtual void* __cdecl Allocate(_In_ size_t size) = 0;
+        virtual void __cdecl Free(_In_opt_ void* ptr, _In_ size_t size) = 0;
+    };
+
+    IImageAllocator* __cdecl SetImageAllocator(_In_opt_ IImageAllocator* allocator);
+        // Installs the allocator used by subsequent ScratchImage and Blob initialization and returns the
+        // previous one; nullptr restores the default heap allocator
+
+    IImageAllocator* __cdecl GetImageAllocator();
+
+    enum IMAGE_POOL_FLAGS
+    {
+        IMAGE_POOL_DEFAULT          = 0,
+
+        IMAGE_POOL_LARGE_PAGES      = 0x1,
+            // Back pooled blocks with large pages where possible (requires SeLockMemoryPrivilege)
+    };
+
+    //---------------------------------------------------------------------------------
+    // Multithreading. Image processing and file loading and saving only split their work across
+    // OpenMP threads once this is enabled; it is off by default. Block compression uses
+    // TEX_COMPRESS_PARALLEL per call instead
+    bool __cdecl SetParallelProcessing(_In_ bool enable);
+        // Returns the previous setting
+
+    bool __cdecl GetParallelProcessing();
+
+    //---------------------------------------------------------------------------------
+    // Working image padding. Resize, Convert, and GenerateMipMaps(3D) lay out their R32G32B32A32 temporaries,
+    // the mip chains they build, and their filter scanlines with CP_FLAGS_PAD_CRITICAL_STRIDE; on by default
+    bool __cdecl SetPadCriticalStride(_In_ bool enable);
+        // Returns the previous setting
+
+    //---------------------------------------------------------------------------------
+    // CPU feature detection
+    bool __cdecl IsF16CSupported();
+        // The CPU and OS support the F16C half-precision conversion instructions, which the half-float
+        // scanline conversions use when present
+
+    //---------------------------------------------------------------------------------
+    // Size-bucketed pool which keeps freed blocks for reuse, so batch processing doesn't return
+    // large buffers to the OS only to fault them back in for the next file
+    class ImagePool : public IImageAllocator
+    {
+    public:
+        struct Stats
+        {
+            size_t  bytesInUse;         // Allocated and not yet freed
+            size_t  bytesCached;        // Freed and held for reuse
+            size_t  highWaterMark;      // Peak of bytesInUse + bytesCached
+            size_t  allocations;
+            size_t  cacheHits;          // Allocations served from the cache
+            size_t  largePageBlocks;    // Blocks currently backed by large pages
+        };
+
+        explicit ImagePool(_In_ size_t maxCachedBytes = 1024u * 1024u * 1024u, _In_ DWORD flags = IMAGE_POOL_DEFAULT);
+        ~ImagePool() override;
+
+        ImagePool(const ImagePool&) = delete;
+        ImagePool& operator=(const ImagePool&) = delete;
+
+        void* __cdecl Allocate(_In_ size_t size) override;
+        void __cdecl Free(_In_opt_ void* ptr, _In_ size_t size) override;
+
+        void __cdecl Trim();
+            // Releases all cached blocks
+
+        Stats __cdecl GetStats() const;
+        void __cdecl ResetHighWaterMark();
+
+    private:
+        std::vector<std::vector<void*>> m_cache;
+        std::vector<void*>              m_largePages;
+        Stats                           m_stats;
+        size_t                          m_maxCached;
+        size_t                          m_largePageMinimum;
+        mutable SRWLOCK                 m_lock;
+
+        void __cdecl ReleaseBlock(_In_ void* ptr);
+    };
+
     //---------------------------------------------------------------------------------
     // Bitmap image container
     struct Image
@@ -258,9 +363,9 @@ namespace DirectX
     {
     public:
         ScratchImage() noexcept
-            : m_nimages(0), m_size(0), m_metadata{}, m_image(nullptr), m_memory(nullptr) {}
+            : m_nimages(0), m_size(0), m_metadata{}, m_image(nullptr), m_memory(nullptr), m_view(nullptr), m_allocator(nullptr) {}
         ScratchImage(ScratchImage&& moveFrom) noexcept
-            : m_nimages(0), m_size(0), m_metadata{}, m_image(nullptr), m_memory(nullptr) { *this = std::move(moveFrom); }
+            : m_nimages(0), m_size(0), m_metadata{}, m_image(nullptr), m_memory(nullptr), m_view(nullptr), m_allocator(nullptr) { *this = std::move(moveFrom); }
         ~ScratchImage() { Release(); }
 
         ScratchImage& __cdecl operator= (ScratchImage&& moveFrom) noexcept;
@@ -280,6 +385,9 @@ namespace DirectX
         HRESULT __cdecl InitializeCubeFromImages(_In_reads_(nImages) const Image* images, _In_ size_t nImages, _In_ DWORD flags = CP_FLAGS_NONE);
         HRESULT __cdecl Initialize3DFromImages(_In_reads_(depth) const Image* images, _In_ size_t depth, _In_ DWORD flags = CP_FLAGS_NONE);
 
+        HRESULT __cdecl InitializeFromMappedFile(_In_ const TexMetadata& mdata, _In_ HANDLE hFile, _In_ size_t offset);
+            // Desktop only; returns HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED) on other platforms
+
         void __cdecl Release();
 
         bool __cdecl OverrideFormat(_In_ DXGI_FORMAT f);
@@ -301,15 +409,50 @@ namespace DirectX
         TexMetadata m_metadata;
         Image*      m_image;
         uint8_t*    m_memory;
+        void*       m_view;
+
+        IImageAllocator* m_allocator;
+    };
+
+    //---------------------------------------------------------------------------------
+    // Non-owning view of a subset of an image array: the Image entries point at the source's
+    // pixels, so taking a view copies nothing. The source must outlive the view
+    class ScratchImageView
+    {
+    public:
+        ScratchImageView() noexcept : m_metadata{} {}
+
+        HRESULT __cdecl Initialize(
+            _In_ const ScratchImage& image,
+            _In_ size_t mipStart = 0, _In_ size_t mipCount = 0,
+            _In_ size_t itemStart = 0, _In_ size_t itemCount = 0);
+        HRESULT __cdecl Initialize(
+            _In_reads_(nimages) const Image* images, _In_ size_t nimages, _In_ const TexMetadata& metadata,
+            _In_ size_t mipStart = 0, _In_ size_t mipCount = 0,
+            _In_ size_t itemStart = 0, _In_ size_t itemCount = 0);
+            // Views mips [mipStart, mipStart + mipCount) of array items (or cube faces) [itemStart, itemStart + itemCount);
+            // a count of 0 means through the last one. Metadata describes the subset (partial cubes become 2D arrays)
+
+        void __cdecl Release();
+
+        const TexMetadata& __cdecl GetMetadata() const { return m_metadata; }
+        const Image* __cdecl GetImage(_In_ size_t mip, _In_ size_t item, _In_ size_t slice) const;
+
+        const Image* __cdecl GetImages() const { return m_images.empty() ? nullptr : m_images.data(); }
+        size_t __cdecl GetImageCount() const { return m_images.size(); }
+
+    private:
+        TexMetadata         m_metadata;
+        std::vector<Image>  m_images;
     };
 
     //---------------------------------------------------------------------------------
-    // Memory blob (allocated buffer pointer is always 16-byte aligned)
+    // Memory blob (allocated buffer pointer is always 64-byte aligned)
     class Blob
     {
     public:
-        Blob() noexcept : m_buffer(nullptr), m_size(0) {}
-        Blob(Blob&& moveFrom) noexcept : m_buffer(nullptr), m_size(0) { *this = std::move(moveFrom); }
+        Blob() noexcept : m_buffer(nullptr), m_size(0), m_allocSize(0), m_allocator(nullptr) {}
+        Blob(Blob&& moveFrom) noexcept : m_buffer(nullptr), m_size(0), m_allocSize(0), m_allocator(nullptr) { *this = std::move(moveFrom); }
         ~Blob() { Release(); }
 
         Blob& __cdecl operator= (Blob&& moveFrom) noexcept;
@@ -329,6 +472,83 @@ namespace DirectX
     private:
         void*   m_buffer;
         size_t  m_size;
+        size_t  m_allocSize;
+
+        IImageAllocator* m_allocator;
+    };
+
+    //---------------------------------------------------------------------------------
+    // Incremental DDS file writer: the header is written from the metadata up front, then
+    // subresources (or bands of their rows) can be written in any order at their final offsets
+    //
+    // WriteImage and WriteRows may be called concurrently from multiple threads as long as the
+    // calls target disjoint rows; Create, Finish, and Release must not overlap any other call
+    class DDSFileWriter
+    {
+    public:
+        DDSFileWriter() noexcept : m_hFile(nullptr), m_metadata{}, m_dataOffset(0) {}
+        ~DDSFileWriter() { Release(); }
+
+        DDSFileWriter(const DDSFileWriter&) = delete;
+        DDSFileWriter& operator=(const DDSFileWriter&) = delete;
+
+        HRESULT __cdecl Create(_In_z_ const wchar_t* szFile, _In_ const TexMetadata& metadata, _In_ DWORD flags = 0);
+
+        HRESULT __cdecl WriteImage(_In_ const Image& image, _In_ size_t mip, _In_ size_t item, _In_ size_t slice);
+        HRESULT __cdecl WriteRows(_In_ const Image& rows, _In_ size_t mip, _In_ size_t item, _In_ size_t slice, _In_ size_t y);
+            // rows holds rows.height pixel rows of the subresource starting at row y (a multiple of 4 for block-compressed formats)
+
+        HRESULT __cdecl Finish();
+            // Closes the file; releasing the writer without calling Finish deletes the file
+
+        void __cdecl Release();
+
+    private:
+        HRESULT __cdecl GetOffset(_In_ size_t mip, _In_ size_t item, _In_ size_t slice, _Out_ uint64_t& offset, _Out_ size_t& rowPitch, _Out_ size_t& height) const;
+
+        HANDLE      m_hFile;
+        TexMetadata m_metadata;
+        size_t      m_dataOffset;
+    };
+
+    //---------------------------------------------------------------------------------
+    // Index of DDS metadata for a directory tree, keyed by root-relative path and
+    // revalidated against file size, last write time, and a hash of the file header
+    class DDSMetadataIndex
+    {
+    public:
+        struct Entry
+        {
+            std::wstring    path;
+            uint64_t        fileSize;
+            uint64_t        lastWriteTime;
+            uint64_t        headerHash;
+            HRESULT         result;
+            TexMetadata     metadata;
+        };
+
+        DDSMetadataIndex() noexcept : m_flags(DDS_FLAGS_NONE) {}
+
+        HRESULT __cdecl Scan(_In_z_ const wchar_t* szRoot, _In_ DWORD flags = DDS_FLAGS_NONE);
+            // Enumerates the *.dds files under szRoot; files whose size and write time are unchanged keep their
+            // entry without being opened, and the rest have their headers read (in parallel when
+            // SetParallelProcessing is enabled). Fails without changing the index if szRoot can't be listed;
+            // a subdirectory that can't be listed keeps its previous entries
+
+        HRESULT __cdecl Load(_In_z_ const wchar_t* szIndexFile);
+        HRESULT __cdecl Save(_In_z_ const wchar_t* szIndexFile) const;
+
+        const Entry* __cdecl Find(_In_z_ const wchar_t* szPath) const;
+            // szPath is relative to the scanned root; returns nullptr if not present
+
+        size_t __cdecl GetEntryCount() const { return m_entries.size(); }
+        const Entry* __cdecl GetEntries() const { return m_entries.data(); }
+
+        void __cdecl Clear() { m_entries.clear(); m_flags = DDS_FLAGS_NONE; }
+
+    private:
+        std::vector<Entry>  m_entries;
+        DWORD               m_flags;
     };
 
     //---------------------------------------------------------------------------------
@@ -343,6 +563,14 @@ namespace DirectX
         _In_z_ const wchar_t* szFile,
         _In_ DWORD flags,
         _Out_opt_ TexMetadata* metadata, _Out_ ScratchImage& image);
+    HRESULT __cdecl LoadFromDDSFile(
+        _In_z_ const wchar_t* szFile,
+        _In_ DWORD flags,
+        _In_ size_t mipStart, _In_ size_t mipCount,
+        _In_ size_t itemStart, _In_ size_t itemCount,
+        _Out_opt_ TexMetadata* metadata, _Out_ ScratchImage& image);
+        // Loads only mips [mipStart, mipStart + mipCount) of array items (or cube faces) [itemStart, itemStart + itemCount);
+        // a count of 0 means through the last one. Metadata describes the subset (partial cubes become 2D arrays)
 
     HRESULT __cdecl SaveToDDSMemory(
         _In_ const Image& image,
@@ -378,7 +606,9 @@ namespace DirectX
         _Out_opt_ TexMetadata* metadata, _Out_ ScratchImage& image);
 
     HRESULT __cdecl SaveToTGAMemory(_In_ const Image& image, _Out_ Blob& blob);
+    HRESULT __cdecl SaveToTGAMemory(_In_ const Image& image, _In_ DWORD flags, _Out_ Blob& blob);
     HRESULT __cdecl SaveToTGAFile(_In_ const Image& image, _In_z_ const wchar_t* szFile);
+    HRESULT __cdecl SaveToTGAFile(_In_ const Image& image, _In_ DWORD flags, _In_z_ const wchar_t* szFile);
 
     // WIC operations
     HRESULT __cdecl LoadFromWICMemory(
@@ -459,7 +689,8 @@ namespace DirectX
         TEX_FILTER_DITHER           = 0x10000,
             // Use ordered 4x4 dithering for any required conversions
         TEX_FILTER_DITHER_DIFFUSION = 0x20000,
-            // Use error-diffusion dithering for any required conversions
+            // Use error-diffusion dithering for any required conversions (Convert diffuses every scanline left to
+            // right so that scanlines can be processed in parallel)
 
         TEX_FILTER_POINT            = 0x100000,
         TEX_FILTER_LINEAR           = 0x200000,
@@ -490,9 +721,17 @@ namespace DirectX
     HRESULT __cdecl Resize(
         _In_reads_(nimages) const Image* srcImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
         _In_ size_t width, _In_ size_t height, _In_ DWORD filter, _Out_ ScratchImage& result);
+    HRESULT __cdecl Resize(
+        _In_ const ScratchImageView& srcView,
+        _In_ size_t width, _In_ size_t height, _In_ DWORD filter, _Out_ ScratchImage& result);
         // Resize the image to width x height. Defaults to Fant filtering.
         // Note for a complex resize, the result will always have mipLevels == 1
 
+    size_t __cdecl SetTriangleFilterMemory(_In_ size_t maxBytes);
+        // Caps the temporary memory TEX_FILTER_TRIANGLE uses in Resize, GenerateMipMaps, and GenerateMipMaps3D
+        // (shared by all of its threads); larger images are filtered in smaller row bands. 0 restores the 64 MB
+        // default. Returns the previous cap
+
     const float TEX_THRESHOLD_DEFAULT = 0.5f;
         // Default value for alpha threshold used when converting to 1-bit alpha
 
@@ -502,6 +741,9 @@ namespace DirectX
     HRESULT __cdecl Convert(
         _In_reads_(nimages) const Image* srcImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
         _In_ DXGI_FORMAT format, _In_ DWORD filter, _In_ float threshold, _Out_ ScratchImage& result);
+    HRESULT __cdecl Convert(
+        _In_ const ScratchImageView& srcView,
+        _In_ DXGI_FORMAT format, _In_ DWORD filter, _In_ float threshold, _Out_ ScratchImage& result);
         // Convert the image to a new format
 
     HRESULT __cdecl ConvertToSinglePlane(_In_ const Image& srcImage, _Out_ ScratchImage& image);
@@ -516,15 +758,34 @@ namespace DirectX
     HRESULT __cdecl GenerateMipMaps(
         _In_reads_(nimages) const Image* srcImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
         _In_ DWORD filter, _In_ size_t levels, _Inout_ ScratchImage& mipChain);
+    HRESULT __cdecl GenerateMipMaps(
+        _In_ const ScratchImageView& srcView,
+        _In_ DWORD filter, _In_ size_t levels, _Inout_ ScratchImage& mipChain);
         // levels of '0' indicates a full mipchain, otherwise is generates that number of total levels (including the source base image)
         // Defaults to Fant filtering which is equivalent to a box filter
 
+    HRESULT __cdecl GenerateMipMapsCompressed(
+        _In_ const Image& baseImage, _In_ DWORD filter, _In_ size_t levels,
+        _In_ DXGI_FORMAT format, _In_ DWORD compress, _In_ float threshold,
+        _Out_ ScratchImage& cChain, _In_ bool allow1D = false);
+    HRESULT __cdecl GenerateMipMapsCompressed(
+        _In_reads_(nimages) const Image* srcImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
+        _In_ DWORD filter, _In_ size_t levels,
+        _In_ DXGI_FORMAT format, _In_ DWORD compress, _In_ float threshold, _Out_ ScratchImage& cChain);
+        // Generates the mipchain with the custom filters and block compresses each level once it is written,
+        // keeping the uncompressed chain of only one array item at a time (see Compress for the compress flags).
+        // Volume textures use the GenerateMipMaps3D filters. With parallel processing enabled, each level is
+        // compressed on a worker thread while the next level is being generated
+
     HRESULT __cdecl GenerateMipMaps3D(
         _In_reads_(depth) const Image* baseImages, _In_ size_t depth, _In_ DWORD filter, _In_ size_t levels,
         _Out_ ScratchImage& mipChain);
     HRESULT __cdecl GenerateMipMaps3D(
         _In_reads_(nimages) const Image* srcImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
         _In_ DWORD filter, _In_ size_t levels, _Out_ ScratchImage& mipChain);
+    HRESULT __cdecl GenerateMipMaps3D(
+        _In_ const ScratchImageView& srcView,
+        _In_ DWORD filter, _In_ size_t levels, _Out_ ScratchImage& mipChain);
         // levels of '0' indicates a full mipchain, otherwise is generates that number of total levels (including the source base image)
         // Defaults to Fant filtering which is equivalent to a box filter
 
@@ -589,6 +850,9 @@ namespace DirectX
     HRESULT __cdecl Compress(
         _In_reads_(nimages) const Image* srcImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
         _In_ DXGI_FORMAT format, _In_ DWORD compress, _In_ float threshold, _Out_ ScratchImage& cImages);
+    HRESULT __cdecl Compress(
+        _In_ const ScratchImageView& srcView,
+        _In_ DXGI_FORMAT format, _In_ DWORD compress, _In_ float threshold, _Out_ ScratchImage& cImages);
         // Note that threshold is only used by BC1. TEX_THRESHOLD_DEFAULT is a typical value to use
 
 #if defined(__d3d11_h__) || defined(__d3d11_x_h__)
@@ -601,11 +865,55 @@ namespace DirectX
         // DirectCompute-based compression (alphaWeight is only used by BC7. 1.0 is the typical value to use)
 #endif
 
+    enum TEX_PIPELINE_FLAGS
+    {
+        TEX_PIPELINE_DEFAULT                = 0,
+
+        TEX_PIPELINE_FLIP_HORIZONTAL        = 0x08,
+        TEX_PIPELINE_FLIP_VERTICAL          = 0x10,
+            // Flip the source image as it is read (matches TEX_FR_FLIP_*)
+
+        TEX_PIPELINE_PMALPHA                = 0x100,
+            // Converts to premultiplied alpha before compression (equivalent to PremultiplyAlpha followed by Compress,
+            // with TEX_COMPRESS_SRGB_IN/OUT applied to the premultiply as TEX_PMALPHA_SRGB_IN/OUT). The premultiplied
+            // pixels are rounded to the source format, as PremultiplyAlpha stores them, so the blocks match
+
+        TEX_PIPELINE_PMALPHA_IGNORE_SRGB    = 0x200,
+            // Premultiplies without sRGB colorspace conversions (see TEX_PMALPHA_IGNORE_SRGB)
+    };
+
+    HRESULT __cdecl CompressPipeline(
+        _In_ const Image& srcImage, _In_ DWORD pipeline,
+        _In_opt_ std::function<void __cdecl(_Inout_updates_(width) XMVECTOR* pixels, size_t width, size_t y)> pixelFunc,
+        _In_ DXGI_FORMAT format, _In_ DWORD compress, _In_ float threshold,
+        _Out_ ScratchImage& cImage);
+    HRESULT __cdecl CompressPipeline(
+        _In_reads_(nimages) const Image* srcImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
+        _In_ DWORD pipeline,
+        _In_opt_ std::function<void __cdecl(_Inout_updates_(width) XMVECTOR* pixels, size_t width, size_t y)> pixelFunc,
+        _In_ DXGI_FORMAT format, _In_ DWORD compress, _In_ float threshold,
+        _Out_ ScratchImage& cImages);
+        // Flip, per-scanline transform, premultiplied alpha, and block compression fused into one pass over
+        // 4-row bands of the source so no intermediate full-size images are created. pixelFunc is called with
+        // the destination y and may run on several threads at once when TEX_COMPRESS_PARALLEL is used.
+
     HRESULT __cdecl Decompress(_In_ const Image& cImage, _In_ DXGI_FORMAT format, _Out_ ScratchImage& image);
     HRESULT __cdecl Decompress(
         _In_reads_(nimages) const Image* cImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
         _In_ DXGI_FORMAT format, _Out_ ScratchImage& images);
 
+    HRESULT __cdecl Transcode(
+        _In_ const Image& cImage, _In_ DXGI_FORMAT format, _In_ DWORD compress, _In_ float threshold,
+        _Out_ ScratchImage& image);
+    HRESULT __cdecl Transcode(
+        _In_reads_(nimages) const Image* cImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
+        _In_ DXGI_FORMAT format, _In_ DWORD compress, _In_ float threshold, _Out_ ScratchImage& images);
+        // Converts between BC formats one block at a time without a full-size decompressed image.
+        // Blocks whose layout is shared by both formats (BC1/BC2/BC3 color, BC2/BC3 alpha) keep their
+        // endpoints and indices. With TEX_COMPRESS_BC7_QUICK, opaque BC1/BC2/BC3 blocks going to BC7 also try
+        // the source color endpoints as the mode 6 starting point and keep the lower-error block. The rest,
+        // including all BC6H targets, are decoded and encoded again (see TEX_COMPRESS_FLAGS)
+
     //---------------------------------------------------------------------------------
     // Normal map operations
 
@@ -678,6 +986,14 @@ namespace DirectX
     };
 
     HRESULT __cdecl ComputeMSE(_In_ const Image& image1, _In_ const Image& image2, _Out_ float& mse, _Out_writes_opt_(4) float* mseV, _In_ DWORD flags = 0);
+    HRESULT __cdecl ComputeMSE(
+        _In_ const Image& image1, _In_ const Image& image2, _Out_ float& mse, _Out_writes_opt_(4) float* mseV,
+        _Out_writes_opt_(((image1.width + 3) / 4) * ((image1.height + 3) / 4)) float* blockMSE, _In_ DWORD flags);
+        // blockMSE receives the MSE of each 4x4 block (summed over channels) in row-major order
+    HRESULT __cdecl ComputeMSE(
+        _In_reads_(nimages) const Image* images1, _In_reads_(nimages) const Image* images2, _In_ size_t nimages,
+        _Out_ float& mse, _Out_writes_opt_(4) float* mseV, _Out_writes_opt_(nimages) float* imageMSE, _In_ DWORD flags = 0);
+        // Compares matching mips/slices in one call; imageMSE receives the MSE of each image, mse covers all pixels
 
     HRESULT __cdecl EvaluateImage(
         _In_ const Image& image,
@@ -122,3 +122,37 @@ inline HRESULT __cdecl SaveToDDSFile(const Image& image, DWORD flags, const wcha
 
     return SaveToDDSFile(&image, 1, mdata, flags, szFile);
 }
+
+
+//=====================================================================================
+// Image processing on views
+//=====================================================================================
+_Use_decl_annotations_
+inline HRESULT __cdecl Resize(const ScratchImageView& srcView, size_t width, size_t height, DWORD filter, ScratchImage& result)
+{
+    return Resize(srcView.GetImages(), srcView.GetImageCount(), srcView.GetMetadata(), width, height, filter, result);
+}
+
+_Use_decl_annotations_
+inline HRESULT __cdecl Convert(const ScratchImageView& srcView, DXGI_FORMAT format, DWORD filter, float threshold, ScratchImage& result)
+{
+    return Convert(srcView.GetImages(), srcView.GetImageCount(), srcView.GetMetadata(), format, filter, threshold, result);
+}
+
+_Use_decl_annotations_
+inline HRESULT __cdecl GenerateMipMaps(const ScratchImageView& srcView, DWORD filter, size_t levels, ScratchImage& mipChain)
+{
+    return GenerateMipMaps(srcView.GetImages(), srcView.GetImageCount(), srcView.GetMetadata(), filter, levels, mipChain);
+}
+
+_Use_decl_annotations_
+inline HRESULT __cdecl GenerateMipMaps3D(const ScratchImageView& srcView, DWORD filter, size_t levels, ScratchImage& mipChain)
+{
+    return GenerateMipMaps3D(srcView.GetImages(), srcView.GetImageCount(), srcView.GetMetadata(), filter, levels, mipChain);
+}
+
+_Use_decl_annotations_
+inline HRESULT __cdecl Compress(const ScratchImageView& srcView, DXGI_FORMAT format, DWORD compress, float threshold, ScratchImage& cImages)
+{
+    return Compress(srcView.GetImages(), srcView.GetImageCount(), srcView.GetMetadata(), format, compress, threshold, cImages);
+}
@@ -328,6 +328,237 @@ namespace
 #endif // _OPENMP
 
 
+    //-------------------------------------------------------------------------------------
+    // Fused compression pipeline
+    //-------------------------------------------------------------------------------------
+    typedef std::function<void __cdecl(XMVECTOR* pixels, size_t width, size_t y)> PipelinePixelFunc;
+
+    // sRGB conversions applied around the premultiply, matching PremultiplyAlpha's use of
+    // _LoadScanlineLinear / _StoreScanlineLinear on the source format
+    inline DWORD GetPipelinePMAlphaFlags(_In_ DXGI_FORMAT format, _In_ DWORD pipeline, _In_ DWORD srgb)
+    {
+        return (pipeline & TEX_PIPELINE_PMALPHA_IGNORE_SRGB) ? 0 : _GetScanlineLinearFlags(format, srgb);
+    }
+
+    // Size of the per-thread band buffer: 4 scanlines, plus one source-format row for requantizing
+    // premultiplied pixels
+    inline size_t GetPipelineBandSize(const Image& image, DWORD pipeline)
+    {
+        size_t bytes = sizeof(XMVECTOR) * image.width * 4;
+        if (pipeline & TEX_PIPELINE_PMALPHA)
+            bytes += image.rowPitch;
+        return bytes;
+    }
+
+    // Loads up to 4 scanlines of the (flipped) source into the band and applies the per-scanline stages
+    bool LoadPipelineBand(
+        const Image& image,
+        size_t y,
+        _Out_writes_(image.width * 4) XMVECTOR* band,
+        DWORD pipeline,
+        DWORD pmFlags,
+        const PipelinePixelFunc& pixelFunc)
+    {
+        const size_t ph = std::min<size_t>(4, image.height - y);
+        for (size_t t = 0; t < ph; ++t)
+        {
+            const size_t sy = (pipeline & TEX_PIPELINE_FLIP_VERTICAL) ? (image.height - 1 - y - t) : (y + t);
+
+            XMVECTOR* row = band + t * image.width;
+            if (!_LoadScanline(row, image.width, image.pixels + sy * image.rowPitch, image.rowPitch, image.format))
+                return false;
+
+            if (pipeline & TEX_PIPELINE_FLIP_HORIZONTAL)
+            {
+                std::reverse(row, row + image.width);
+            }
+
+            if (pixelFunc)
+            {
+                pixelFunc(row, image.width, y + t);
+            }
+
+            if (pipeline & TEX_PIPELINE_PMALPHA)
+            {
+                XMVECTOR* ptr = row;
+                for (size_t w = 0; w < image.width; ++w, ++ptr)
+                {
+                    XMVECTOR v = (pmFlags & TEX_FILTER_SRGB_IN) ? XMColorSRGBToRGB(*ptr) : *ptr;
+                    XMVECTOR alpha = XMVectorSplatW(v);
+                    alpha = XMVectorMultiply(v, alpha);
+                    v = XMVectorSelect(v, alpha, g_XMSelect1110);
+                    *ptr = (pmFlags & TEX_FILTER_SRGB_OUT) ? XMColorRGBToSRGB(v) : v;
+                }
+
+                // PremultiplyAlpha writes its result back in the source format before Compress reads it,
+                // so round-trip through that format to produce the same blocks
+                auto requant = reinterpret_cast<uint8_t*>(band + image.width * 4);
+                if (!_StoreScanline(requant, image.rowPitch, image.format, row, image.width)
+                    || !_LoadScanline(row, image.width, requant, image.rowPitch, image.format))
+                    return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Block compresses one band (same edge replication as CompressBC)
+    void CompressPipelineBand(
+        const Image& image,
+        size_t y,
+        _In_reads_(image.width * 4) const XMVECTOR* band,
+        _Out_ uint8_t* pDest,
+        DXGI_FORMAT format,
+        BC_ENCODE pfEncode,
+        size_t blocksize,
+        DWORD cflags,
+        DWORD bcflags,
+        DWORD srgb,
+        float threshold)
+    {
+        static const size_t uSrc[] = { 0, 0, 0, 1 };
+
+        const size_t ph = std::min<size_t>(4, image.height - y);
+
+        __declspec(align(16)) XMVECTOR temp[16];
+        for (size_t x = 0; x < image.width; x += 4)
+        {
+            const size_t pw = std::min<size_t>(4, image.width - x);
+            assert(pw > 0 && ph > 0);
+
+            for (size_t t = 0; t < ph; ++t)
+            {
+                const XMVECTOR* row = band + t * image.width + x;
+                for (size_t s = 0; s < pw; ++s)
+                {
+                    temp[(t << 2) | s] = row[s];
+                }
+            }
+
+            if (pw < 4)
+            {
+                for (size_t t = 0; t < ph; ++t)
+                {
+                    for (size_t s = pw; s < 4; ++s)
+                    {
+                        temp[(t << 2) | s] = temp[(t << 2) | uSrc[s]];
+                    }
+                }
+            }
+
+            if (ph < 4)
+            {
+                for (size_t t = ph; t < 4; ++t)
+                {
+                    for (size_t s = 0; s < 4; ++s)
+                    {
+                        temp[(t << 2) | s] = temp[(uSrc[t] << 2) | s];
+                    }
+                }
+            }
+
+            _ConvertScanline(temp, 16, format, image.format, cflags | srgb);
+
+            if (pfEncode)
+                pfEncode(pDest, temp, bcflags);
+            else
+                D3DXEncodeBC1(pDest, temp, threshold, bcflags);
+
+            pDest += blocksize;
+        }
+    }
+
+    HRESULT CompressPipelineBC(
+        const Image& image,
+        const Image& result,
+        DWORD pipeline,
+        const PipelinePixelFunc& pixelFunc,
+        DWORD compress,
+        float threshold)
+    {
+        if (!image.pixels || !result.pixels)
+            return E_POINTER;
+
+        assert(image.width == result.width);
+        assert(image.height == result.height);
+
+        const size_t sbpp = BitsPerPixel(image.format);
+        if (!sbpp)
+            return E_FAIL;
+
+        if (sbpp < 8)
+        {
+            // We don't support compressing from monochrome (DXGI_FORMAT_R1_UNORM)
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+        }
+
+        BC_ENCODE pfEncode;
+        size_t blocksize;
+        DWORD cflags;
+        if (!DetermineEncoderSettings(result.format, pfEncode, blocksize, cflags))
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+        const DWORD bcflags = GetBCFlags(compress);
+        const DWORD srgb = GetSRGBFlags(compress);
+        const DWORD pmFlags = GetPipelinePMAlphaFlags(image.format, pipeline, srgb);
+
+        const size_t nbands = (image.height + 3) / 4;
+
+#ifdef _OPENMP
+        if (compress & TEX_COMPRESS_PARALLEL)
+        {
+            bool fail = false;
+
+#pragma omp parallel
+            {
+                // Each thread keeps one band of scanlines in cache while it is being compressed
+                ScopedAlignedArrayXMVECTOR band(static_cast<XMVECTOR*>(_aligned_malloc(GetPipelineBandSize(image, pipeline), 16)));
+                if (!band)
+                    fail = true;
+
+#pragma omp for
+                for (int nb = 0; nb < static_cast<int>(nbands); ++nb)
+                {
+                    if (!band)
+                        continue;
+
+                    const size_t y = size_t(nb) * 4;
+                    if (!LoadPipelineBand(image, y, band.get(), pipeline, pmFlags, pixelFunc))
+                    {
+                        fail = true;
+                        continue;
+                    }
+
+                    CompressPipelineBand(image, y, band.get(), result.pixels + size_t(nb) * result.rowPitch,
+                        result.format, pfEncode, blocksize, cflags, bcflags, srgb, threshold);
+                }
+            }
+
+            return (fail) ? E_FAIL : S_OK;
+        }
+#endif // _OPENMP
+
+        ScopedAlignedArrayXMVECTOR band(static_cast<XMVECTOR*>(_aligned_malloc(GetPipelineBandSize(image, pipeline), 16)));
+        if (!band)
+            return E_OUTOFMEMORY;
+
+        uint8_t* pDest = result.pixels;
+        for (size_t nb = 0; nb < nbands; ++nb)
+        {
+            const size_t y = nb * 4;
+            if (!LoadPipelineBand(image, y, band.get(), pipeline, pmFlags, pixelFunc))
+                return E_FAIL;
+
+            CompressPipelineBand(image, y, band.get(), pDest,
+                result.format, pfEncode, blocksize, cflags, bcflags, srgb, threshold);
+
+            pDest += result.rowPitch;
+        }
+
+        return S_OK;
+    }
+
+
     //-------------------------------------------------------------------------------------
     DXGI_FORMAT DefaultDecompress(_In_ DXGI_FORMAT format)
     {
@@ -454,45 +685,397 @@ namespace
                 pfDecode(temp, sptr);
                 _ConvertScanline(temp, 16, format, cformat, 0);
 
-                size_t pw = std::min<size_t>(4, cImage.width - w);
-                assert(pw > 0 && ph > 0);
+                size_t pw = std::min<size_t>(4, cImage.width - w);
+                assert(pw > 0 && ph > 0);
+
+                if (!_StoreScanline(dptr, rowPitch, format, &temp[0], pw))
+                    return E_FAIL;
+
+                if (ph > 1)
+                {
+                    if (!_StoreScanline(dptr + rowPitch, rowPitch, format, &temp[4], pw))
+                        return E_FAIL;
+
+                    if (ph > 2)
+                    {
+                        if (!_StoreScanline(dptr + rowPitch * 2, rowPitch, format, &temp[8], pw))
+                            return E_FAIL;
+
+                        if (ph > 3)
+                        {
+                            if (!_StoreScanline(dptr + rowPitch * 3, rowPitch, format, &temp[12], pw))
+                                return E_FAIL;
+                        }
+                    }
+                }
+
+                sptr += sbpp;
+                dptr += dbpp * 4;
+            }
+
+            pSrc += cImage.rowPitch;
+            pDest += rowPitch * 4;
+        }
+
+        return S_OK;
+    }
+
+    //-------------------------------------------------------------------------------------
+    // BC to BC transcoding
+    //-------------------------------------------------------------------------------------
+    inline bool DetermineDecoderSettings(_In_ DXGI_FORMAT cformat, _Out_ BC_DECODE& pfDecode, _Out_ size_t& sbpp)
+    {
+        switch (cformat)
+        {
+        case DXGI_FORMAT_BC1_UNORM:
+        case DXGI_FORMAT_BC1_UNORM_SRGB:    pfDecode = D3DXDecodeBC1;   sbpp = 8;   break;
+        case DXGI_FORMAT_BC2_UNORM:
+        case DXGI_FORMAT_BC2_UNORM_SRGB:    pfDecode = D3DXDecodeBC2;   sbpp = 16;  break;
+        case DXGI_FORMAT_BC3_UNORM:
+        case DXGI_FORMAT_BC3_UNORM_SRGB:    pfDecode = D3DXDecodeBC3;   sbpp = 16;  break;
+        case DXGI_FORMAT_BC4_UNORM:         pfDecode = D3DXDecodeBC4U;  sbpp = 8;   break;
+        case DXGI_FORMAT_BC4_SNORM:         pfDecode = D3DXDecodeBC4S;  sbpp = 8;   break;
+        case DXGI_FORMAT_BC5_UNORM:         pfDecode = D3DXDecodeBC5U;  sbpp = 16;  break;
+        case DXGI_FORMAT_BC5_SNORM:         pfDecode = D3DXDecodeBC5S;  sbpp = 16;  break;
+        case DXGI_FORMAT_BC6H_UF16:         pfDecode = D3DXDecodeBC6HU; sbpp = 16;  break;
+        case DXGI_FORMAT_BC6H_SF16:         pfDecode = D3DXDecodeBC6HS; sbpp = 16;  break;
+        case DXGI_FORMAT_BC7_UNORM:
+        case DXGI_FORMAT_BC7_UNORM_SRGB:    pfDecode = D3DXDecodeBC7;   sbpp = 16;  break;
+        default:                            pfDecode = nullptr;         sbpp = 0;   return false;
+        }
+
+        return true;
+    }
+
+    // The color part of BC2/BC3 is always decoded as 4 colors, while BC1 uses 3 colors + transparent
+    // when color0 <= color1. Reorder the endpoints so the block decodes the same as BC1.
+    void FourColorToBC1(_Out_ D3DX_BC1* pDest, _In_ const D3DX_BC1* pSrc)
+    {
+        if (pSrc->rgb[0] > pSrc->rgb[1])
+        {
+            *pDest = *pSrc;
+        }
+        else if (pSrc->rgb[0] < pSrc->rgb[1])
+        {
+            // Swapping the endpoints swaps indices 0 <-> 1 and 2 <-> 3
+            pDest->rgb[0] = pSrc->rgb[1];
+            pDest->rgb[1] = pSrc->rgb[0];
+            pDest->bitmap = pSrc->bitmap ^ 0x55555555;
+        }
+        else
+        {
+            // Solid color
+            pDest->rgb[0] = pSrc->rgb[0];
+            pDest->rgb[1] = pSrc->rgb[1];
+            pDest->bitmap = 0;
+        }
+    }
+
+    // Reuses the source endpoints and indices when the source and target formats share the block layout.
+    // Returns false if the block needs to be decoded and encoded again.
+    bool TranscodeBlockDirect(
+        _In_ DXGI_FORMAT sformat,
+        _In_ const uint8_t* pSrc,
+        _In_ DXGI_FORMAT dformat,
+        _Out_ uint8_t* pDest,
+        DWORD bcflags,
+        float threshold)
+    {
+        __declspec(align(16)) XMVECTOR temp[NUM_PIXELS_PER_BLOCK];
+
+        if (sformat == dformat)
+        {
+            memcpy(pDest, pSrc, (sformat == DXGI_FORMAT_BC1_UNORM || sformat == DXGI_FORMAT_BC1_UNORM_SRGB
+                || sformat == DXGI_FORMAT_BC4_UNORM || sformat == DXGI_FORMAT_BC4_SNORM) ? 8 : 16);
+            return true;
+        }
+
+        const DXGI_FORMAT sfamily = MakeTypeless(sformat);
+        const DXGI_FORMAT dfamily = MakeTypeless(dformat);
+
+        switch (sfamily)
+        {
+        case DXGI_FORMAT_BC1_TYPELESS:
+        {
+            auto pBC1 = reinterpret_cast<const D3DX_BC1*>(pSrc);
+            if (dfamily == DXGI_FORMAT_BC1_TYPELESS)
+            {
+                *reinterpret_cast<D3DX_BC1*>(pDest) = *pBC1;
+                return true;
+            }
+
+            // 3 color + transparent blocks have no BC2/BC3 equivalent
+            if (pBC1->rgb[0] <= pBC1->rgb[1])
+                return false;
+
+            if (dfamily == DXGI_FORMAT_BC2_TYPELESS)
+            {
+                auto pBC2 = reinterpret_cast<D3DX_BC2*>(pDest);
+                pBC2->bitmap[0] = pBC2->bitmap[1] = 0xFFFFFFFF;
+                pBC2->bc1 = *pBC1;
+                return true;
+            }
+            else if (dfamily == DXGI_FORMAT_BC3_TYPELESS)
+            {
+                auto pBC3 = reinterpret_cast<D3DX_BC3*>(pDest);
+                pBC3->alpha[0] = pBC3->alpha[1] = 0xFF;
+                memset(pBC3->bitmap, 0, sizeof(pBC3->bitmap));
+                pBC3->bc1 = *pBC1;
+                return true;
+            }
+            return false;
+        }
+
+        case DXGI_FORMAT_BC2_TYPELESS:
+        {
+            auto pBC2 = reinterpret_cast<const D3DX_BC2*>(pSrc);
+            if (dfamily == DXGI_FORMAT_BC2_TYPELESS)
+            {
+                *reinterpret_cast<D3DX_BC2*>(pDest) = *pBC2;
+                return true;
+            }
+
+            if (dfamily != DXGI_FORMAT_BC1_TYPELESS && dfamily != DXGI_FORMAT_BC3_TYPELESS)
+                return false;
+
+            for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+            {
+                uint32_t u = (pBC2->bitmap[i >> 3] >> ((i & 7) * 4)) & 0xf;
+                temp[i] = XMVectorReplicate(static_cast<float>(u) * (1.0f / 15.0f));
+            }
+
+            if (dfamily == DXGI_FORMAT_BC1_TYPELESS)
+            {
+                // Alpha below the threshold needs the BC1 transparent color
+                for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+                {
+                    if (XMVectorGetX(temp[i]) < threshold)
+                        return false;
+                }
+
+                FourColorToBC1(reinterpret_cast<D3DX_BC1*>(pDest), &pBC2->bc1);
+                return true;
+            }
+
+            // BC3 alpha uses the same block layout as BC4
+            auto pBC3 = reinterpret_cast<D3DX_BC3*>(pDest);
+            D3DXEncodeBC4U(pDest, temp, bcflags);
+            pBC3->bc1 = pBC2->bc1;
+            return true;
+        }
+
+        case DXGI_FORMAT_BC3_TYPELESS:
+        {
+            auto pBC3 = reinterpret_cast<const D3DX_BC3*>(pSrc);
+            if (dfamily == DXGI_FORMAT_BC3_TYPELESS)
+            {
+                *reinterpret_cast<D3DX_BC3*>(pDest) = *pBC3;
+                return true;
+            }
+
+            if (dfamily != DXGI_FORMAT_BC1_TYPELESS && dfamily != DXGI_FORMAT_BC2_TYPELESS)
+                return false;
+
+            if ((dfamily == DXGI_FORMAT_BC2_TYPELESS) && (bcflags & BC_FLAGS_DITHER_A))
+                return false;
+
+            // BC3 alpha uses the same block layout as BC4
+            D3DXDecodeBC4U(temp, pSrc);
+
+            if (dfamily == DXGI_FORMAT_BC1_TYPELESS)
+            {
+                // Alpha below the threshold needs the BC1 transparent color
+                for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+                {
+                    if (XMVectorGetX(temp[i]) < threshold)
+                        return false;
+                }
+
+                FourColorToBC1(reinterpret_cast<D3DX_BC1*>(pDest), &pBC3->bc1);
+                return true;
+            }
+
+            auto pBC2 = reinterpret_cast<D3DX_BC2*>(pDest);
+            pBC2->bitmap[0] = pBC2->bitmap[1] = 0;
+            for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+            {
+                auto u = static_cast<uint32_t>(XMVectorGetX(temp[i]) * 15.0f + 0.5f);
+                pBC2->bitmap[i >> 3] |= (u << ((i & 7) * 4));
+            }
+            pBC2->bc1 = pBC3->bc1;
+            return true;
+        }
+
+        case DXGI_FORMAT_BC7_TYPELESS:
+            if (dfamily == DXGI_FORMAT_BC7_TYPELESS)
+            {
+                memcpy(pDest, pSrc, 16);
+                return true;
+            }
+            return false;
+
+        default:
+            return false;
+        }
+    }
+
+    // Opaque BC1/BC2/BC3 blocks hold colors on a single line, which one BC7 subset represents
+    inline bool IsOpaqueBlock(_In_reads_(NUM_PIXELS_PER_BLOCK) const XMVECTOR* pColor)
+    {
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            if (XMVectorGetW(pColor[i]) < 1.0f)
+                return false;
+        }
+
+        return true;
+    }
+
+    // Color endpoints of a BC1/BC2/BC3 block, used to seed the BC7 encoder
+    void GetColorEndpoints(_In_ DXGI_FORMAT cformat, _In_ const uint8_t* pSrc, _Out_writes_(2) XMVECTOR* pEndpoints)
+    {
+        auto pBC1 = (MakeTypeless(cformat) == DXGI_FORMAT_BC1_TYPELESS)
+            ? reinterpret_cast<const D3DX_BC1*>(pSrc)
+            : reinterpret_cast<const D3DX_BC1*>(pSrc + 8);
+
+        for (size_t j = 0; j < 2; ++j)
+        {
+            const uint16_t w565 = pBC1->rgb[j];
+            pEndpoints[j] = XMVectorSet(
+                static_cast<float>((w565 >> 11) & 31) * (1.0f / 31.0f),
+                static_cast<float>((w565 >> 5) & 63) * (1.0f / 63.0f),
+                static_cast<float>((w565 >> 0) & 31) * (1.0f / 31.0f),
+                1.0f);
+        }
+    }
+
+    HRESULT TranscodeBC(
+        _In_ const Image& cImage,
+        _In_ const Image& result,
+        DWORD bcflags,
+        DWORD srgb,
+        float threshold,
+        bool parallel)
+    {
+        if (!cImage.pixels || !result.pixels)
+            return E_POINTER;
+
+        assert(cImage.width == result.width);
+        assert(cImage.height == result.height);
+
+        // Promote "typeless" BC formats
+        DXGI_FORMAT cformat;
+        switch (cImage.format)
+        {
+        case DXGI_FORMAT_BC1_TYPELESS:  cformat = DXGI_FORMAT_BC1_UNORM; break;
+        case DXGI_FORMAT_BC2_TYPELESS:  cformat = DXGI_FORMAT_BC2_UNORM; break;
+        case DXGI_FORMAT_BC3_TYPELESS:  cformat = DXGI_FORMAT_BC3_UNORM; break;
+        case DXGI_FORMAT_BC4_TYPELESS:  cformat = DXGI_FORMAT_BC4_UNORM; break;
+        case DXGI_FORMAT_BC5_TYPELESS:  cformat = DXGI_FORMAT_BC5_UNORM; break;
+        case DXGI_FORMAT_BC6H_TYPELESS: cformat = DXGI_FORMAT_BC6H_UF16; break;
+        case DXGI_FORMAT_BC7_TYPELESS:  cformat = DXGI_FORMAT_BC7_UNORM; break;
+        default:                        cformat = cImage.format;         break;
+        }
+
+        BC_DECODE pfDecode;
+        size_t sbpp;
+        if (!DetermineDecoderSettings(cformat, pfDecode, sbpp))
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+        BC_ENCODE pfEncode;
+        size_t blocksize;
+        DWORD cflags;
+        if (!DetermineEncoderSettings(result.format, pfEncode, blocksize, cflags))
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+        // Blocks can only be reused as-is when no colorspace conversion is needed
+        const bool srgbIn = IsSRGB(cformat) || (srgb & TEX_FILTER_SRGB_IN);
+        const bool srgbOut = IsSRGB(result.format) || (srgb & TEX_FILTER_SRGB_OUT);
+        const bool direct = (srgbIn == srgbOut);
+
+        // When the caller has limited BC7 to mode 6, opaque BC1-3 blocks also try their source endpoints as
+        // the starting point; the full mode search (and BC_FLAGS_USE_3SUBSETS) is left alone otherwise
+        bool seedBC7 = false;
+        if (pfEncode == D3DXEncodeBC7 && (bcflags & BC_FLAGS_FORCE_BC7_MODE6))
+        {
+            switch (MakeTypeless(cformat))
+            {
+            case DXGI_FORMAT_BC1_TYPELESS:
+            case DXGI_FORMAT_BC2_TYPELESS:
+            case DXGI_FORMAT_BC3_TYPELESS:
+                seedBC7 = true;
+                break;
+
+            default:
+                break;
+            }
+        }
+
+        const size_t nbh = (cImage.height + 3) / 4;
+        const size_t nbw = (cImage.width + 3) / 4;
 
-                if (!_StoreScanline(dptr, rowPitch, format, &temp[0], pw))
-                    return E_FAIL;
+#ifdef _OPENMP
+#pragma omp parallel for if (parallel)
+#else
+        UNREFERENCED_PARAMETER(parallel);
+#endif
+        for (int bh = 0; bh < static_cast<int>(nbh); ++bh)
+        {
+            const uint8_t *sptr = cImage.pixels + size_t(bh) * cImage.rowPitch;
+            uint8_t *dptr = result.pixels + size_t(bh) * result.rowPitch;
 
-                if (ph > 1)
+            __declspec(align(16)) XMVECTOR temp[NUM_PIXELS_PER_BLOCK];
+            for (size_t bw = 0; bw < nbw; ++bw)
+            {
+                if (!direct || !TranscodeBlockDirect(cformat, sptr, result.format, dptr, bcflags, threshold))
                 {
-                    if (!_StoreScanline(dptr + rowPitch, rowPitch, format, &temp[4], pw))
-                        return E_FAIL;
+                    pfDecode(temp, sptr);
 
-                    if (ph > 2)
+                    const bool seed = seedBC7 && IsOpaqueBlock(temp);
+
+                    _ConvertScanline(temp, NUM_PIXELS_PER_BLOCK, result.format, cformat, cflags | srgb);
+
+                    if (seed)
                     {
-                        if (!_StoreScanline(dptr + rowPitch * 2, rowPitch, format, &temp[8], pw))
-                            return E_FAIL;
+                        __declspec(align(16)) XMVECTOR endpoints[2];
+                        GetColorEndpoints(cformat, sptr, endpoints);
+                        _ConvertScanline(endpoints, 2, result.format, cformat, cflags | srgb);
 
-                        if (ph > 3)
-                        {
-                            if (!_StoreScanline(dptr + rowPitch * 3, rowPitch, format, &temp[12], pw))
-                                return E_FAIL;
-                        }
+                        D3DXEncodeBC7Seeded(dptr, temp, endpoints);
                     }
+                    else if (pfEncode)
+                        pfEncode(dptr, temp, bcflags);
+                    else
+                        D3DXEncodeBC1(dptr, temp, threshold, bcflags);
                 }
 
                 sptr += sbpp;
-                dptr += dbpp * 4;
+                dptr += blocksize;
             }
-
-            pSrc += cImage.rowPitch;
-            pDest += rowPitch * 4;
         }
 
         return S_OK;
     }
+
 }
 
 //-------------------------------------------------------------------------------------
 namespace DirectX
 {
+    HRESULT _CompressImage(_In_ const Image& image, _In_ const Image& result, _In_ DWORD compress, _In_ float threshold)
+    {
+        if (compress & TEX_COMPRESS_PARALLEL)
+        {
+#ifndef _OPENMP
+            return E_NOTIMPL;
+#else
+            return CompressBC_Parallel(image, result, GetBCFlags(compress), GetSRGBFlags(compress), threshold);
+#endif // _OPENMP
+        }
+
+        return CompressBC(image, result, GetBCFlags(compress), GetSRGBFlags(compress), threshold);
+    }
+
     bool _IsAlphaAllOpaqueBC(_In_ const Image& cImage)
     {
         if (!cImage.pixels)
@@ -717,6 +1300,140 @@ HRESULT DirectX::Compress(
 }
 
 
+//-------------------------------------------------------------------------------------
+// Fused flip / transform / premultiply / compression
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::CompressPipeline(
+    const Image& srcImage,
+    DWORD pipeline,
+    std::function<void __cdecl(XMVECTOR* pixels, size_t width, size_t y)> pixelFunc,
+    DXGI_FORMAT format,
+    DWORD compress,
+    float threshold,
+    ScratchImage& image)
+{
+    if (IsCompressed(srcImage.format) || !IsCompressed(format))
+        return E_INVALIDARG;
+
+    if (IsTypeless(format)
+        || IsTypeless(srcImage.format) || IsPlanar(srcImage.format) || IsPalettized(srcImage.format))
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+#ifndef _OPENMP
+    if (compress & TEX_COMPRESS_PARALLEL)
+        return E_NOTIMPL;
+#endif
+
+    TexMetadata mdata = {};
+    mdata.width = srcImage.width;
+    mdata.height = srcImage.height;
+    mdata.depth = mdata.arraySize = mdata.mipLevels = 1;
+    mdata.format = format;
+    mdata.dimension = TEX_DIMENSION_TEXTURE2D;
+    if (pipeline & TEX_PIPELINE_PMALPHA)
+    {
+        mdata.SetAlphaMode(TEX_ALPHA_MODE_PREMULTIPLIED);
+    }
+
+    HRESULT hr = image.Initialize(mdata);
+    if (FAILED(hr))
+        return hr;
+
+    const Image *img = image.GetImage(0, 0, 0);
+    if (!img)
+    {
+        image.Release();
+        return E_POINTER;
+    }
+
+    hr = CompressPipelineBC(srcImage, *img, pipeline, pixelFunc, compress, threshold);
+    if (FAILED(hr))
+        image.Release();
+
+    return hr;
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::CompressPipeline(
+    const Image* srcImages,
+    size_t nimages,
+    const TexMetadata& metadata,
+    DWORD pipeline,
+    std::function<void __cdecl(XMVECTOR* pixels, size_t width, size_t y)> pixelFunc,
+    DXGI_FORMAT format,
+    DWORD compress,
+    float threshold,
+    ScratchImage& cImages)
+{
+    if (!srcImages || !nimages)
+        return E_INVALIDARG;
+
+    if (IsCompressed(metadata.format) || !IsCompressed(format))
+        return E_INVALIDARG;
+
+    if (IsTypeless(format)
+        || IsTypeless(metadata.format) || IsPlanar(metadata.format) || IsPalettized(metadata.format))
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+#ifndef _OPENMP
+    if (compress & TEX_COMPRESS_PARALLEL)
+        return E_NOTIMPL;
+#endif
+
+    cImages.Release();
+
+    TexMetadata mdata2 = metadata;
+    mdata2.format = format;
+    if (pipeline & TEX_PIPELINE_PMALPHA)
+    {
+        if (metadata.IsPMAlpha())
+            return E_FAIL;
+
+        mdata2.SetAlphaMode(TEX_ALPHA_MODE_PREMULTIPLIED);
+    }
+
+    HRESULT hr = cImages.Initialize(mdata2);
+    if (FAILED(hr))
+        return hr;
+
+    if (nimages != cImages.GetImageCount())
+    {
+        cImages.Release();
+        return E_FAIL;
+    }
+
+    const Image* dest = cImages.GetImages();
+    if (!dest)
+    {
+        cImages.Release();
+        return E_POINTER;
+    }
+
+    for (size_t index = 0; index < nimages; ++index)
+    {
+        assert(dest[index].format == format);
+
+        const Image& src = srcImages[index];
+
+        if (src.width != dest[index].width || src.height != dest[index].height)
+        {
+            cImages.Release();
+            return E_FAIL;
+        }
+
+        hr = CompressPipelineBC(src, dest[index], pipeline, pixelFunc, compress, threshold);
+        if (FAILED(hr))
+        {
+            cImages.Release();
+            return hr;
+        }
+    }
+
+    return S_OK;
+}
+
+
 //-------------------------------------------------------------------------------------
 // Decompression
 //-------------------------------------------------------------------------------------
@@ -849,3 +1566,119 @@ HRESULT DirectX::Decompress(
 
     return S_OK;
 }
+
+
+//-------------------------------------------------------------------------------------
+// Transcoding between BC formats
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::Transcode(
+    const Image& cImage,
+    DXGI_FORMAT format,
+    DWORD compress,
+    float threshold,
+    ScratchImage& image)
+{
+    if (!IsCompressed(cImage.format) || !IsCompressed(format))
+        return E_INVALIDARG;
+
+    if (IsTypeless(format))
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+#ifndef _OPENMP
+    if (compress & TEX_COMPRESS_PARALLEL)
+        return E_NOTIMPL;
+#endif
+
+    // Create transcoded image
+    HRESULT hr = image.Initialize2D(format, cImage.width, cImage.height, 1, 1);
+    if (FAILED(hr))
+        return hr;
+
+    const Image *img = image.GetImage(0, 0, 0);
+    if (!img)
+    {
+        image.Release();
+        return E_POINTER;
+    }
+
+    // Transcode single image
+    hr = TranscodeBC(cImage, *img, GetBCFlags(compress), GetSRGBFlags(compress), threshold, (compress & TEX_COMPRESS_PARALLEL) != 0);
+    if (FAILED(hr))
+        image.Release();
+
+    return hr;
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::Transcode(
+    const Image* cImages,
+    size_t nimages,
+    const TexMetadata& metadata,
+    DXGI_FORMAT format,
+    DWORD compress,
+    float threshold,
+    ScratchImage& images)
+{
+    if (!cImages || !nimages)
+        return E_INVALIDARG;
+
+    if (!IsCompressed(metadata.format) || !IsCompressed(format))
+        return E_INVALIDARG;
+
+    if (IsTypeless(format))
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+#ifndef _OPENMP
+    if (compress & TEX_COMPRESS_PARALLEL)
+        return E_NOTIMPL;
+#endif
+
+    images.Release();
+
+    TexMetadata mdata2 = metadata;
+    mdata2.format = format;
+    HRESULT hr = images.Initialize(mdata2);
+    if (FAILED(hr))
+        return hr;
+
+    if (nimages != images.GetImageCount())
+    {
+        images.Release();
+        return E_FAIL;
+    }
+
+    const Image* dest = images.GetImages();
+    if (!dest)
+    {
+        images.Release();
+        return E_POINTER;
+    }
+
+    for (size_t index = 0; index < nimages; ++index)
+    {
+        assert(dest[index].format == format);
+
+        const Image& src = cImages[index];
+        if (src.format != metadata.format)
+        {
+            images.Release();
+            return E_FAIL;
+        }
+
+        if (src.width != dest[index].width || src.height != dest[index].height)
+        {
+            images.Release();
+            return E_FAIL;
+        }
+
+        hr = TranscodeBC(src, dest[index], GetBCFlags(compress), GetSRGBFlags(compress), threshold, (compress & TEX_COMPRESS_PARALLEL) != 0);
+        if (FAILED(hr))
+        {
+            images.Release();
+            return hr;
+        }
+    }
+
+    return S_OK;
+}
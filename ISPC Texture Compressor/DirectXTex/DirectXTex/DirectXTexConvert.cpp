@@ -11,6 +11,15 @@
 
 #include "DirectXTexp.h"
 
+#if defined(_XM_SSE_INTRINSICS_) || defined(_XM_F16C_INTRINSICS_)
+#include <intrin.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#pragma warning(disable : 4616 6993)
+#endif
+
 using namespace DirectX;
 using namespace DirectX::PackedVector;
 using Microsoft::WRL::ComPtr;
@@ -192,6 +201,72 @@ namespace
     const XMVECTORF32 g_HalfMin   = { { { -65504.f, -65504.f, -65504.f, -65504.f } } };
     const XMVECTORF32 g_HalfMax   = { { { 65504.f, 65504.f, 65504.f, 65504.f } } };
     const XMVECTORF32 g_8BitBias  = { { { 0.5f / 255.f, 0.5f / 255.f, 0.5f / 255.f, 0.5f / 255.f } } };
+
+    //-------------------------------------------------------------------------------------
+    // Half-precision scanline conversion (uses F16C when the CPU supports it)
+    //-------------------------------------------------------------------------------------
+#if defined(_XM_SSE_INTRINSICS_) || defined(_XM_F16C_INTRINSICS_)
+    const bool g_HasF16C = IsF16CSupported();
+#endif
+
+    void LoadHalf4Scanline(
+        _Out_writes_(count) XMVECTOR* pDestination,
+        _In_reads_(count) const XMHALF4* pSource,
+        size_t count)
+    {
+#if defined(_XM_SSE_INTRINSICS_) || defined(_XM_F16C_INTRINSICS_)
+        if (g_HasF16C)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                __m128i h = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pSource + i));
+                pDestination[i] = _mm_cvtph_ps(h);
+            }
+            return;
+        }
+#endif
+
+        XMConvertHalfToFloatStream(
+            reinterpret_cast<float*>(pDestination), sizeof(float),
+            reinterpret_cast<const HALF*>(pSource), sizeof(HALF),
+            count * 4);
+    }
+
+    // With clamp set, out of range values saturate to +/-65504 (as _StoreScanline always has);
+    // otherwise they become +/-Inf, and Inf and NaN are preserved
+    void StoreHalf4Scanline(
+        _Out_writes_(count) XMHALF4* pDestination,
+        _In_reads_(count) const XMVECTOR* pSource,
+        size_t count,
+        bool clamp)
+    {
+#if defined(_XM_SSE_INTRINSICS_) || defined(_XM_F16C_INTRINSICS_)
+        if (g_HasF16C)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                XMVECTOR v = (clamp) ? XMVectorClamp(pSource[i], g_HalfMin, g_HalfMax) : pSource[i];
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(pDestination + i), _mm_cvtps_ph(v, 0 /*_MM_FROUND_TO_NEAREST_INT*/));
+            }
+            return;
+        }
+#endif
+
+        if (!clamp)
+        {
+            XMConvertFloatToHalfStream(
+                reinterpret_cast<HALF*>(pDestination), sizeof(HALF),
+                reinterpret_cast<const float*>(pSource), sizeof(float),
+                count * 4);
+            return;
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            XMVECTOR v = XMVectorClamp(pSource[i], g_HalfMin, g_HalfMax);
+            XMStoreHalf4(pDestination + i, v);
+        }
+    }
 }
 
 //-------------------------------------------------------------------------------------
@@ -640,7 +715,24 @@ bool DirectX::_ExpandScanline(
             const uint16_t * __restrict sPtr = static_cast<const uint16_t*>(pSource);
             uint32_t * __restrict dPtr = static_cast<uint32_t*>(pDestination);
 
-            for (size_t ocount = 0, icount = 0; ((icount < (inSize - 1)) && (ocount < (outSize - 3))); icount += 2, ocount += 4)
+            size_t icount = 0, ocount = 0;
+#if defined(_XM_SSE_INTRINSICS_)
+            {
+                size_t n = _ExpandPixels16To32(dPtr, sPtr, std::min<size_t>(inSize / 2, outSize / 4), [](__m128i t) -> __m128i
+                {
+                    __m128i t1 = _mm_or_si128(_mm_srli_epi32(_mm_and_si128(t, _mm_set1_epi32(0xf800)), 8), _mm_srli_epi32(_mm_and_si128(t, _mm_set1_epi32(0xe000)), 13));
+                    __m128i t2 = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x07e0)), 5), _mm_srli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x0600)), 5));
+                    __m128i t3 = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x001f)), 19), _mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x001c)), 14));
+                    return _mm_or_si128(_mm_or_si128(_mm_or_si128(t1, t2), t3), _mm_set1_epi32(static_cast<int>(0xff000000)));
+                });
+                sPtr += n;
+                dPtr += n;
+                icount = n * 2;
+                ocount = n * 4;
+            }
+#endif
+
+            for (; ((icount < (inSize - 1)) && (ocount < (outSize - 3))); icount += 2, ocount += 4)
             {
                 uint16_t t = *(sPtr++);
 
@@ -664,7 +756,26 @@ bool DirectX::_ExpandScanline(
             const uint16_t * __restrict sPtr = static_cast<const uint16_t*>(pSource);
             uint32_t * __restrict dPtr = static_cast<uint32_t*>(pDestination);
 
-            for (size_t ocount = 0, icount = 0; ((icount < (inSize - 1)) && (ocount < (outSize - 3))); icount += 2, ocount += 4)
+            size_t icount = 0, ocount = 0;
+#if defined(_XM_SSE_INTRINSICS_)
+            {
+                const __m128i aset = _mm_set1_epi32((flags & TEXP_SCANLINE_SETALPHA) ? static_cast<int>(0xff000000) : 0);
+                size_t n = _ExpandPixels16To32(dPtr, sPtr, std::min<size_t>(inSize / 2, outSize / 4), [=](__m128i t) -> __m128i
+                {
+                    __m128i t1 = _mm_or_si128(_mm_srli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x7c00)), 7), _mm_srli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x7000)), 12));
+                    __m128i t2 = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x03e0)), 6), _mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x0380)), 1));
+                    __m128i t3 = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x001f)), 19), _mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x001c)), 14));
+                    __m128i ta = _mm_and_si128(_mm_srai_epi32(_mm_slli_epi32(t, 16), 31), _mm_set1_epi32(static_cast<int>(0xff000000)));
+                    return _mm_or_si128(_mm_or_si128(_mm_or_si128(_mm_or_si128(t1, t2), t3), ta), aset);
+                });
+                sPtr += n;
+                dPtr += n;
+                icount = n * 2;
+                ocount = n * 4;
+            }
+#endif
+
+            for (; ((icount < (inSize - 1)) && (ocount < (outSize - 3))); icount += 2, ocount += 4)
             {
                 uint16_t t = *(sPtr++);
 
@@ -689,7 +800,28 @@ bool DirectX::_ExpandScanline(
             const uint16_t * __restrict sPtr = static_cast<const uint16_t*>(pSource);
             uint32_t * __restrict dPtr = static_cast<uint32_t*>(pDestination);
 
-            for (size_t ocount = 0, icount = 0; ((icount < (inSize - 1)) && (ocount < (outSize - 3))); icount += 2, ocount += 4)
+            size_t icount = 0, ocount = 0;
+#if defined(_XM_SSE_INTRINSICS_)
+            {
+                const __m128i amask = _mm_set1_epi32((flags & TEXP_SCANLINE_SETALPHA) ? 0 : 0xf000);
+                const __m128i aset = _mm_set1_epi32((flags & TEXP_SCANLINE_SETALPHA) ? static_cast<int>(0xff000000) : 0);
+                size_t n = _ExpandPixels16To32(dPtr, sPtr, std::min<size_t>(inSize / 2, outSize / 4), [=](__m128i t) -> __m128i
+                {
+                    __m128i t1 = _mm_or_si128(_mm_srli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x0f00)), 4), _mm_srli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x0f00)), 8));
+                    __m128i t2 = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x00f0)), 8), _mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x00f0)), 4));
+                    __m128i t3 = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x000f)), 20), _mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x000f)), 16));
+                    __m128i a = _mm_and_si128(t, amask);
+                    __m128i ta = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(a, 16), _mm_slli_epi32(a, 12)), aset);
+                    return _mm_or_si128(_mm_or_si128(_mm_or_si128(t1, t2), t3), ta);
+                });
+                sPtr += n;
+                dPtr += n;
+                icount = n * 2;
+                ocount = n * 4;
+            }
+#endif
+
+            for (; ((icount < (inSize - 1)) && (ocount < (outSize - 3))); icount += 2, ocount += 4)
             {
                 uint16_t t = *(sPtr++);
 
@@ -797,7 +929,12 @@ _Use_decl_annotations_ bool DirectX::_LoadScanline(
         LOAD_SCANLINE3(XMINT3, XMLoadSInt3, g_XMIdentityR3)
 
     case DXGI_FORMAT_R16G16B16A16_FLOAT:
-        LOAD_SCANLINE(XMHALF4, XMLoadHalf4)
+        if (size >= sizeof(XMHALF4))
+        {
+            LoadHalf4Scanline(dPtr, reinterpret_cast<const XMHALF4*>(pSource), std::min(size / sizeof(XMHALF4), count));
+            return true;
+        }
+        return false;
 
     case DXGI_FORMAT_R16G16B16A16_UNORM:
         LOAD_SCANLINE(XMUSHORTN4, XMLoadUShortN4)
@@ -1644,14 +1781,7 @@ bool DirectX::_StoreScanline(
     case DXGI_FORMAT_R16G16B16A16_FLOAT:
         if (size >= sizeof(XMHALF4))
         {
-            XMHALF4* __restrict dPtr = static_cast<XMHALF4*>(pDestination);
-            for (size_t icount = 0; icount < (size - sizeof(XMHALF4) + 1); icount += sizeof(XMHALF4))
-            {
-                if (sPtr >= ePtr) break;
-                XMVECTOR v = *sPtr++;
-                v = XMVectorClamp(v, g_HalfMin, g_HalfMax);
-                XMStoreHalf4(dPtr++, v);
-            }
+            StoreHalf4Scanline(static_cast<XMHALF4*>(pDestination), sPtr, std::min(size / sizeof(XMHALF4), count), true);
             return true;
         }
         return false;
@@ -2467,7 +2597,8 @@ HRESULT DirectX::_ConvertToR32G32B32A32(const Image& srcImage, ScratchImage& ima
     if (!srcImage.pixels)
         return E_POINTER;
 
-    HRESULT hr = image.Initialize2D(DXGI_FORMAT_R32G32B32A32_FLOAT, srcImage.width, srcImage.height, 1, 1);
+    // Only used for working copies, so pad the pitch for the filters that walk it vertically
+    HRESULT hr = image.Initialize2D(DXGI_FORMAT_R32G32B32A32_FLOAT, srcImage.width, srcImage.height, 1, 1, _ScratchPitchFlags());
     if (FAILED(hr))
         return hr;
 
@@ -2670,10 +2801,7 @@ HRESULT DirectX::_ConvertToR16G16B16A16(const Image& srcImage, ScratchImage& ima
             return E_FAIL;
         }
 
-        XMConvertFloatToHalfStream(
-            reinterpret_cast<HALF*>(pDest), sizeof(HALF),
-            reinterpret_cast<float*>(scanline.get()), sizeof(float),
-            srcImage.width * 4);
+        StoreHalf4Scanline(reinterpret_cast<XMHALF4*>(pDest), scanline.get(), srcImage.width, false);
 
         pSrc += srcImage.rowPitch;
         pDest += img->rowPitch;
@@ -2702,10 +2830,7 @@ HRESULT DirectX::_ConvertFromR16G16B16A16(const Image& srcImage, const Image& de
 
     for (size_t h = 0; h < srcImage.height; ++h)
     {
-        XMConvertHalfToFloatStream(
-            reinterpret_cast<float*>(scanline.get()), sizeof(float),
-            reinterpret_cast<const HALF*>(pSrc), sizeof(HALF),
-            srcImage.width * 4);
+        LoadHalf4Scanline(scanline.get(), reinterpret_cast<const XMHALF4*>(pSrc), srcImage.width);
 
         if (!_StoreScanline(pDest, destImage.rowPitch, destImage.format, scanline.get(), srcImage.width))
             return E_FAIL;
@@ -2719,26 +2844,12 @@ HRESULT DirectX::_ConvertFromR16G16B16A16(const Image& srcImage, const Image& de
 
 
 //-------------------------------------------------------------------------------------
-// Convert from Linear RGB to sRGB
-//
-// if C_linear <= 0.0031308 -> C_srgb = 12.92 * C_linear
-// if C_linear >  0.0031308 -> C_srgb = ( 1 + a ) * pow( C_Linear, 1 / 2.4 ) - a
-//                             where a = 0.055
+// sRGB handling shared by _LoadScanlineLinear and _StoreScanlineLinear: sRGB formats always
+// convert, and formats which can't hold sRGB data never do
 //-------------------------------------------------------------------------------------
 _Use_decl_annotations_
-bool DirectX::_StoreScanlineLinear(
-    void* pDestination,
-    size_t size,
-    DXGI_FORMAT format,
-    XMVECTOR* pSource,
-    size_t count,
-    DWORD flags,
-    float threshold)
+DWORD DirectX::_GetScanlineLinearFlags(DXGI_FORMAT format, DWORD flags)
 {
-    assert(pDestination && size > 0);
-    assert(pSource && count > 0 && ((reinterpret_cast<uintptr_t>(pSource) & 0xF) == 0));
-    assert(IsValid(format) && !IsTypeless(format) && !IsCompressed(format) && !IsPlanar(format) && !IsPalettized(format));
-
     switch (format)
     {
     case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
@@ -2778,6 +2889,33 @@ bool DirectX::_StoreScanlineLinear(
         break;
     }
 
+    return flags;
+}
+
+
+//-------------------------------------------------------------------------------------
+// Convert from Linear RGB to sRGB
+//
+// if C_linear <= 0.0031308 -> C_srgb = 12.92 * C_linear
+// if C_linear >  0.0031308 -> C_srgb = ( 1 + a ) * pow( C_Linear, 1 / 2.4 ) - a
+//                             where a = 0.055
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+bool DirectX::_StoreScanlineLinear(
+    void* pDestination,
+    size_t size,
+    DXGI_FORMAT format,
+    XMVECTOR* pSource,
+    size_t count,
+    DWORD flags,
+    float threshold)
+{
+    assert(pDestination && size > 0);
+    assert(pSource && count > 0 && ((reinterpret_cast<uintptr_t>(pSource) & 0xF) == 0));
+    assert(IsValid(format) && !IsTypeless(format) && !IsCompressed(format) && !IsPlanar(format) && !IsPalettized(format));
+
+    flags = _GetScanlineLinearFlags(format, flags);
+
     // sRGB output processing (Linear RGB -> sRGB)
     if (flags & TEX_FILTER_SRGB_OUT)
     {
@@ -2814,44 +2952,7 @@ bool DirectX::_LoadScanlineLinear(
     assert(pSource && size > 0);
     assert(IsValid(format) && !IsTypeless(format, false) && !IsCompressed(format) && !IsPlanar(format) && !IsPalettized(format));
 
-    switch (format)
-    {
-    case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
-    case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
-    case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
-        flags |= TEX_FILTER_SRGB;
-        break;
-
-    case DXGI_FORMAT_R32G32B32A32_FLOAT:
-    case DXGI_FORMAT_R32G32B32_FLOAT:
-    case DXGI_FORMAT_R16G16B16A16_FLOAT:
-    case DXGI_FORMAT_R16G16B16A16_UNORM:
-    case DXGI_FORMAT_R32G32_FLOAT:
-    case DXGI_FORMAT_R10G10B10A2_UNORM:
-    case DXGI_FORMAT_R11G11B10_FLOAT:
-    case DXGI_FORMAT_R8G8B8A8_UNORM:
-    case DXGI_FORMAT_R16G16_FLOAT:
-    case DXGI_FORMAT_R16G16_UNORM:
-    case DXGI_FORMAT_R32_FLOAT:
-    case DXGI_FORMAT_R8G8_UNORM:
-    case DXGI_FORMAT_R16_FLOAT:
-    case DXGI_FORMAT_R16_UNORM:
-    case DXGI_FORMAT_R8_UNORM:
-    case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
-    case DXGI_FORMAT_R8G8_B8G8_UNORM:
-    case DXGI_FORMAT_G8R8_G8B8_UNORM:
-    case DXGI_FORMAT_B5G6R5_UNORM:
-    case DXGI_FORMAT_B5G5R5A1_UNORM:
-    case DXGI_FORMAT_B8G8R8A8_UNORM:
-    case DXGI_FORMAT_B8G8R8X8_UNORM:
-    case DXGI_FORMAT_B4G4R4A4_UNORM:
-        break;
-
-    default:
-        // can't treat A8, XR, Depth, SNORM, UINT, or SINT as sRGB
-        flags &= ~TEX_FILTER_SRGB;
-        break;
-    }
+    flags = _GetScanlineLinearFlags(format, flags);
 
     if (_LoadScanline(pDestination, count, pSource, size, format))
     {
@@ -3883,465 +3984,485 @@ namespace
 #pragma warning(push)
 #pragma warning( disable : 4127 )
 
-_Use_decl_annotations_
-bool DirectX::_StoreScanlineDither(
-    void* pDestination,
-    size_t size,
-    DXGI_FORMAT format,
-    XMVECTOR* pSource,
-    size_t count,
-    float threshold,
-    size_t y,
-    size_t z,
-    XMVECTOR* pDiffusionErrors)
+namespace
 {
-    assert(pDestination && size > 0);
-    assert(pSource && count > 0 && ((reinterpret_cast<uintptr_t>(pSource) & 0xF) == 0));
-    assert(IsValid(format) && !IsTypeless(format) && !IsCompressed(format) && !IsPlanar(format) && !IsPalettized(format));
-
-    XMVECTOR ordered[4];
-    if (pDiffusionErrors)
+    // The body of _StoreScanlineDither, with the error carried to the next pixel passed in and out so a scanline can
+    // be diffused in segments (odd y walks the scanline right to left)
+    bool StoreScanlineDither(
+        _Out_writes_bytes_(size) void* pDestination,
+        size_t size,
+        DXGI_FORMAT format,
+        _In_reads_(count) const XMVECTOR* pSource,
+        size_t count,
+        float threshold,
+        size_t y,
+        _In_reads_opt_(4) const XMVECTOR* ordered,
+        _Inout_updates_all_opt_(count + 2) XMVECTOR* pDiffusionErrors,
+        _Inout_ XMVECTOR& vError)
     {
-        // If pDiffusionErrors != 0, then this function performs error diffusion dithering (aka Floyd-Steinberg dithering)
+        const XMVECTOR* __restrict sPtr = pSource;
+        if (!sPtr)
+            return false;
 
-        // To avoid the need for another temporary scanline buffer, we allow this function to overwrite the source buffer in-place
-        // Given the intended usage in the conversion routines, this is not a problem.
+        const void* ePtr = static_cast<const uint8_t*>(pDestination) + size;
 
-        XMVECTOR* ptr = pSource;
-        const XMVECTOR* err = pDiffusionErrors + 1;
-        for (size_t i = 0; i < count; ++i)
+        switch (static_cast<int>(format))
         {
-            // Add contribution from previous scanline
-            XMVECTOR v = XMVectorAdd(*ptr, *err++);
-            *ptr++ = v;
-        }
-
-        // Reset errors for next scanline
-        memset(pDiffusionErrors, 0, sizeof(XMVECTOR)*(count + 2));
-    }
-    else
-    {
-        // If pDiffusionErrors == 0, then this function performs ordered dithering
+        case DXGI_FORMAT_R16G16B16A16_UNORM:
+            STORE_SCANLINE(XMUSHORTN4, g_Scale16pc, true, true, uint16_t, 0xFFFF, y, false)
 
-        XMVECTOR dither = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(g_Dither + (z & 3) + ((y & 3) * 8)));
+        case DXGI_FORMAT_R16G16B16A16_UINT:
+            STORE_SCANLINE(XMUSHORT4, g_Scale16pc, true, false, uint16_t, 0xFFFF, y, false)
 
-        ordered[0] = XMVectorSplatX(dither);
-        ordered[1] = XMVectorSplatY(dither);
-        ordered[2] = XMVectorSplatZ(dither);
-        ordered[3] = XMVectorSplatW(dither);
-    }
+        case DXGI_FORMAT_R16G16B16A16_SNORM:
+            STORE_SCANLINE(XMSHORTN4, g_Scale15pc, false, true, int16_t, 0xFFFF, y, false)
 
-    const XMVECTOR* __restrict sPtr = pSource;
-    if (!sPtr)
-        return false;
+        case DXGI_FORMAT_R16G16B16A16_SINT:
+            STORE_SCANLINE(XMSHORT4, g_Scale15pc, false, false, int16_t, 0xFFFF, y, false)
 
-    const void* ePtr = static_cast<const uint8_t*>(pDestination) + size;
+        case DXGI_FORMAT_R10G10B10A2_UNORM:
+            STORE_SCANLINE(XMUDECN4, g_Scale10pc, true, true, uint16_t, 0x3FF, y, false)
 
-    XMVECTOR vError = XMVectorZero();
+        case DXGI_FORMAT_R10G10B10A2_UINT:
+            STORE_SCANLINE(XMUDEC4, g_Scale10pc, true, false, uint16_t, 0x3FF, y, false)
 
-    switch (static_cast<int>(format))
-    {
-    case DXGI_FORMAT_R16G16B16A16_UNORM:
-        STORE_SCANLINE(XMUSHORTN4, g_Scale16pc, true, true, uint16_t, 0xFFFF, y, false)
+        case DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM:
+            if (size >= sizeof(XMUDEC4))
+            {
+                static const XMVECTORF32  Scale = { { { 510.0f, 510.0f, 510.0f, 3.0f } } };
+                static const XMVECTORF32  Bias  = { { { 384.0f, 384.0f, 384.0f, 0.0f } } };
+                static const XMVECTORF32  MinXR = { { { -0.7529f, -0.7529f, -0.7529f, 0.f } } };
+                static const XMVECTORF32  MaxXR = { { { 1.2529f, 1.2529f, 1.2529f, 1.0f } } };
 
-    case DXGI_FORMAT_R16G16B16A16_UINT:
-        STORE_SCANLINE(XMUSHORT4, g_Scale16pc, true, false, uint16_t, 0xFFFF, y, false)
+                XMUDEC4 * __restrict dest = static_cast<XMUDEC4*>(pDestination);
+                for (size_t i = 0; i < count; ++i)
+                {
+                    auto index = static_cast<ptrdiff_t>((y & 1) ? (count - i - 1) : i);
+                    ptrdiff_t delta = (y & 1) ? -2 : 0;
 
-    case DXGI_FORMAT_R16G16B16A16_SNORM:
-        STORE_SCANLINE(XMSHORTN4, g_Scale15pc, false, true, int16_t, 0xFFFF, y, false)
+                    XMVECTOR v = XMVectorClamp(sPtr[index], MinXR, MaxXR);
+                    v = XMVectorMultiplyAdd(v, Scale, vError);
 
-    case DXGI_FORMAT_R16G16B16A16_SINT:
-        STORE_SCANLINE(XMSHORT4, g_Scale15pc, false, false, int16_t, 0xFFFF, y, false)
+                    XMVECTOR target;
+                    if (pDiffusionErrors)
+                    {
+                        target = XMVectorRound(v);
+                        vError = XMVectorSubtract(v, target);
+                        vError = XMVectorDivide(vError, Scale);
+
+                        // Distribute error to next scanline and next pixel
+                        pDiffusionErrors[index - delta]     = XMVectorMultiplyAdd(g_ErrorWeight3, vError, pDiffusionErrors[index - delta]);
+                        pDiffusionErrors[index + 1]         = XMVectorMultiplyAdd(g_ErrorWeight5, vError, pDiffusionErrors[index + 1]);
+                        pDiffusionErrors[index + 2 + delta] = XMVectorMultiplyAdd(g_ErrorWeight1, vError, pDiffusionErrors[index + 2 + delta]);
+                        vError = XMVectorMultiply(vError, g_ErrorWeight7);
+                    }
+                    else
+                    {
+                        // Applied ordered dither
+                        target = XMVectorAdd(v, ordered[index & 3]);
+                        target = XMVectorRound(target);
+                    }
 
-    case DXGI_FORMAT_R10G10B10A2_UNORM:
-        STORE_SCANLINE(XMUDECN4, g_Scale10pc, true, true, uint16_t, 0x3FF, y, false)
+                    target = XMVectorAdd(target, Bias);
+                    target = XMVectorClamp(target, g_XMZero, g_Scale10pc);
 
-    case DXGI_FORMAT_R10G10B10A2_UINT:
-        STORE_SCANLINE(XMUDEC4, g_Scale10pc, true, false, uint16_t, 0x3FF, y, false)
+                    XMFLOAT4A tmp;
+                    XMStoreFloat4A(&tmp, target);
 
-    case DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM:
-        if (size >= sizeof(XMUDEC4))
-        {
-            static const XMVECTORF32  Scale = { { { 510.0f, 510.0f, 510.0f, 3.0f } } };
-            static const XMVECTORF32  Bias  = { { { 384.0f, 384.0f, 384.0f, 0.0f } } };
-            static const XMVECTORF32  MinXR = { { { -0.7529f, -0.7529f, -0.7529f, 0.f } } };
-            static const XMVECTORF32  MaxXR = { { { 1.2529f, 1.2529f, 1.2529f, 1.0f } } };
+                    auto dPtr = &dest[index];
+                    if (dPtr >= ePtr) break;
+                    dPtr->x = static_cast<uint16_t>(tmp.x) & 0x3FF;
+                    dPtr->y = static_cast<uint16_t>(tmp.y) & 0x3FF;
+                    dPtr->z = static_cast<uint16_t>(tmp.z) & 0x3FF;
+                    dPtr->w = static_cast<uint16_t>(tmp.w);
+                }
+                return true;
+            }
+            return false;
 
-            XMUDEC4 * __restrict dest = static_cast<XMUDEC4*>(pDestination);
-            for (size_t i = 0; i < count; ++i)
-            {
-                auto index = static_cast<ptrdiff_t>((y & 1) ? (count - i - 1) : i);
-                ptrdiff_t delta = (y & 1) ? -2 : 0;
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+            STORE_SCANLINE(XMUBYTEN4, g_Scale8pc, true, true, uint8_t, 0xFF, y, false)
 
-                XMVECTOR v = XMVectorClamp(sPtr[index], MinXR, MaxXR);
-                v = XMVectorMultiplyAdd(v, Scale, vError);
+        case DXGI_FORMAT_R8G8B8A8_UINT:
+            STORE_SCANLINE(XMUBYTE4, g_Scale8pc, true, false, uint8_t, 0xFF, y, false)
 
-                XMVECTOR target;
-                if (pDiffusionErrors)
-                {
-                    target = XMVectorRound(v);
-                    vError = XMVectorSubtract(v, target);
-                    vError = XMVectorDivide(vError, Scale);
-
-                    // Distribute error to next scanline and next pixel
-                    pDiffusionErrors[index - delta]     = XMVectorMultiplyAdd(g_ErrorWeight3, vError, pDiffusionErrors[index - delta]);
-                    pDiffusionErrors[index + 1]         = XMVectorMultiplyAdd(g_ErrorWeight5, vError, pDiffusionErrors[index + 1]);
-                    pDiffusionErrors[index + 2 + delta] = XMVectorMultiplyAdd(g_ErrorWeight1, vError, pDiffusionErrors[index + 2 + delta]);
-                    vError = XMVectorMultiply(vError, g_ErrorWeight7);
-                }
-                else
-                {
-                    // Applied ordered dither
-                    target = XMVectorAdd(v, ordered[index & 3]);
-                    target = XMVectorRound(target);
-                }
+        case DXGI_FORMAT_R8G8B8A8_SNORM:
+            STORE_SCANLINE(XMBYTEN4, g_Scale7pc, false, true, int8_t, 0xFF, y, false)
 
-                target = XMVectorAdd(target, Bias);
-                target = XMVectorClamp(target, g_XMZero, g_Scale10pc);
+        case DXGI_FORMAT_R8G8B8A8_SINT:
+            STORE_SCANLINE(XMBYTE4, g_Scale7pc, false, false, int8_t, 0xFF, y, false)
 
-                XMFLOAT4A tmp;
-                XMStoreFloat4A(&tmp, target);
+        case DXGI_FORMAT_R16G16_UNORM:
+            STORE_SCANLINE2(XMUSHORTN2, g_Scale16pc, true, true, uint16_t, 0xFFFF, y)
 
-                auto dPtr = &dest[index];
-                if (dPtr >= ePtr) break;
-                dPtr->x = static_cast<uint16_t>(tmp.x) & 0x3FF;
-                dPtr->y = static_cast<uint16_t>(tmp.y) & 0x3FF;
-                dPtr->z = static_cast<uint16_t>(tmp.z) & 0x3FF;
-                dPtr->w = static_cast<uint16_t>(tmp.w);
-            }
-            return true;
-        }
-        return false;
+        case DXGI_FORMAT_R16G16_UINT:
+            STORE_SCANLINE2(XMUSHORT2, g_Scale16pc, true, false, uint16_t, 0xFFFF, y)
 
-    case DXGI_FORMAT_R8G8B8A8_UNORM:
-    case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
-        STORE_SCANLINE(XMUBYTEN4, g_Scale8pc, true, true, uint8_t, 0xFF, y, false)
+        case DXGI_FORMAT_R16G16_SNORM:
+            STORE_SCANLINE2(XMSHORTN2, g_Scale15pc, false, true, int16_t, 0xFFFF, y)
 
-    case DXGI_FORMAT_R8G8B8A8_UINT:
-        STORE_SCANLINE(XMUBYTE4, g_Scale8pc, true, false, uint8_t, 0xFF, y, false)
+        case DXGI_FORMAT_R16G16_SINT:
+            STORE_SCANLINE2(XMSHORT2, g_Scale15pc, false, false, int16_t, 0xFFFF, y)
 
-    case DXGI_FORMAT_R8G8B8A8_SNORM:
-        STORE_SCANLINE(XMBYTEN4, g_Scale7pc, false, true, int8_t, 0xFF, y, false)
+        case DXGI_FORMAT_D24_UNORM_S8_UINT:
+            if (size >= sizeof(uint32_t))
+            {
+                static const XMVECTORF32 Clamp  = { { { 1.f,  255.f, 0.f, 0.f } } };
+                static const XMVECTORF32 Scale  = { { { 16777215.f,   1.f, 0.f, 0.f } } };
+                static const XMVECTORF32 Scale2 = { { { 16777215.f, 255.f, 0.f, 0.f } } };
 
-    case DXGI_FORMAT_R8G8B8A8_SINT:
-        STORE_SCANLINE(XMBYTE4, g_Scale7pc, false, false, int8_t, 0xFF, y, false)
+                uint32_t * __restrict dest = static_cast<uint32_t*>(pDestination);
+                for (size_t i = 0; i < count; ++i)
+                {
+                    auto index = static_cast<ptrdiff_t>((y & 1) ? (count - i - 1) : i);
+                    ptrdiff_t delta = (y & 1) ? -2 : 0;
 
-    case DXGI_FORMAT_R16G16_UNORM:
-        STORE_SCANLINE2(XMUSHORTN2, g_Scale16pc, true, true, uint16_t, 0xFFFF, y)
+                    XMVECTOR v = XMVectorClamp(sPtr[index], g_XMZero, Clamp);
+                    v = XMVectorAdd(v, vError);
+                    v = XMVectorMultiply(v, Scale);
 
-    case DXGI_FORMAT_R16G16_UINT:
-        STORE_SCANLINE2(XMUSHORT2, g_Scale16pc, true, false, uint16_t, 0xFFFF, y)
+                    XMVECTOR target;
+                    if (pDiffusionErrors)
+                    {
+                        target = XMVectorRound(v);
+                        vError = XMVectorSubtract(v, target);
+                        vError = XMVectorDivide(vError, Scale);
+
+                        // Distribute error to next scanline and next pixel
+                        pDiffusionErrors[index - delta]     = XMVectorMultiplyAdd(g_ErrorWeight3, vError, pDiffusionErrors[index - delta]);
+                        pDiffusionErrors[index + 1]         = XMVectorMultiplyAdd(g_ErrorWeight5, vError, pDiffusionErrors[index + 1]);
+                        pDiffusionErrors[index + 2 + delta] = XMVectorMultiplyAdd(g_ErrorWeight1, vError, pDiffusionErrors[index + 2 + delta]);
+                        vError = XMVectorMultiply(vError, g_ErrorWeight7);
+                    }
+                    else
+                    {
+                        // Applied ordered dither
+                        target = XMVectorAdd(v, ordered[index & 3]);
+                        target = XMVectorRound(target);
+                    }
 
-    case DXGI_FORMAT_R16G16_SNORM:
-        STORE_SCANLINE2(XMSHORTN2, g_Scale15pc, false, true, int16_t, 0xFFFF, y)
+                    target = XMVectorClamp(target, g_XMZero, Scale2);
 
-    case DXGI_FORMAT_R16G16_SINT:
-        STORE_SCANLINE2(XMSHORT2, g_Scale15pc, false, false, int16_t, 0xFFFF, y)
+                    XMFLOAT4A tmp;
+                    XMStoreFloat4A(&tmp, target);
 
-    case DXGI_FORMAT_D24_UNORM_S8_UINT:
-        if (size >= sizeof(uint32_t))
-        {
-            static const XMVECTORF32 Clamp  = { { { 1.f,  255.f, 0.f, 0.f } } };
-            static const XMVECTORF32 Scale  = { { { 16777215.f,   1.f, 0.f, 0.f } } };
-            static const XMVECTORF32 Scale2 = { { { 16777215.f, 255.f, 0.f, 0.f } } };
-
-            uint32_t * __restrict dest = static_cast<uint32_t*>(pDestination);
-            for (size_t i = 0; i < count; ++i)
-            {
-                auto index = static_cast<ptrdiff_t>((y & 1) ? (count - i - 1) : i);
-                ptrdiff_t delta = (y & 1) ? -2 : 0;
-
-                XMVECTOR v = XMVectorClamp(sPtr[index], g_XMZero, Clamp);
-                v = XMVectorAdd(v, vError);
-                v = XMVectorMultiply(v, Scale);
-
-                XMVECTOR target;
-                if (pDiffusionErrors)
-                {
-                    target = XMVectorRound(v);
-                    vError = XMVectorSubtract(v, target);
-                    vError = XMVectorDivide(vError, Scale);
-
-                    // Distribute error to next scanline and next pixel
-                    pDiffusionErrors[index - delta]     = XMVectorMultiplyAdd(g_ErrorWeight3, vError, pDiffusionErrors[index - delta]);
-                    pDiffusionErrors[index + 1]         = XMVectorMultiplyAdd(g_ErrorWeight5, vError, pDiffusionErrors[index + 1]);
-                    pDiffusionErrors[index + 2 + delta] = XMVectorMultiplyAdd(g_ErrorWeight1, vError, pDiffusionErrors[index + 2 + delta]);
-                    vError = XMVectorMultiply(vError, g_ErrorWeight7);
-                }
-                else
-                {
-                    // Applied ordered dither
-                    target = XMVectorAdd(v, ordered[index & 3]);
-                    target = XMVectorRound(target);
+                    auto dPtr = &dest[index];
+                    if (dPtr >= ePtr) break;
+                    *dPtr = (static_cast<uint32_t>(tmp.x) & 0xFFFFFF)
+                        | ((static_cast<uint32_t>(tmp.y) & 0xFF) << 24);
                 }
-
-                target = XMVectorClamp(target, g_XMZero, Scale2);
-
-                XMFLOAT4A tmp;
-                XMStoreFloat4A(&tmp, target);
-
-                auto dPtr = &dest[index];
-                if (dPtr >= ePtr) break;
-                *dPtr = (static_cast<uint32_t>(tmp.x) & 0xFFFFFF)
-                    | ((static_cast<uint32_t>(tmp.y) & 0xFF) << 24);
+                return true;
             }
-            return true;
-        }
-        return false;
+            return false;
 
-    case DXGI_FORMAT_R8G8_UNORM:
-        STORE_SCANLINE2(XMUBYTEN2, g_Scale8pc, true, true, uint8_t, 0xFF, y)
+        case DXGI_FORMAT_R8G8_UNORM:
+            STORE_SCANLINE2(XMUBYTEN2, g_Scale8pc, true, true, uint8_t, 0xFF, y)
 
-    case DXGI_FORMAT_R8G8_UINT:
-        STORE_SCANLINE2(XMUBYTE2, g_Scale8pc, true, false, uint8_t, 0xFF, y)
+        case DXGI_FORMAT_R8G8_UINT:
+            STORE_SCANLINE2(XMUBYTE2, g_Scale8pc, true, false, uint8_t, 0xFF, y)
 
-    case DXGI_FORMAT_R8G8_SNORM:
-        STORE_SCANLINE2(XMBYTEN2, g_Scale7pc, false, true, int8_t, 0xFF, y)
+        case DXGI_FORMAT_R8G8_SNORM:
+            STORE_SCANLINE2(XMBYTEN2, g_Scale7pc, false, true, int8_t, 0xFF, y)
 
-    case DXGI_FORMAT_R8G8_SINT:
-        STORE_SCANLINE2(XMBYTE2, g_Scale7pc, false, false, int8_t, 0xFF, y)
+        case DXGI_FORMAT_R8G8_SINT:
+            STORE_SCANLINE2(XMBYTE2, g_Scale7pc, false, false, int8_t, 0xFF, y)
 
-    case DXGI_FORMAT_D16_UNORM:
-    case DXGI_FORMAT_R16_UNORM:
-        STORE_SCANLINE1(uint16_t, g_Scale16pc, true, true, 0xFFFF, y, false)
+        case DXGI_FORMAT_D16_UNORM:
+        case DXGI_FORMAT_R16_UNORM:
+            STORE_SCANLINE1(uint16_t, g_Scale16pc, true, true, 0xFFFF, y, false)
 
-    case DXGI_FORMAT_R16_UINT:
-        STORE_SCANLINE1(uint16_t, g_Scale16pc, true, false, 0xFFFF, y, false)
+        case DXGI_FORMAT_R16_UINT:
+            STORE_SCANLINE1(uint16_t, g_Scale16pc, true, false, 0xFFFF, y, false)
 
-    case DXGI_FORMAT_R16_SNORM:
-        STORE_SCANLINE1(int16_t, g_Scale15pc, false, true, 0xFFFF, y, false)
+        case DXGI_FORMAT_R16_SNORM:
+            STORE_SCANLINE1(int16_t, g_Scale15pc, false, true, 0xFFFF, y, false)
 
-    case DXGI_FORMAT_R16_SINT:
-        STORE_SCANLINE1(int16_t, g_Scale15pc, false, false, 0xFFFF, y, false)
+        case DXGI_FORMAT_R16_SINT:
+            STORE_SCANLINE1(int16_t, g_Scale15pc, false, false, 0xFFFF, y, false)
 
-    case DXGI_FORMAT_R8_UNORM:
-        STORE_SCANLINE1(uint8_t, g_Scale8pc, true, true, 0xFF, y, false)
+        case DXGI_FORMAT_R8_UNORM:
+            STORE_SCANLINE1(uint8_t, g_Scale8pc, true, true, 0xFF, y, false)
 
-    case DXGI_FORMAT_R8_UINT:
-        STORE_SCANLINE1(uint8_t, g_Scale8pc, true, false, 0xFF, y, false)
+        case DXGI_FORMAT_R8_UINT:
+            STORE_SCANLINE1(uint8_t, g_Scale8pc, true, false, 0xFF, y, false)
 
-    case DXGI_FORMAT_R8_SNORM:
-        STORE_SCANLINE1(int8_t, g_Scale7pc, false, true, 0xFF, y, false)
+        case DXGI_FORMAT_R8_SNORM:
+            STORE_SCANLINE1(int8_t, g_Scale7pc, false, true, 0xFF, y, false)
 
-    case DXGI_FORMAT_R8_SINT:
-        STORE_SCANLINE1(int8_t, g_Scale7pc, false, false, 0xFF, y, false)
+        case DXGI_FORMAT_R8_SINT:
+            STORE_SCANLINE1(int8_t, g_Scale7pc, false, false, 0xFF, y, false)
 
-    case DXGI_FORMAT_A8_UNORM:
-        STORE_SCANLINE1(uint8_t, g_Scale8pc, true, true, 0xFF, y, true)
+        case DXGI_FORMAT_A8_UNORM:
+            STORE_SCANLINE1(uint8_t, g_Scale8pc, true, true, 0xFF, y, true)
 
-    case DXGI_FORMAT_B5G6R5_UNORM:
-        if (size >= sizeof(XMU565))
-        {
-            XMU565 * __restrict dest = static_cast<XMU565*>(pDestination);
-            for (size_t i = 0; i < count; ++i)
+        case DXGI_FORMAT_B5G6R5_UNORM:
+            if (size >= sizeof(XMU565))
             {
-                auto index = static_cast<ptrdiff_t>((y & 1) ? (count - i - 1) : i);
-                ptrdiff_t delta = (y & 1) ? -2 : 0;
+                XMU565 * __restrict dest = static_cast<XMU565*>(pDestination);
+                for (size_t i = 0; i < count; ++i)
+                {
+                    auto index = static_cast<ptrdiff_t>((y & 1) ? (count - i - 1) : i);
+                    ptrdiff_t delta = (y & 1) ? -2 : 0;
 
-                XMVECTOR v = XMVectorSwizzle<2, 1, 0, 3>(sPtr[index]);
-                v = XMVectorSaturate(v);
-                v = XMVectorAdd(v, vError);
-                v = XMVectorMultiply(v, g_Scale565pc);
+                    XMVECTOR v = XMVectorSwizzle<2, 1, 0, 3>(sPtr[index]);
+                    v = XMVectorSaturate(v);
+                    v = XMVectorAdd(v, vError);
+                    v = XMVectorMultiply(v, g_Scale565pc);
 
-                XMVECTOR target;
-                if (pDiffusionErrors)
-                {
-                    target = XMVectorRound(v);
-                    vError = XMVectorSubtract(v, target);
-                    vError = XMVectorDivide(vError, g_Scale565pc);
-
-                    // Distribute error to next scanline and next pixel
-                    pDiffusionErrors[index - delta]     = XMVectorMultiplyAdd(g_ErrorWeight3, vError, pDiffusionErrors[index - delta]);
-                    pDiffusionErrors[index + 1]         = XMVectorMultiplyAdd(g_ErrorWeight5, vError, pDiffusionErrors[index + 1]);
-                    pDiffusionErrors[index + 2 + delta] = XMVectorMultiplyAdd(g_ErrorWeight1, vError, pDiffusionErrors[index + 2 + delta]);
-                    vError = XMVectorMultiply(vError, g_ErrorWeight7);
-                }
-                else
-                {
-                    // Applied ordered dither
-                    target = XMVectorAdd(v, ordered[index & 3]);
-                    target = XMVectorRound(target);
-                }
+                    XMVECTOR target;
+                    if (pDiffusionErrors)
+                    {
+                        target = XMVectorRound(v);
+                        vError = XMVectorSubtract(v, target);
+                        vError = XMVectorDivide(vError, g_Scale565pc);
+
+                        // Distribute error to next scanline and next pixel
+                        pDiffusionErrors[index - delta]     = XMVectorMultiplyAdd(g_ErrorWeight3, vError, pDiffusionErrors[index - delta]);
+                        pDiffusionErrors[index + 1]         = XMVectorMultiplyAdd(g_ErrorWeight5, vError, pDiffusionErrors[index + 1]);
+                        pDiffusionErrors[index + 2 + delta] = XMVectorMultiplyAdd(g_ErrorWeight1, vError, pDiffusionErrors[index + 2 + delta]);
+                        vError = XMVectorMultiply(vError, g_ErrorWeight7);
+                    }
+                    else
+                    {
+                        // Applied ordered dither
+                        target = XMVectorAdd(v, ordered[index & 3]);
+                        target = XMVectorRound(target);
+                    }
 
-                target = XMVectorClamp(target, g_XMZero, g_Scale565pc);
+                    target = XMVectorClamp(target, g_XMZero, g_Scale565pc);
 
-                XMFLOAT4A tmp;
-                XMStoreFloat4A(&tmp, target);
+                    XMFLOAT4A tmp;
+                    XMStoreFloat4A(&tmp, target);
 
-                auto dPtr = &dest[index];
-                if (dPtr >= ePtr) break;
-                dPtr->x = static_cast<uint16_t>(tmp.x) & 0x1F;
-                dPtr->y = static_cast<uint16_t>(tmp.y) & 0x3F;
-                dPtr->z = static_cast<uint16_t>(tmp.z) & 0x1F;
+                    auto dPtr = &dest[index];
+                    if (dPtr >= ePtr) break;
+                    dPtr->x = static_cast<uint16_t>(tmp.x) & 0x1F;
+                    dPtr->y = static_cast<uint16_t>(tmp.y) & 0x3F;
+                    dPtr->z = static_cast<uint16_t>(tmp.z) & 0x1F;
+                }
+                return true;
             }
-            return true;
-        }
-        return false;
+            return false;
 
-    case DXGI_FORMAT_B5G5R5A1_UNORM:
-        if (size >= sizeof(XMU555))
-        {
-            XMU555 * __restrict dest = static_cast<XMU555*>(pDestination);
-            for (size_t i = 0; i < count; ++i)
+        case DXGI_FORMAT_B5G5R5A1_UNORM:
+            if (size >= sizeof(XMU555))
             {
-                auto index = static_cast<ptrdiff_t>((y & 1) ? (count - i - 1) : i);
-                ptrdiff_t delta = (y & 1) ? -2 : 0;
+                XMU555 * __restrict dest = static_cast<XMU555*>(pDestination);
+                for (size_t i = 0; i < count; ++i)
+                {
+                    auto index = static_cast<ptrdiff_t>((y & 1) ? (count - i - 1) : i);
+                    ptrdiff_t delta = (y & 1) ? -2 : 0;
 
-                XMVECTOR v = XMVectorSwizzle<2, 1, 0, 3>(sPtr[index]);
-                v = XMVectorSaturate(v);
-                v = XMVectorAdd(v, vError);
-                v = XMVectorMultiply(v, g_Scale5551pc);
+                    XMVECTOR v = XMVectorSwizzle<2, 1, 0, 3>(sPtr[index]);
+                    v = XMVectorSaturate(v);
+                    v = XMVectorAdd(v, vError);
+                    v = XMVectorMultiply(v, g_Scale5551pc);
 
-                XMVECTOR target;
-                if (pDiffusionErrors)
-                {
-                    target = XMVectorRound(v);
-                    vError = XMVectorSubtract(v, target);
-                    vError = XMVectorDivide(vError, g_Scale5551pc);
-
-                    // Distribute error to next scanline and next pixel
-                    pDiffusionErrors[index - delta]     = XMVectorMultiplyAdd(g_ErrorWeight3, vError, pDiffusionErrors[index - delta]);
-                    pDiffusionErrors[index + 1]         = XMVectorMultiplyAdd(g_ErrorWeight5, vError, pDiffusionErrors[index + 1]);
-                    pDiffusionErrors[index + 2 + delta] = XMVectorMultiplyAdd(g_ErrorWeight1, vError, pDiffusionErrors[index + 2 + delta]);
-                    vError = XMVectorMultiply(vError, g_ErrorWeight7);
-                }
-                else
-                {
-                    // Applied ordered dither
-                    target = XMVectorAdd(v, ordered[index & 3]);
-                    target = XMVectorRound(target);
-                }
+                    XMVECTOR target;
+                    if (pDiffusionErrors)
+                    {
+                        target = XMVectorRound(v);
+                        vError = XMVectorSubtract(v, target);
+                        vError = XMVectorDivide(vError, g_Scale5551pc);
+
+                        // Distribute error to next scanline and next pixel
+                        pDiffusionErrors[index - delta]     = XMVectorMultiplyAdd(g_ErrorWeight3, vError, pDiffusionErrors[index - delta]);
+                        pDiffusionErrors[index + 1]         = XMVectorMultiplyAdd(g_ErrorWeight5, vError, pDiffusionErrors[index + 1]);
+                        pDiffusionErrors[index + 2 + delta] = XMVectorMultiplyAdd(g_ErrorWeight1, vError, pDiffusionErrors[index + 2 + delta]);
+                        vError = XMVectorMultiply(vError, g_ErrorWeight7);
+                    }
+                    else
+                    {
+                        // Applied ordered dither
+                        target = XMVectorAdd(v, ordered[index & 3]);
+                        target = XMVectorRound(target);
+                    }
 
-                target = XMVectorClamp(target, g_XMZero, g_Scale5551pc);
+                    target = XMVectorClamp(target, g_XMZero, g_Scale5551pc);
 
-                XMFLOAT4A tmp;
-                XMStoreFloat4A(&tmp, target);
+                    XMFLOAT4A tmp;
+                    XMStoreFloat4A(&tmp, target);
 
-                auto dPtr = &dest[index];
-                if (dPtr >= ePtr) break;
-                dPtr->x = static_cast<uint16_t>(tmp.x) & 0x1F;
-                dPtr->y = static_cast<uint16_t>(tmp.y) & 0x1F;
-                dPtr->z = static_cast<uint16_t>(tmp.z) & 0x1F;
-                dPtr->w = (XMVectorGetW(target) > threshold) ? 1 : 0;
+                    auto dPtr = &dest[index];
+                    if (dPtr >= ePtr) break;
+                    dPtr->x = static_cast<uint16_t>(tmp.x) & 0x1F;
+                    dPtr->y = static_cast<uint16_t>(tmp.y) & 0x1F;
+                    dPtr->z = static_cast<uint16_t>(tmp.z) & 0x1F;
+                    dPtr->w = (XMVectorGetW(target) > threshold) ? 1 : 0;
+                }
+                return true;
             }
-            return true;
-        }
-        return false;
+            return false;
 
-    case DXGI_FORMAT_B8G8R8A8_UNORM:
-    case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
-        STORE_SCANLINE(XMUBYTEN4, g_Scale8pc, true, true, uint8_t, 0xFF, y, true)
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+            STORE_SCANLINE(XMUBYTEN4, g_Scale8pc, true, true, uint8_t, 0xFF, y, true)
 
-    case DXGI_FORMAT_B8G8R8X8_UNORM:
-    case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
-        if (size >= sizeof(XMUBYTEN4))
-        {
-            XMUBYTEN4 * __restrict dest = static_cast<XMUBYTEN4*>(pDestination);
-            for (size_t i = 0; i < count; ++i)
+        case DXGI_FORMAT_B8G8R8X8_UNORM:
+        case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+            if (size >= sizeof(XMUBYTEN4))
             {
-                auto index = static_cast<ptrdiff_t>((y & 1) ? (count - i - 1) : i);
-                ptrdiff_t delta = (y & 1) ? -2 : 0;
+                XMUBYTEN4 * __restrict dest = static_cast<XMUBYTEN4*>(pDestination);
+                for (size_t i = 0; i < count; ++i)
+                {
+                    auto index = static_cast<ptrdiff_t>((y & 1) ? (count - i - 1) : i);
+                    ptrdiff_t delta = (y & 1) ? -2 : 0;
 
-                XMVECTOR v = XMVectorSwizzle<2, 1, 0, 3>(sPtr[index]);
-                v = XMVectorSaturate(v);
-                v = XMVectorAdd(v, vError);
-                v = XMVectorMultiply(v, g_Scale8pc);
+                    XMVECTOR v = XMVectorSwizzle<2, 1, 0, 3>(sPtr[index]);
+                    v = XMVectorSaturate(v);
+                    v = XMVectorAdd(v, vError);
+                    v = XMVectorMultiply(v, g_Scale8pc);
 
-                XMVECTOR target;
-                if (pDiffusionErrors)
-                {
-                    target = XMVectorRound(v);
-                    vError = XMVectorSubtract(v, target);
-                    vError = XMVectorDivide(vError, g_Scale8pc);
-
-                    // Distribute error to next scanline and next pixel
-                    pDiffusionErrors[index - delta]     = XMVectorMultiplyAdd(g_ErrorWeight3, vError, pDiffusionErrors[index - delta]);
-                    pDiffusionErrors[index + 1]         = XMVectorMultiplyAdd(g_ErrorWeight5, vError, pDiffusionErrors[index + 1]);
-                    pDiffusionErrors[index + 2 + delta] = XMVectorMultiplyAdd(g_ErrorWeight1, vError, pDiffusionErrors[index + 2 + delta]);
-                    vError = XMVectorMultiply(vError, g_ErrorWeight7);
-                }
-                else
-                {
-                    // Applied ordered dither
-                    target = XMVectorAdd(v, ordered[index & 3]);
-                    target = XMVectorRound(target);
-                }
+                    XMVECTOR target;
+                    if (pDiffusionErrors)
+                    {
+                        target = XMVectorRound(v);
+                        vError = XMVectorSubtract(v, target);
+                        vError = XMVectorDivide(vError, g_Scale8pc);
+
+                        // Distribute error to next scanline and next pixel
+                        pDiffusionErrors[index - delta]     = XMVectorMultiplyAdd(g_ErrorWeight3, vError, pDiffusionErrors[index - delta]);
+                        pDiffusionErrors[index + 1]         = XMVectorMultiplyAdd(g_ErrorWeight5, vError, pDiffusionErrors[index + 1]);
+                        pDiffusionErrors[index + 2 + delta] = XMVectorMultiplyAdd(g_ErrorWeight1, vError, pDiffusionErrors[index + 2 + delta]);
+                        vError = XMVectorMultiply(vError, g_ErrorWeight7);
+                    }
+                    else
+                    {
+                        // Applied ordered dither
+                        target = XMVectorAdd(v, ordered[index & 3]);
+                        target = XMVectorRound(target);
+                    }
 
-                target = XMVectorClamp(target, g_XMZero, g_Scale8pc);
+                    target = XMVectorClamp(target, g_XMZero, g_Scale8pc);
 
-                XMFLOAT4A tmp;
-                XMStoreFloat4A(&tmp, target);
+                    XMFLOAT4A tmp;
+                    XMStoreFloat4A(&tmp, target);
 
-                auto dPtr = &dest[index];
-                if (dPtr >= ePtr) break;
-                dPtr->x = static_cast<uint8_t>(tmp.x) & 0xFF;
-                dPtr->y = static_cast<uint8_t>(tmp.y) & 0xFF;
-                dPtr->z = static_cast<uint8_t>(tmp.z) & 0xFF;
-                dPtr->w = 0;
+                    auto dPtr = &dest[index];
+                    if (dPtr >= ePtr) break;
+                    dPtr->x = static_cast<uint8_t>(tmp.x) & 0xFF;
+                    dPtr->y = static_cast<uint8_t>(tmp.y) & 0xFF;
+                    dPtr->z = static_cast<uint8_t>(tmp.z) & 0xFF;
+                    dPtr->w = 0;
+                }
+                return true;
             }
-            return true;
-        }
-        return false;
+            return false;
 
-    case DXGI_FORMAT_B4G4R4A4_UNORM:
-        STORE_SCANLINE(XMUNIBBLE4, g_Scale4pc, true, true, uint8_t, 0xF, y, true)
+        case DXGI_FORMAT_B4G4R4A4_UNORM:
+            STORE_SCANLINE(XMUNIBBLE4, g_Scale4pc, true, true, uint8_t, 0xF, y, true)
 
-    case XBOX_DXGI_FORMAT_R10G10B10_SNORM_A2_UNORM:
-        STORE_SCANLINE(XMXDECN4, g_Scale9pc, false, true, uint16_t, 0x3FF, y, false)
+        case XBOX_DXGI_FORMAT_R10G10B10_SNORM_A2_UNORM:
+            STORE_SCANLINE(XMXDECN4, g_Scale9pc, false, true, uint16_t, 0x3FF, y, false)
 
-    case XBOX_DXGI_FORMAT_R4G4_UNORM:
-        if (size >= sizeof(uint8_t))
-        {
-            uint8_t * __restrict dest = static_cast<uint8_t*>(pDestination);
-            for (size_t i = 0; i < count; ++i)
+        case XBOX_DXGI_FORMAT_R4G4_UNORM:
+            if (size >= sizeof(uint8_t))
             {
-                auto index = static_cast<ptrdiff_t>((y & 1) ? (count - i - 1) : i);
-                ptrdiff_t delta = (y & 1) ? -2 : 0;
+                uint8_t * __restrict dest = static_cast<uint8_t*>(pDestination);
+                for (size_t i = 0; i < count; ++i)
+                {
+                    auto index = static_cast<ptrdiff_t>((y & 1) ? (count - i - 1) : i);
+                    ptrdiff_t delta = (y & 1) ? -2 : 0;
 
-                XMVECTOR v = XMVectorSaturate(sPtr[index]);
-                v = XMVectorAdd(v, vError);
-                v = XMVectorMultiply(v, g_Scale4pc);
+                    XMVECTOR v = XMVectorSaturate(sPtr[index]);
+                    v = XMVectorAdd(v, vError);
+                    v = XMVectorMultiply(v, g_Scale4pc);
 
-                XMVECTOR target;
-                if (pDiffusionErrors)
-                {
-                    target = XMVectorRound(v);
-                    vError = XMVectorSubtract(v, target);
-                    vError = XMVectorDivide(vError, g_Scale4pc);
-
-                    // Distribute error to next scanline and next pixel
-                    pDiffusionErrors[index - delta]     = XMVectorMultiplyAdd(g_ErrorWeight3, vError, pDiffusionErrors[index - delta]);
-                    pDiffusionErrors[index + 1]         = XMVectorMultiplyAdd(g_ErrorWeight5, vError, pDiffusionErrors[index + 1]);
-                    pDiffusionErrors[index + 2 + delta] = XMVectorMultiplyAdd(g_ErrorWeight1, vError, pDiffusionErrors[index + 2 + delta]);
-                    vError = XMVectorMultiply(vError, g_ErrorWeight7);
-                }
-                else
-                {
-                    // Applied ordered dither
-                    target = XMVectorAdd(v, ordered[index & 3]);
-                    target = XMVectorRound(target);
-                }
+                    XMVECTOR target;
+                    if (pDiffusionErrors)
+                    {
+                        target = XMVectorRound(v);
+                        vError = XMVectorSubtract(v, target);
+                        vError = XMVectorDivide(vError, g_Scale4pc);
+
+                        // Distribute error to next scanline and next pixel
+                        pDiffusionErrors[index - delta]     = XMVectorMultiplyAdd(g_ErrorWeight3, vError, pDiffusionErrors[index - delta]);
+                        pDiffusionErrors[index + 1]         = XMVectorMultiplyAdd(g_ErrorWeight5, vError, pDiffusionErrors[index + 1]);
+                        pDiffusionErrors[index + 2 + delta] = XMVectorMultiplyAdd(g_ErrorWeight1, vError, pDiffusionErrors[index + 2 + delta]);
+                        vError = XMVectorMultiply(vError, g_ErrorWeight7);
+                    }
+                    else
+                    {
+                        // Applied ordered dither
+                        target = XMVectorAdd(v, ordered[index & 3]);
+                        target = XMVectorRound(target);
+                    }
 
-                target = XMVectorClamp(target, g_XMZero, g_Scale4pc);
+                    target = XMVectorClamp(target, g_XMZero, g_Scale4pc);
 
-                XMFLOAT4A tmp;
-                XMStoreFloat4A(&tmp, target);
+                    XMFLOAT4A tmp;
+                    XMStoreFloat4A(&tmp, target);
 
-                auto dPtr = &dest[index];
-                if (dPtr >= ePtr) break;
-                *dPtr = static_cast<uint8_t>((unsigned(tmp.x) & 0xF) | ((unsigned(tmp.y) & 0xF) << 4));
+                    auto dPtr = &dest[index];
+                    if (dPtr >= ePtr) break;
+                    *dPtr = static_cast<uint8_t>((unsigned(tmp.x) & 0xF) | ((unsigned(tmp.y) & 0xF) << 4));
+                }
+                return true;
             }
-            return true;
-        }
-        return false;
+            return false;
 
-    default:
-        return _StoreScanline(pDestination, size, format, pSource, count, threshold);
+        default:
+            return _StoreScanline(pDestination, size, format, pSource, count, threshold);
+        }
     }
 }
 
 #pragma warning(pop)
 
+_Use_decl_annotations_
+bool DirectX::_StoreScanlineDither(
+    void* pDestination,
+    size_t size,
+    DXGI_FORMAT format,
+    XMVECTOR* pSource,
+    size_t count,
+    float threshold,
+    size_t y,
+    size_t z,
+    XMVECTOR* pDiffusionErrors)
+{
+    assert(pDestination && size > 0);
+    assert(pSource && count > 0 && ((reinterpret_cast<uintptr_t>(pSource) & 0xF) == 0));
+    assert(IsValid(format) && !IsTypeless(format) && !IsCompressed(format) && !IsPlanar(format) && !IsPalettized(format));
+
+    XMVECTOR ordered[4];
+    if (pDiffusionErrors)
+    {
+        // If pDiffusionErrors != 0, then this function performs error diffusion dithering (aka Floyd-Steinberg dithering)
+
+        // To avoid the need for another temporary scanline buffer, we allow this function to overwrite the source buffer in-place
+        // Given the intended usage in the conversion routines, this is not a problem.
+
+        XMVECTOR* ptr = pSource;
+        const XMVECTOR* err = pDiffusionErrors + 1;
+        for (size_t i = 0; i < count; ++i)
+        {
+            // Add contribution from previous scanline
+            XMVECTOR v = XMVectorAdd(*ptr, *err++);
+            *ptr++ = v;
+        }
+
+        // Reset errors for next scanline
+        memset(pDiffusionErrors, 0, sizeof(XMVECTOR)*(count + 2));
+    }
+    else
+    {
+        // If pDiffusionErrors == 0, then this function performs ordered dithering
+
+        XMVECTOR dither = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(g_Dither + (z & 3) + ((y & 3) * 8)));
+
+        ordered[0] = XMVectorSplatX(dither);
+        ordered[1] = XMVectorSplatY(dither);
+        ordered[2] = XMVectorSplatZ(dither);
+        ordered[3] = XMVectorSplatW(dither);
+    }
+
+    XMVECTOR vError = XMVectorZero();
+
+    return StoreScanlineDither(pDestination, size, format, pSource, count, threshold, y, ordered, pDiffusionErrors, vError);
+}
+
 #undef STORE_SCANLINE
 #undef STORE_SCANLINE2
 #undef STORE_SCANLINE1
@@ -4559,6 +4680,149 @@ namespace
     }
 
 
+    //-------------------------------------------------------------------------------------
+    // Error diffusion of an image
+    //-------------------------------------------------------------------------------------
+
+    // Every scanline is diffused left to right, so a pixel only needs the scanline above it to be two pixels
+    // further along (a serpentine walk needs the whole scanline above to be done). The scanlines are dealt out to
+    // the threads in turn, and each one follows the scanline above it a segment at a time, publishing its own
+    // progress after each segment. Loading and converting a scanline doesn't depend on the error, so that is done
+    // before waiting. The result is the same for any number of threads.
+    const size_t c_DiffusionSegment = 64;
+
+    HRESULT DiffuseImage(
+        _In_ const Image& srcImage,
+        _In_ DWORD filter,
+        _In_ const Image& destImage,
+        _In_ float threshold)
+    {
+        const size_t width = srcImage.width;
+        const size_t height = srcImage.height;
+
+        // Segments are addressed by byte offset within a scanline, otherwise a scanline is one segment
+        size_t bpp = BitsPerPixel(destImage.format);
+        const size_t segment = (IsPacked(destImage.format) || !bpp || (bpp % 8) != 0) ? width : std::min(c_DiffusionSegment, width);
+        bpp /= 8;
+
+        size_t threads = 1;
+#ifdef _OPENMP
+        if (height > 1 && _UseParallel())
+        {
+            threads = std::min<size_t>(static_cast<size_t>(omp_get_max_threads()), height);
+        }
+#endif
+
+        // Scanline y adds the errors in slot (y % slots) and diffuses into the next slot. No more than 'threads'
+        // scanlines are in flight, so a slot is only cleared after the scanline that read it has finished.
+        const size_t slots = threads + 1;
+
+        ScopedAlignedArrayXMVECTOR errors(static_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * (width + 2) * slots, 16)));
+        if (!errors)
+            return E_OUTOFMEMORY;
+
+        // Progress of scanline y is published as y * (width + 1) + pixels done, so a slot still holding the progress
+        // of an earlier scanline always reads as behind
+        std::unique_ptr<size_t[]> progressSlots(new (std::nothrow) size_t[slots]);
+        if (!progressSlots)
+            return E_OUTOFMEMORY;
+
+        volatile size_t* progress = progressSlots.get();
+        for (size_t j = 0; j < slots; ++j)
+        {
+            progress[j] = 0;
+        }
+
+        memset(errors.get(), 0, sizeof(XMVECTOR) * (width + 2));
+
+        bool fail = false;
+        bool outOfMemory = false;
+
+        auto diffuseScanline = [&](size_t y, XMVECTOR* scanline) -> bool
+        {
+            if (!_LoadScanline(scanline, width, srcImage.pixels + srcImage.rowPitch * y, srcImage.rowPitch, srcImage.format))
+                return false;
+
+            _ConvertScanline(scanline, width, destImage.format, srcImage.format, filter);
+
+            const XMVECTOR* errorsIn = errors.get() + (width + 2) * (y % slots);
+            XMVECTOR* errorsOut = errors.get() + (width + 2) * ((y + 1) % slots);
+            memset(errorsOut, 0, sizeof(XMVECTOR) * (width + 2));
+
+            uint8_t* pDest = destImage.pixels + destImage.rowPitch * y;
+            XMVECTOR vError = XMVectorZero();
+
+            for (size_t x = 0; x < width; x += segment)
+            {
+                const size_t count = std::min(segment, width - x);
+
+#ifdef _OPENMP
+                if (y > 0)
+                {
+                    // The last pixel of the segment takes error from one pixel past it in the scanline above
+                    const size_t needed = (y - 1) * (width + 1) + std::min(x + count + 1, width);
+                    while (progress[(y - 1) % slots] < needed && !fail)
+                    {
+                        YieldProcessor();
+#pragma omp flush
+                    }
+#pragma omp flush
+                }
+#endif
+
+                // Add contribution from previous scanline
+                for (size_t i = x; i < x + count; ++i)
+                {
+                    scanline[i] = XMVectorAdd(scanline[i], errorsIn[i + 1]);
+                }
+
+                if (!StoreScanlineDither(pDest + x * bpp, destImage.rowPitch - x * bpp, destImage.format,
+                    scanline + x, count, threshold, 0, nullptr, errorsOut + x, vError))
+                    return false;
+
+#ifdef _OPENMP
+#pragma omp flush
+#endif
+                progress[y % slots] = y * (width + 1) + x + count;
+            }
+
+            return true;
+        };
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(static_cast<int>(threads)) if (threads > 1)
+#endif
+        {
+            ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * width, 16)));
+            if (!scanline)
+            {
+                outOfMemory = true;
+                fail = true;
+            }
+
+#ifdef _OPENMP
+#pragma omp for schedule(static, 1)
+#endif
+            for (int y = 0; y < static_cast<int>(height); ++y)
+            {
+                if (!fail && !diffuseScanline(size_t(y), scanline.get()))
+                    fail = true;
+
+                // Release the scanline below even if this one failed
+#ifdef _OPENMP
+#pragma omp flush
+#endif
+                progress[size_t(y) % slots] = size_t(y) * (width + 1) + width;
+            }
+        }
+
+        if (outOfMemory)
+            return E_OUTOFMEMORY;
+
+        return (fail) ? E_FAIL : S_OK;
+    }
+
+
     //-------------------------------------------------------------------------------------
     // Convert the source image (not using WIC)
     //-------------------------------------------------------------------------------------
@@ -4582,26 +4846,7 @@ namespace
         if (filter & TEX_FILTER_DITHER_DIFFUSION)
         {
             // Error diffusion dithering (aka Floyd-Steinberg dithering)
-            ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc((sizeof(XMVECTOR)*(width * 2 + 2)), 16)));
-            if (!scanline)
-                return E_OUTOFMEMORY;
-
-            XMVECTOR* pDiffusionErrors = scanline.get() + width;
-            memset(pDiffusionErrors, 0, sizeof(XMVECTOR)*(width + 2));
-
-            for (size_t h = 0; h < srcImage.height; ++h)
-            {
-                if (!_LoadScanline(scanline.get(), width, pSrc, srcImage.rowPitch, srcImage.format))
-                    return E_FAIL;
-
-                _ConvertScanline(scanline.get(), width, destImage.format, srcImage.format, filter);
-
-                if (!_StoreScanlineDither(pDest, destImage.rowPitch, destImage.format, scanline.get(), width, threshold, h, z, pDiffusionErrors))
-                    return E_FAIL;
-
-                pSrc += srcImage.rowPitch;
-                pDest += destImage.rowPitch;
-            }
+            return DiffuseImage(srcImage, filter, destImage, threshold);
         }
         else
         {
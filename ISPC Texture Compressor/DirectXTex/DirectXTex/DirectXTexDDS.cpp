@@ -13,6 +13,15 @@
 
 #include "dds.h"
 
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+#define USE_FILE_MAPPING
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#pragma warning(disable : 4616 6993)
+#endif
+
 using namespace DirectX;
 
 static_assert(static_cast<int>(TEX_DIMENSION_TEXTURE1D) == static_cast<int>(DDS_DIMENSION_TEXTURE1D), "header enum mismatch");
@@ -514,6 +523,86 @@ namespace
 
         return S_OK;
     }
+
+
+    //-------------------------------------------------------------------------------------
+    // Opens a DDS file, validates its size, and decodes its header
+    // (leaves the file positioned at the start of the palette or pixel data)
+    //-------------------------------------------------------------------------------------
+    HRESULT OpenDDSFile(
+        _In_z_ const wchar_t* szFile,
+        DWORD fileFlags,
+        DWORD flags,
+        _Out_ ScopedHandle& hFile,
+        _Out_ FILE_STANDARD_INFO& fileInfo,
+        _Out_ TexMetadata& metadata,
+        _Out_ DWORD& convFlags,
+        _Out_ DWORD& headerSize)
+    {
+        convFlags = 0;
+        headerSize = 0;
+
+#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+        UNREFERENCED_PARAMETER(fileFlags);
+        hFile.reset(safe_handle(CreateFile2(szFile, GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr)));
+#else
+        hFile.reset(safe_handle(CreateFileW(szFile, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            fileFlags, nullptr)));
+#endif
+
+        if (!hFile)
+        {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+
+        // Get the file size
+        if (!GetFileInformationByHandleEx(hFile.get(), FileStandardInfo, &fileInfo, sizeof(fileInfo)))
+        {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+
+        // File is too big for 32-bit allocation, so reject read (4 GB should be plenty large enough for a valid DDS file)
+        if (fileInfo.EndOfFile.HighPart > 0)
+        {
+            return HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE);
+        }
+
+        // Need at least enough data to fill the standard header and magic number to be a valid DDS
+        if (fileInfo.EndOfFile.LowPart < (sizeof(DDS_HEADER) + sizeof(uint32_t)))
+        {
+            return E_FAIL;
+        }
+
+        // Read the header in (including extended header if present)
+        const size_t MAX_HEADER_SIZE = sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10);
+        uint8_t header[MAX_HEADER_SIZE] = {};
+
+        DWORD bytesRead = 0;
+        if (!ReadFile(hFile.get(), header, MAX_HEADER_SIZE, &bytesRead, nullptr))
+        {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+
+        HRESULT hr = DecodeDDSHeader(header, bytesRead, flags, metadata, convFlags);
+        if (FAILED(hr))
+            return hr;
+
+        headerSize = MAX_HEADER_SIZE;
+
+        if (!(convFlags & CONV_FLAGS_DX10))
+        {
+            // Must reset file position since we read more than the standard header above
+            LARGE_INTEGER filePos = { { sizeof(uint32_t) + sizeof(DDS_HEADER), 0 } };
+            if (!SetFilePointerEx(hFile.get(), filePos, nullptr, FILE_BEGIN))
+            {
+                return HRESULT_FROM_WIN32(GetLastError());
+            }
+
+            headerSize = sizeof(uint32_t) + sizeof(DDS_HEADER);
+        }
+
+        return S_OK;
+    }
 }
 
 
@@ -858,7 +947,25 @@ namespace
                     const uint8_t* __restrict sPtr = static_cast<const uint8_t*>(pSource);
                     uint32_t * __restrict dPtr = static_cast<uint32_t*>(pDestination);
 
-                    for (size_t ocount = 0, icount = 0; ((icount < inSize) && (ocount < (outSize - 3))); ++icount, ocount += 4)
+                    size_t icount = 0, ocount = 0;
+#if defined(_XM_SSE_INTRINSICS_)
+                    {
+                        size_t n = _ExpandPixels8To32(dPtr, sPtr, std::min<size_t>(inSize, outSize / 4), [](__m128i t) -> __m128i
+                        {
+                            __m128i t1 = _mm_or_si128(_mm_or_si128(_mm_and_si128(t, _mm_set1_epi32(0xe0)), _mm_srli_epi32(_mm_and_si128(t, _mm_set1_epi32(0xe0)), 3)), _mm_srli_epi32(_mm_and_si128(t, _mm_set1_epi32(0xc0)), 6));
+                            __m128i t2 = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x1c)), 11), _mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x1c)), 8)), _mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x18)), 5));
+                            __m128i b = _mm_and_si128(t, _mm_set1_epi32(0x03));
+                            __m128i t3 = _mm_or_si128(_mm_or_si128(_mm_or_si128(_mm_slli_epi32(b, 22), _mm_slli_epi32(b, 20)), _mm_slli_epi32(b, 18)), _mm_slli_epi32(b, 16));
+                            return _mm_or_si128(_mm_or_si128(_mm_or_si128(t1, t2), t3), _mm_set1_epi32(static_cast<int>(0xff000000)));
+                        });
+                        sPtr += n;
+                        dPtr += n;
+                        icount = n;
+                        ocount = n * 4;
+                    }
+#endif
+
+                    for (; ((icount < inSize) && (ocount < (outSize - 3))); ++icount, ocount += 4)
                     {
                         uint8_t t = *(sPtr++);
 
@@ -907,7 +1014,28 @@ namespace
                 const uint16_t* __restrict sPtr = static_cast<const uint16_t*>(pSource);
                 uint32_t * __restrict dPtr = static_cast<uint32_t*>(pDestination);
 
-                for (size_t ocount = 0, icount = 0; ((icount < (inSize - 1)) && (ocount < (outSize - 3))); icount += 2, ocount += 4)
+                size_t icount = 0, ocount = 0;
+#if defined(_XM_SSE_INTRINSICS_)
+                {
+                    const __m128i amask = _mm_set1_epi32((flags & TEXP_SCANLINE_SETALPHA) ? 0 : 0xff00);
+                    const __m128i aset = _mm_set1_epi32((flags & TEXP_SCANLINE_SETALPHA) ? static_cast<int>(0xff000000) : 0);
+                    size_t n = _ExpandPixels16To32(dPtr, sPtr, std::min<size_t>(inSize / 2, outSize / 4), [=](__m128i t) -> __m128i
+                    {
+                        __m128i t1 = _mm_or_si128(_mm_or_si128(_mm_and_si128(t, _mm_set1_epi32(0xe0)), _mm_srli_epi32(_mm_and_si128(t, _mm_set1_epi32(0xe0)), 3)), _mm_srli_epi32(_mm_and_si128(t, _mm_set1_epi32(0xc0)), 6));
+                        __m128i t2 = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x1c)), 11), _mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x1c)), 8)), _mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x18)), 5));
+                        __m128i b = _mm_and_si128(t, _mm_set1_epi32(0x03));
+                        __m128i t3 = _mm_or_si128(_mm_or_si128(_mm_or_si128(_mm_slli_epi32(b, 22), _mm_slli_epi32(b, 20)), _mm_slli_epi32(b, 18)), _mm_slli_epi32(b, 16));
+                        __m128i ta = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(t, amask), 16), aset);
+                        return _mm_or_si128(_mm_or_si128(_mm_or_si128(t1, t2), t3), ta);
+                    });
+                    sPtr += n;
+                    dPtr += n;
+                    icount = n * 2;
+                    ocount = n * 4;
+                }
+#endif
+
+                for (; ((icount < (inSize - 1)) && (ocount < (outSize - 3))); icount += 2, ocount += 4)
                 {
                     uint16_t t = *(sPtr++);
 
@@ -995,7 +1123,26 @@ namespace
                     const uint8_t * __restrict sPtr = static_cast<const uint8_t*>(pSource);
                     uint32_t * __restrict dPtr = static_cast<uint32_t*>(pDestination);
 
-                    for (size_t ocount = 0, icount = 0; ((icount < inSize) && (ocount < (outSize - 3))); ++icount, ocount += 4)
+                    size_t icount = 0, ocount = 0;
+#if defined(_XM_SSE_INTRINSICS_)
+                    {
+                        const __m128i amask = _mm_set1_epi32((flags & TEXP_SCANLINE_SETALPHA) ? 0 : 0xf0);
+                        const __m128i aset = _mm_set1_epi32((flags & TEXP_SCANLINE_SETALPHA) ? static_cast<int>(0xff000000) : 0);
+                        size_t n = _ExpandPixels8To32(dPtr, sPtr, std::min<size_t>(inSize, outSize / 4), [=](__m128i t) -> __m128i
+                        {
+                            __m128i t1 = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x0f)), 4), _mm_and_si128(t, _mm_set1_epi32(0x0f)));
+                            __m128i a = _mm_and_si128(t, amask);
+                            __m128i ta = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(a, 24), _mm_slli_epi32(a, 20)), aset);
+                            return _mm_or_si128(_mm_or_si128(_mm_or_si128(t1, _mm_slli_epi32(t1, 8)), _mm_slli_epi32(t1, 16)), ta);
+                        });
+                        sPtr += n;
+                        dPtr += n;
+                        icount = n;
+                        ocount = n * 4;
+                    }
+#endif
+
+                    for (; ((icount < inSize) && (ocount < (outSize - 3))); ++icount, ocount += 4)
                     {
                         uint8_t t = *(sPtr++);
 
@@ -1022,7 +1169,28 @@ namespace
                 const uint16_t * __restrict sPtr = static_cast<const uint16_t*>(pSource);
                 uint32_t * __restrict dPtr = static_cast<uint32_t*>(pDestination);
 
-                for (size_t ocount = 0, icount = 0; ((icount < (inSize - 1)) && (ocount < (outSize - 3))); icount += 2, ocount += 4)
+                size_t icount = 0, ocount = 0;
+#if defined(_XM_SSE_INTRINSICS_)
+                {
+                    const __m128i amask = _mm_set1_epi32((flags & TEXP_SCANLINE_SETALPHA) ? 0 : 0xf000);
+                    const __m128i aset = _mm_set1_epi32((flags & TEXP_SCANLINE_SETALPHA) ? static_cast<int>(0xff000000) : 0);
+                    size_t n = _ExpandPixels16To32(dPtr, sPtr, std::min<size_t>(inSize / 2, outSize / 4), [=](__m128i t) -> __m128i
+                    {
+                        __m128i t1 = _mm_or_si128(_mm_srli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x0f00)), 4), _mm_srli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x0f00)), 8));
+                        __m128i t2 = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x00f0)), 8), _mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x00f0)), 4));
+                        __m128i t3 = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x000f)), 20), _mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x000f)), 16));
+                        __m128i a = _mm_and_si128(t, amask);
+                        __m128i ta = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(a, 16), _mm_slli_epi32(a, 12)), aset);
+                        return _mm_or_si128(_mm_or_si128(_mm_or_si128(t1, t2), t3), ta);
+                    });
+                    sPtr += n;
+                    dPtr += n;
+                    icount = n * 2;
+                    ocount = n * 4;
+                }
+#endif
+
+                for (; ((icount < (inSize - 1)) && (ocount < (outSize - 3))); icount += 2, ocount += 4)
                 {
                     uint16_t t = *(sPtr++);
 
@@ -1047,7 +1215,31 @@ namespace
                 const uint8_t * __restrict sPtr = static_cast<const uint8_t*>(pSource);
                 uint32_t * __restrict dPtr = static_cast<uint32_t*>(pDestination);
 
-                for (size_t ocount = 0, icount = 0; ((icount < inSize) && (ocount < (outSize - 3))); ++icount, ocount += 4)
+                size_t icount = 0, ocount = 0;
+#if defined(_XM_SSE_INTRINSICS_)
+                {
+                    const __m128i opaque = _mm_set1_epi8(static_cast<char>(0xff));
+                    const size_t n = std::min<size_t>(inSize, outSize / 4) & ~size_t(15);
+                    for (size_t i = 0; i < n; i += 16)
+                    {
+                        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sPtr + i));
+                        __m128i ll = _mm_unpacklo_epi8(v, v);
+                        __m128i la = _mm_unpacklo_epi8(v, opaque);
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr + i), _mm_unpacklo_epi16(ll, la));
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr + i + 4), _mm_unpackhi_epi16(ll, la));
+                        ll = _mm_unpackhi_epi8(v, v);
+                        la = _mm_unpackhi_epi8(v, opaque);
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr + i + 8), _mm_unpacklo_epi16(ll, la));
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr + i + 12), _mm_unpackhi_epi16(ll, la));
+                    }
+                    sPtr += n;
+                    dPtr += n;
+                    icount = n;
+                    ocount = n * 4;
+                }
+#endif
+
+                for (; ((icount < inSize) && (ocount < (outSize - 3))); ++icount, ocount += 4)
                 {
                     uint32_t t1 = *(sPtr++);
                     uint32_t t2 = (t1 << 8);
@@ -1069,7 +1261,31 @@ namespace
                 const uint16_t* __restrict sPtr = static_cast<const uint16_t*>(pSource);
                 uint64_t * __restrict dPtr = static_cast<uint64_t*>(pDestination);
 
-                for (size_t ocount = 0, icount = 0; ((icount < (inSize - 1)) && (ocount < (outSize - 7))); icount += 2, ocount += 8)
+                size_t icount = 0, ocount = 0;
+#if defined(_XM_SSE_INTRINSICS_)
+                {
+                    const __m128i opaque = _mm_set1_epi16(static_cast<short>(0xffff));
+                    const size_t n = std::min<size_t>(inSize / 2, outSize / 8) & ~size_t(7);
+                    for (size_t i = 0; i < n; i += 8)
+                    {
+                        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sPtr + i));
+                        __m128i ll = _mm_unpacklo_epi16(v, v);
+                        __m128i la = _mm_unpacklo_epi16(v, opaque);
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr + i), _mm_unpacklo_epi32(ll, la));
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr + i + 2), _mm_unpackhi_epi32(ll, la));
+                        ll = _mm_unpackhi_epi16(v, v);
+                        la = _mm_unpackhi_epi16(v, opaque);
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr + i + 4), _mm_unpacklo_epi32(ll, la));
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr + i + 6), _mm_unpackhi_epi32(ll, la));
+                    }
+                    sPtr += n;
+                    dPtr += n;
+                    icount = n * 2;
+                    ocount = n * 8;
+                }
+#endif
+
+                for (; ((icount < (inSize - 1)) && (ocount < (outSize - 7))); icount += 2, ocount += 8)
                 {
                     uint16_t t = *(sPtr++);
 
@@ -1093,7 +1309,29 @@ namespace
                 const uint16_t* __restrict sPtr = static_cast<const uint16_t*>(pSource);
                 uint32_t * __restrict dPtr = static_cast<uint32_t*>(pDestination);
 
-                for (size_t ocount = 0, icount = 0; ((icount < (inSize - 1)) && (ocount < (outSize - 3))); icount += 2, ocount += 4)
+                size_t icount = 0, ocount = 0;
+#if defined(_XM_SSE_INTRINSICS_)
+                {
+                    const __m128i lmask = _mm_set1_epi16(0x00ff);
+                    const __m128i aset = _mm_set1_epi16((flags & TEXP_SCANLINE_SETALPHA) ? static_cast<short>(0xff00) : 0);
+                    const size_t n = std::min<size_t>(inSize / 2, outSize / 4) & ~size_t(7);
+                    for (size_t i = 0; i < n; i += 8)
+                    {
+                        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sPtr + i));
+                        __m128i l = _mm_and_si128(v, lmask);
+                        __m128i ll = _mm_or_si128(l, _mm_slli_epi16(l, 8));
+                        __m128i la = _mm_or_si128(v, aset);
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr + i), _mm_unpacklo_epi16(ll, la));
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr + i + 4), _mm_unpackhi_epi16(ll, la));
+                    }
+                    sPtr += n;
+                    dPtr += n;
+                    icount = n * 2;
+                    ocount = n * 4;
+                }
+#endif
+
+                for (; ((icount < (inSize - 1)) && (ocount < (outSize - 3))); icount += 2, ocount += 4)
                 {
                     uint16_t t = *(sPtr++);
 
@@ -1114,6 +1352,68 @@ namespace
     }
 
 
+    //-------------------------------------------------------------------------------------
+    // Expands, swizzles, or copies the scanlines of one image; rows are independent so
+    // larger images are split across threads
+    //-------------------------------------------------------------------------------------
+    const size_t c_CopyParallelRows = 64;
+
+    bool CopyScanlines(
+        _Out_writes_bytes_(dpitch * height) uint8_t* pDest,
+        size_t dpitch,
+        _In_reads_bytes_(spitch * height) const uint8_t* pSrc,
+        size_t spitch,
+        size_t height,
+        _In_ DXGI_FORMAT format,
+        _In_ DWORD convFlags,
+        _In_ DWORD tflags,
+        _In_reads_opt_(256) const uint32_t *pal8)
+    {
+        const TEXP_LEGACY_FORMAT lformat = _FindLegacyFormat(convFlags);
+
+        // Each thread clears its own copy of result on a failed row; they are combined after the loop
+        bool result = true;
+
+#ifdef _OPENMP
+#pragma omp parallel for reduction(&&:result) if (height >= c_CopyParallelRows && _UseParallel())
+#endif
+        for (int y = 0; y < static_cast<int>(height); ++y)
+        {
+            uint8_t* pDestRow = pDest + size_t(y) * dpitch;
+            const uint8_t* pSrcRow = pSrc + size_t(y) * spitch;
+
+            if (convFlags & CONV_FLAGS_EXPAND)
+            {
+                if (convFlags & (CONV_FLAGS_565 | CONV_FLAGS_5551 | CONV_FLAGS_4444))
+                {
+                    if (!_ExpandScanline(pDestRow, dpitch, DXGI_FORMAT_R8G8B8A8_UNORM,
+                        pSrcRow, spitch,
+                        (convFlags & CONV_FLAGS_565) ? DXGI_FORMAT_B5G6R5_UNORM : DXGI_FORMAT_B5G5R5A1_UNORM,
+                        tflags))
+                        result = false;
+                }
+                else
+                {
+                    if (!LegacyExpandScanline(pDestRow, dpitch, format,
+                        pSrcRow, spitch, lformat, pal8,
+                        tflags))
+                        result = false;
+                }
+            }
+            else if (convFlags & CONV_FLAGS_SWIZZLE)
+            {
+                _SwizzleScanline(pDestRow, dpitch, pSrcRow, spitch, format, tflags);
+            }
+            else
+            {
+                _CopyScanline(pDestRow, dpitch, pSrcRow, spitch, format, tflags);
+            }
+        }
+
+        return result;
+    }
+
+
     //-------------------------------------------------------------------------------------
     // Converts or copies image data from pPixels into scratch image data
     //-------------------------------------------------------------------------------------
@@ -1250,41 +1550,9 @@ namespace
                     }
                     else
                     {
-                        for (size_t h = 0; h < images[index].height; ++h)
-                        {
-                            if (convFlags & CONV_FLAGS_EXPAND)
-                            {
-                                if (convFlags & (CONV_FLAGS_565 | CONV_FLAGS_5551 | CONV_FLAGS_4444))
-                                {
-                                    if (!_ExpandScanline(pDest, dpitch, DXGI_FORMAT_R8G8B8A8_UNORM,
-                                        pSrc, spitch,
-                                        (convFlags & CONV_FLAGS_565) ? DXGI_FORMAT_B5G6R5_UNORM : DXGI_FORMAT_B5G5R5A1_UNORM,
-                                        tflags))
-                                        return E_FAIL;
-                                }
-                                else
-                                {
-                                    TEXP_LEGACY_FORMAT lformat = _FindLegacyFormat(convFlags);
-                                    if (!LegacyExpandScanline(pDest, dpitch, metadata.format,
-                                        pSrc, spitch, lformat, pal8,
-                                        tflags))
-                                        return E_FAIL;
-                                }
-                            }
-                            else if (convFlags & CONV_FLAGS_SWIZZLE)
-                            {
-                                _SwizzleScanline(pDest, dpitch, pSrc, spitch,
-                                    metadata.format, tflags);
-                            }
-                            else
-                            {
-                                _CopyScanline(pDest, dpitch, pSrc, spitch,
-                                    metadata.format, tflags);
-                            }
-
-                            pSrc += spitch;
-                            pDest += dpitch;
-                        }
+                        if (!CopyScanlines(pDest, dpitch, pSrc, spitch, images[index].height,
+                            metadata.format, convFlags, tflags, pal8))
+                            return E_FAIL;
                     }
                 }
             }
@@ -1343,39 +1611,9 @@ namespace
                     }
                     else
                     {
-                        for (size_t h = 0; h < images[index].height; ++h)
-                        {
-                            if (convFlags & CONV_FLAGS_EXPAND)
-                            {
-                                if (convFlags & (CONV_FLAGS_565 | CONV_FLAGS_5551 | CONV_FLAGS_4444))
-                                {
-                                    if (!_ExpandScanline(pDest, dpitch, DXGI_FORMAT_R8G8B8A8_UNORM,
-                                        pSrc, spitch,
-                                        (convFlags & CONV_FLAGS_565) ? DXGI_FORMAT_B5G6R5_UNORM : DXGI_FORMAT_B5G5R5A1_UNORM,
-                                        tflags))
-                                        return E_FAIL;
-                                }
-                                else
-                                {
-                                    TEXP_LEGACY_FORMAT lformat = _FindLegacyFormat(convFlags);
-                                    if (!LegacyExpandScanline(pDest, dpitch, metadata.format,
-                                        pSrc, spitch, lformat, pal8,
-                                        tflags))
-                                        return E_FAIL;
-                                }
-                            }
-                            else if (convFlags & CONV_FLAGS_SWIZZLE)
-                            {
-                                _SwizzleScanline(pDest, dpitch, pSrc, spitch, metadata.format, tflags);
-                            }
-                            else
-                            {
-                                _CopyScanline(pDest, dpitch, pSrc, spitch, metadata.format, tflags);
-                            }
-
-                            pSrc += spitch;
-                            pDest += dpitch;
-                        }
+                        if (!CopyScanlines(pDest, dpitch, pSrc, spitch, images[index].height,
+                            metadata.format, convFlags, tflags, pal8))
+                            return E_FAIL;
                     }
                 }
 
@@ -1419,19 +1657,122 @@ namespace
 
             size_t rowPitch = img->rowPitch;
 
-            for (size_t h = 0; h < img->height; ++h)
+            (void)CopyScanlines(pPixels, rowPitch, pPixels, rowPitch, img->height,
+                metadata.format, convFlags & ~CONV_FLAGS_EXPAND, tflags, nullptr);
+        }
+
+        return S_OK;
+    }
+
+    //-------------------------------------------------------------------------------------
+    // Gathers file writes into large blocks, so many small images or pitch-converted
+    // scanlines turn into a few big WriteFile calls. Large contiguous writes go straight
+    // to the file once the pending data is flushed.
+    //-------------------------------------------------------------------------------------
+    const size_t c_WriteBufferSize = 4 * 1024 * 1024;
+
+    class BufferedFileWriter
+    {
+    public:
+        explicit BufferedFileWriter(HANDLE hFile) : m_hFile(hFile), m_used(0) {}
+
+        BufferedFileWriter(const BufferedFileWriter&) = delete;
+        BufferedFileWriter& operator=(const BufferedFileWriter&) = delete;
+
+        HRESULT Initialize()
+        {
+            m_buffer.reset(static_cast<uint8_t*>(_aligned_malloc(c_WriteBufferSize, 4096)));
+            return (m_buffer) ? S_OK : E_OUTOFMEMORY;
+        }
+
+        HRESULT Write(_In_reads_bytes_(size) const void* pData, size_t size)
+        {
+            auto ptr = static_cast<const uint8_t*>(pData);
+
+            if (m_used + size > c_WriteBufferSize)
+            {
+                HRESULT hr = Flush();
+                if (FAILED(hr))
+                    return hr;
+
+                if (size >= c_WriteBufferSize)
+                    return WriteDirect(ptr, size);
+            }
+
+            memcpy(m_buffer.get() + m_used, ptr, size);
+            m_used += size;
+            return S_OK;
+        }
+
+        HRESULT Flush()
+        {
+            if (!m_used)
+                return S_OK;
+
+            HRESULT hr = WriteDirect(m_buffer.get(), m_used);
+            m_used = 0;
+            return hr;
+        }
+
+    private:
+        HRESULT WriteDirect(_In_reads_bytes_(size) const uint8_t* ptr, size_t size)
+        {
+            while (size > 0)
             {
-                if (convFlags & CONV_FLAGS_SWIZZLE)
+                DWORD chunk = static_cast<DWORD>(std::min<size_t>(size, UINT32_MAX & ~size_t(0xFFFF)));
+
+                DWORD bytesWritten;
+                if (!WriteFile(m_hFile, ptr, chunk, &bytesWritten, nullptr))
                 {
-                    _SwizzleScanline(pPixels, rowPitch, pPixels, rowPitch, metadata.format, tflags);
+                    return HRESULT_FROM_WIN32(GetLastError());
                 }
-                else
+
+                if (bytesWritten != chunk)
                 {
-                    _CopyScanline(pPixels, rowPitch, pPixels, rowPitch, metadata.format, tflags);
+                    return E_FAIL;
                 }
 
-                pPixels += rowPitch;
+                ptr += chunk;
+                size -= chunk;
+            }
+
+            return S_OK;
+        }
+
+        HANDLE                      m_hFile;
+        ScopedAlignedArrayUint8     m_buffer;
+        size_t                      m_used;
+    };
+
+    //-------------------------------------------------------------------------------------
+    // Writes a block of data at an absolute file offset
+    // (the offset is passed with each write rather than through the shared file pointer,
+    // so concurrent calls on the same handle do not race)
+    //-------------------------------------------------------------------------------------
+    HRESULT WriteFileAt(_In_ HANDLE hFile, uint64_t offset, _In_reads_bytes_(size) const uint8_t* ptr, size_t size)
+    {
+        while (size > 0)
+        {
+            DWORD chunk = static_cast<DWORD>(std::min<size_t>(size, UINT32_MAX & ~size_t(0xFFFF)));
+
+            OVERLAPPED ov = {};
+            ov.Offset = static_cast<DWORD>(offset);
+            ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+            DWORD bytesWritten;
+            if (!WriteFile(hFile, ptr, chunk, &bytesWritten, &ov))
+            {
+                return HRESULT_FROM_WIN32(GetLastError());
+            }
+
+            if (bytesWritten != chunk)
+            {
+                return E_FAIL;
             }
+
+            ptr += chunk;
+            offset += chunk;
+            size -= chunk;
         }
 
         return S_OK;
@@ -1603,67 +1944,16 @@ HRESULT DirectX::LoadFromDDSFile(
 
     image.Release();
 
-#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
-    ScopedHandle hFile(safe_handle(CreateFile2(szFile, GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr)));
-#else
-    ScopedHandle hFile(safe_handle(CreateFileW(szFile, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
-        FILE_FLAG_SEQUENTIAL_SCAN, nullptr)));
-#endif
-
-    if (!hFile)
-    {
-        return HRESULT_FROM_WIN32(GetLastError());
-    }
-
-    // Get the file size
+    ScopedHandle hFile;
     FILE_STANDARD_INFO fileInfo;
-    if (!GetFileInformationByHandleEx(hFile.get(), FileStandardInfo, &fileInfo, sizeof(fileInfo)))
-    {
-        return HRESULT_FROM_WIN32(GetLastError());
-    }
-
-    // File is too big for 32-bit allocation, so reject read (4 GB should be plenty large enough for a valid DDS file)
-    if (fileInfo.EndOfFile.HighPart > 0)
-    {
-        return HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE);
-    }
-
-    // Need at least enough data to fill the standard header and magic number to be a valid DDS
-    if (fileInfo.EndOfFile.LowPart < (sizeof(DDS_HEADER) + sizeof(uint32_t)))
-    {
-        return E_FAIL;
-    }
-
-    // Read the header in (including extended header if present)
-    const size_t MAX_HEADER_SIZE = sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10);
-    uint8_t header[MAX_HEADER_SIZE] = {};
-
-    DWORD bytesRead = 0;
-    if (!ReadFile(hFile.get(), header, MAX_HEADER_SIZE, &bytesRead, nullptr))
-    {
-        return HRESULT_FROM_WIN32(GetLastError());
-    }
-
-    DWORD convFlags = 0;
     TexMetadata mdata;
-    HRESULT hr = DecodeDDSHeader(header, bytesRead, flags, mdata, convFlags);
+    DWORD convFlags = 0;
+    DWORD offset = 0;
+    HRESULT hr = OpenDDSFile(szFile, FILE_FLAG_SEQUENTIAL_SCAN, flags, hFile, fileInfo, mdata, convFlags, offset);
     if (FAILED(hr))
         return hr;
 
-    DWORD offset = MAX_HEADER_SIZE;
-
-    if (!(convFlags & CONV_FLAGS_DX10))
-    {
-        // Must reset file position since we read more than the standard header above
-        LARGE_INTEGER filePos = { { sizeof(uint32_t) + sizeof(DDS_HEADER), 0 } };
-        if (!SetFilePointerEx(hFile.get(), filePos, nullptr, FILE_BEGIN))
-        {
-            return HRESULT_FROM_WIN32(GetLastError());
-        }
-
-        offset = sizeof(uint32_t) + sizeof(DDS_HEADER);
-    }
-
+    DWORD bytesRead = 0;
     std::unique_ptr<uint32_t[]> pal8;
     if (convFlags & CONV_FLAGS_PAL8)
     {
@@ -1690,6 +1980,23 @@ HRESULT DirectX::LoadFromDDSFile(
     if (remaining == 0)
         return E_FAIL;
 
+#ifdef USE_FILE_MAPPING
+    if ((flags & DDS_FLAGS_MEMORY_MAPPED)
+        && !(convFlags & (CONV_FLAGS_EXPAND | CONV_FLAGS_SWIZZLE | CONV_FLAGS_NOALPHA | CONV_FLAGS_PAL8))
+        && !(flags & (DDS_FLAGS_LEGACY_DWORD | DDS_FLAGS_BAD_DXTN_TAILS)))
+    {
+        // Payload is used as-is, so point the images into a view of the file instead of reading it
+        hr = image.InitializeFromMappedFile(mdata, hFile.get(), offset);
+        if (FAILED(hr))
+            return hr;
+
+        if (metadata)
+            memcpy(metadata, &mdata, sizeof(TexMetadata));
+
+        return S_OK;
+    }
+#endif
+
     hr = image.Initialize(mdata);
     if (FAILED(hr))
         return hr;
@@ -1778,7 +2085,199 @@ HRESULT DirectX::LoadFromDDSFile(
 
 
 //-------------------------------------------------------------------------------------
-// Save a DDS file to memory
+// Load a subset of the mips and array items of a DDS file
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::LoadFromDDSFile(
+    const wchar_t* szFile,
+    DWORD flags,
+    size_t mipStart,
+    size_t mipCount,
+    size_t itemStart,
+    size_t itemCount,
+    TexMetadata* metadata,
+    ScratchImage& image)
+{
+    if (!szFile)
+        return E_INVALIDARG;
+
+    image.Release();
+
+    ScopedHandle hFile;
+    FILE_STANDARD_INFO fileInfo;
+    TexMetadata mdata;
+    DWORD convFlags = 0;
+    DWORD headerSize = 0;
+    HRESULT hr = OpenDDSFile(szFile, FILE_FLAG_RANDOM_ACCESS, flags, hFile, fileInfo, mdata, convFlags, headerSize);
+    if (FAILED(hr))
+        return hr;
+
+    size_t items = (mdata.dimension == TEX_DIMENSION_TEXTURE3D) ? 1 : mdata.arraySize;
+
+    if (!mipCount)
+        mipCount = (mipStart < mdata.mipLevels) ? (mdata.mipLevels - mipStart) : 0;
+
+    if (!itemCount)
+        itemCount = (itemStart < items) ? (items - itemStart) : 0;
+
+    if (!mipCount || (mipStart + mipCount) > mdata.mipLevels || !itemCount || (itemStart + itemCount) > items)
+        return E_INVALIDARG;
+
+    // Describe the subset
+    TexMetadata sdata = mdata;
+    sdata.width = std::max<size_t>(1, mdata.width >> mipStart);
+    sdata.height = std::max<size_t>(1, mdata.height >> mipStart);
+    sdata.depth = std::max<size_t>(1, mdata.depth >> mipStart);
+    sdata.mipLevels = mipCount;
+    sdata.arraySize = itemCount;
+
+    if (mdata.IsCubemap() && ((itemStart % 6) != 0 || (itemCount % 6) != 0))
+    {
+        // Not whole cubes, so it is returned as a 2D array
+        sdata.miscFlags &= ~static_cast<uint32_t>(TEX_MISC_TEXTURECUBE);
+    }
+
+    if ((convFlags & (CONV_FLAGS_EXPAND | CONV_FLAGS_PAL8)) || (flags & (DDS_FLAGS_LEGACY_DWORD | DDS_FLAGS_BAD_DXTN_TAILS)))
+    {
+        // The file layout differs from the image layout, so load all of it and keep the subset
+        hFile.reset();
+
+        ScratchImage full;
+        hr = LoadFromDDSFile(szFile, flags & ~static_cast<DWORD>(DDS_FLAGS_MEMORY_MAPPED), nullptr, full);
+        if (FAILED(hr))
+            return hr;
+
+        hr = image.Initialize(sdata);
+        if (FAILED(hr))
+            return hr;
+
+        for (size_t item = 0; item < itemCount; ++item)
+        {
+            const Image* src = full.GetImage(mipStart, itemStart + item, 0);
+            const Image* dest = image.GetImage(0, item, 0);
+            const Image* destNext = (item + 1 < itemCount) ? image.GetImage(0, item + 1, 0) : nullptr;
+            if (!src || !dest)
+            {
+                image.Release();
+                return E_POINTER;
+            }
+
+            // The requested mips of an item are contiguous in both images
+            size_t bytes = destNext ? size_t(destNext->pixels - dest->pixels)
+                : size_t(image.GetPixels() + image.GetPixelsSize() - dest->pixels);
+            memcpy_s(dest->pixels, bytes, src->pixels, bytes);
+        }
+
+        if (metadata)
+            memcpy(metadata, &sdata, sizeof(TexMetadata));
+
+        return S_OK;
+    }
+
+    size_t offset = headerSize;
+
+    // Bytes of each mip level in the file (one item's worth, including all depth slices)
+    std::unique_ptr<size_t[]> levelBytes(new (std::nothrow) size_t[mdata.mipLevels]);
+    if (!levelBytes)
+        return E_OUTOFMEMORY;
+
+    size_t itemBytes = 0;
+    {
+        size_t w = mdata.width;
+        size_t h = mdata.height;
+        size_t d = mdata.depth;
+
+        for (size_t level = 0; level < mdata.mipLevels; ++level)
+        {
+            size_t rowPitch, slicePitch;
+            hr = ComputePitch(mdata.format, w, h, rowPitch, slicePitch, CP_FLAGS_NONE);
+            if (FAILED(hr))
+                return hr;
+
+            levelBytes[level] = slicePitch * d;
+            itemBytes += levelBytes[level];
+
+            if (w > 1)
+                w >>= 1;
+
+            if (h > 1)
+                h >>= 1;
+
+            if (d > 1)
+                d >>= 1;
+        }
+    }
+
+    size_t skipBytes = 0;
+    for (size_t level = 0; level < mipStart; ++level)
+    {
+        skipBytes += levelBytes[level];
+    }
+
+    size_t readBytes = 0;
+    for (size_t level = mipStart; level < mipStart + mipCount; ++level)
+    {
+        readBytes += levelBytes[level];
+    }
+
+    if (uint64_t(offset) + uint64_t(itemBytes) * uint64_t(itemStart + itemCount) > fileInfo.EndOfFile.LowPart)
+        return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+
+    hr = image.Initialize(sdata);
+    if (FAILED(hr))
+        return hr;
+
+    // Seek past everything that is not requested, and read each item's mips with one call
+    for (size_t item = 0; item < itemCount; ++item)
+    {
+        const Image* dest = image.GetImage(0, item, 0);
+        if (!dest)
+        {
+            image.Release();
+            return E_POINTER;
+        }
+
+        LARGE_INTEGER filePos;
+        filePos.QuadPart = static_cast<LONGLONG>(offset + itemBytes * (itemStart + item) + skipBytes);
+        if (!SetFilePointerEx(hFile.get(), filePos, nullptr, FILE_BEGIN))
+        {
+            image.Release();
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+
+        DWORD bytesRead = 0;
+        if (!ReadFile(hFile.get(), dest->pixels, static_cast<DWORD>(readBytes), &bytesRead, nullptr))
+        {
+            image.Release();
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+
+        if (bytesRead != readBytes)
+        {
+            image.Release();
+            return E_FAIL;
+        }
+    }
+
+    if (convFlags & (CONV_FLAGS_SWIZZLE | CONV_FLAGS_NOALPHA))
+    {
+        // Swizzle/copy image in place
+        hr = CopyImageInPlace(convFlags, image);
+        if (FAILED(hr))
+        {
+            image.Release();
+            return hr;
+        }
+    }
+
+    if (metadata)
+        memcpy(metadata, &sdata, sizeof(TexMetadata));
+
+    return S_OK;
+}
+
+//-------------------------------------------------------------------------------------
+// Save a DDS file to memory
 //-------------------------------------------------------------------------------------
 _Use_decl_annotations_
 HRESULT DirectX::SaveToDDSMemory(
@@ -2040,16 +2539,14 @@ HRESULT DirectX::SaveToDDSFile(
 
     auto_delete_file delonfail(hFile.get());
 
-    DWORD bytesWritten;
-    if (!WriteFile(hFile.get(), header, static_cast<DWORD>(required), &bytesWritten, nullptr))
-    {
-        return HRESULT_FROM_WIN32(GetLastError());
-    }
+    BufferedFileWriter writer(hFile.get());
+    hr = writer.Initialize();
+    if (FAILED(hr))
+        return hr;
 
-    if (bytesWritten != required)
-    {
-        return E_FAIL;
-    }
+    hr = writer.Write(header, required);
+    if (FAILED(hr))
+        return hr;
 
     // Write images
     switch (static_cast<DDS_RESOURCE_DIMENSION>(metadata.dimension))
@@ -2076,17 +2573,11 @@ HRESULT DirectX::SaveToDDSFile(
                 if (FAILED(hr))
                     return hr;
 
-                if ((images[index].slicePitch == ddsSlicePitch) && (ddsSlicePitch <= UINT32_MAX))
+                if (images[index].slicePitch == ddsSlicePitch)
                 {
-                    if (!WriteFile(hFile.get(), images[index].pixels, static_cast<DWORD>(ddsSlicePitch), &bytesWritten, nullptr))
-                    {
-                        return HRESULT_FROM_WIN32(GetLastError());
-                    }
-
-                    if (bytesWritten != ddsSlicePitch)
-                    {
-                        return E_FAIL;
-                    }
+                    hr = writer.Write(images[index].pixels, ddsSlicePitch);
+                    if (FAILED(hr))
+                        return hr;
                 }
                 else
                 {
@@ -2097,23 +2588,14 @@ HRESULT DirectX::SaveToDDSFile(
                         return E_FAIL;
                     }
 
-                    if (ddsRowPitch > UINT32_MAX)
-                        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
-
                     const uint8_t * __restrict sPtr = images[index].pixels;
 
                     size_t lines = ComputeScanlines(metadata.format, images[index].height);
                     for (size_t j = 0; j < lines; ++j)
                     {
-                        if (!WriteFile(hFile.get(), sPtr, static_cast<DWORD>(ddsRowPitch), &bytesWritten, nullptr))
-                        {
-                            return HRESULT_FROM_WIN32(GetLastError());
-                        }
-
-                        if (bytesWritten != ddsRowPitch)
-                        {
-                            return E_FAIL;
-                        }
+                        hr = writer.Write(sPtr, ddsRowPitch);
+                        if (FAILED(hr))
+                            return hr;
 
                         sPtr += rowPitch;
                     }
@@ -2149,17 +2631,11 @@ HRESULT DirectX::SaveToDDSFile(
                 if (FAILED(hr))
                     return hr;
 
-                if ((images[index].slicePitch == ddsSlicePitch) && (ddsSlicePitch <= UINT32_MAX))
+                if (images[index].slicePitch == ddsSlicePitch)
                 {
-                    if (!WriteFile(hFile.get(), images[index].pixels, static_cast<DWORD>(ddsSlicePitch), &bytesWritten, nullptr))
-                    {
-                        return HRESULT_FROM_WIN32(GetLastError());
-                    }
-
-                    if (bytesWritten != ddsSlicePitch)
-                    {
-                        return E_FAIL;
-                    }
+                    hr = writer.Write(images[index].pixels, ddsSlicePitch);
+                    if (FAILED(hr))
+                        return hr;
                 }
                 else
                 {
@@ -2170,23 +2646,14 @@ HRESULT DirectX::SaveToDDSFile(
                         return E_FAIL;
                     }
 
-                    if (ddsRowPitch > UINT32_MAX)
-                        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
-
                     const uint8_t * __restrict sPtr = images[index].pixels;
 
                     size_t lines = ComputeScanlines(metadata.format, images[index].height);
                     for (size_t j = 0; j < lines; ++j)
                     {
-                        if (!WriteFile(hFile.get(), sPtr, static_cast<DWORD>(ddsRowPitch), &bytesWritten, nullptr))
-                        {
-                            return HRESULT_FROM_WIN32(GetLastError());
-                        }
-
-                        if (bytesWritten != ddsRowPitch)
-                        {
-                            return E_FAIL;
-                        }
+                        hr = writer.Write(sPtr, ddsRowPitch);
+                        if (FAILED(hr))
+                            return hr;
 
                         sPtr += rowPitch;
                     }
@@ -2203,7 +2670,326 @@ HRESULT DirectX::SaveToDDSFile(
         return E_FAIL;
     }
 
+    hr = writer.Flush();
+    if (FAILED(hr))
+        return hr;
+
     delonfail.clear();
 
     return S_OK;
 }
+
+
+//=====================================================================================
+// DDSFileWriter
+//=====================================================================================
+
+//-------------------------------------------------------------------------------------
+// Creates the file, writes the header and reserves space for all of the image data
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DDSFileWriter::Create(const wchar_t* szFile, const TexMetadata& metadata, DWORD flags)
+{
+    if (!szFile)
+        return E_INVALIDARG;
+
+    Release();
+
+    if (!metadata.mipLevels || !metadata.arraySize)
+        return E_INVALIDARG;
+
+    if (metadata.dimension == TEX_DIMENSION_TEXTURE3D && metadata.arraySize != 1)
+        return E_INVALIDARG;
+
+    // Create DDS Header
+    const size_t MAX_HEADER_SIZE = sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10);
+    uint8_t header[MAX_HEADER_SIZE];
+    size_t required;
+    HRESULT hr = _EncodeDDSHeader(metadata, flags, header, MAX_HEADER_SIZE, required);
+    if (FAILED(hr))
+        return hr;
+
+    // Total size of the image data
+    uint64_t dataSize = 0;
+    size_t depth = metadata.depth;
+    for (size_t level = 0; level < metadata.mipLevels; ++level)
+    {
+        size_t rowPitch, slicePitch;
+        hr = ComputePitch(metadata.format,
+            std::max<size_t>(1, metadata.width >> level),
+            std::max<size_t>(1, metadata.height >> level),
+            rowPitch, slicePitch, CP_FLAGS_NONE);
+        if (FAILED(hr))
+            return hr;
+
+        dataSize += uint64_t(slicePitch) * uint64_t((metadata.dimension == TEX_DIMENSION_TEXTURE3D) ? depth : metadata.arraySize);
+
+        if (depth > 1)
+            depth >>= 1;
+    }
+
+    // Create file and write header
+#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+    ScopedHandle hFile(safe_handle(CreateFile2(szFile, GENERIC_WRITE | DELETE, 0, CREATE_ALWAYS, nullptr)));
+#else
+    ScopedHandle hFile(safe_handle(CreateFileW(szFile, GENERIC_WRITE | DELETE, 0, nullptr, CREATE_ALWAYS, 0, nullptr)));
+#endif
+    if (!hFile)
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    auto_delete_file delonfail(hFile.get());
+
+    hr = WriteFileAt(hFile.get(), 0, header, required);
+    if (FAILED(hr))
+        return hr;
+
+    // Extend the file to its final size so subresources can be written in any order
+    LARGE_INTEGER fileSize;
+    fileSize.QuadPart = static_cast<LONGLONG>(required + dataSize);
+    if (!SetFilePointerEx(hFile.get(), fileSize, nullptr, FILE_BEGIN)
+        || !SetEndOfFile(hFile.get()))
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    delonfail.clear();
+
+    m_hFile = hFile.release();
+    m_metadata = metadata;
+    m_dataOffset = required;
+
+    return S_OK;
+}
+
+
+//-------------------------------------------------------------------------------------
+// Writes a complete subresource
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DDSFileWriter::WriteImage(const Image& image, size_t mip, size_t item, size_t slice)
+{
+    if (!m_hFile)
+        return E_UNEXPECTED;
+
+    // WriteRows validates everything else; a complete subresource is just the band starting at row 0
+    if (image.height != std::max<size_t>(1, m_metadata.height >> mip))
+        return E_INVALIDARG;
+
+    return WriteRows(image, mip, item, slice, 0);
+}
+
+
+//-------------------------------------------------------------------------------------
+// Writes a band of rows of a subresource
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DDSFileWriter::WriteRows(const Image& rows, size_t mip, size_t item, size_t slice, size_t y)
+{
+    if (!m_hFile)
+        return E_UNEXPECTED;
+
+    if (!rows.pixels)
+        return E_POINTER;
+
+    if (rows.format != m_metadata.format)
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    uint64_t offset;
+    size_t ddsRowPitch, height;
+    HRESULT hr = GetOffset(mip, item, slice, offset, ddsRowPitch, height);
+    if (FAILED(hr))
+        return hr;
+
+    if (rows.width != std::max<size_t>(1, m_metadata.width >> mip)
+        || !rows.height
+        || y >= height
+        || rows.height > (height - y))
+        return E_INVALIDARG;
+
+    if (y > 0 || rows.height != height)
+    {
+        // Partial writes must start on a scanline boundary of the stored layout
+        if (IsPlanar(m_metadata.format))
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+        if (IsCompressed(m_metadata.format))
+        {
+            if ((y & 3) || ((rows.height & 3) && (y + rows.height) != height))
+                return E_INVALIDARG;
+
+            offset += uint64_t(y >> 2) * ddsRowPitch;
+        }
+        else
+        {
+            offset += uint64_t(y) * ddsRowPitch;
+        }
+    }
+
+    offset += m_dataOffset;
+
+    size_t lines = ComputeScanlines(m_metadata.format, rows.height);
+
+    if (rows.rowPitch == ddsRowPitch)
+    {
+        return WriteFileAt(m_hFile, offset, rows.pixels, ddsRowPitch * lines);
+    }
+
+    if (rows.rowPitch < ddsRowPitch)
+    {
+        // DDS uses 1-byte alignment, so if this is happening then the input pitch isn't actually a full line of data
+        return E_FAIL;
+    }
+
+    // Repack the rows to the tightly packed DDS pitch so the band goes out in a single write
+    ScopedAlignedArrayUint8 temp(static_cast<uint8_t*>(_aligned_malloc(ddsRowPitch * lines, 16)));
+    if (!temp)
+        return E_OUTOFMEMORY;
+
+    const uint8_t * __restrict sPtr = rows.pixels;
+    uint8_t * __restrict dPtr = temp.get();
+    for (size_t j = 0; j < lines; ++j)
+    {
+        memcpy_s(dPtr, ddsRowPitch, sPtr, ddsRowPitch);
+        sPtr += rows.rowPitch;
+        dPtr += ddsRowPitch;
+    }
+
+    return WriteFileAt(m_hFile, offset, temp.get(), ddsRowPitch * lines);
+}
+
+
+//-------------------------------------------------------------------------------------
+// Completes the file
+//-------------------------------------------------------------------------------------
+HRESULT DDSFileWriter::Finish()
+{
+    if (!m_hFile)
+        return E_UNEXPECTED;
+
+    HANDLE hFile = m_hFile;
+    m_hFile = nullptr;
+
+    if (!CloseHandle(hFile))
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    return S_OK;
+}
+
+
+//-------------------------------------------------------------------------------------
+// Abandons an unfinished file
+//-------------------------------------------------------------------------------------
+void DDSFileWriter::Release()
+{
+    if (m_hFile)
+    {
+        FILE_DISPOSITION_INFO info = {};
+        info.DeleteFile = TRUE;
+        (void)SetFileInformationByHandle(m_hFile, FileDispositionInfo, &info, sizeof(info));
+
+        CloseHandle(m_hFile);
+        m_hFile = nullptr;
+    }
+
+    m_metadata = {};
+    m_dataOffset = 0;
+}
+
+
+//-------------------------------------------------------------------------------------
+// Computes the offset of a subresource relative to the start of the image data
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DDSFileWriter::GetOffset(size_t mip, size_t item, size_t slice, uint64_t& offset, size_t& rowPitch, size_t& height) const
+{
+    offset = 0;
+    rowPitch = 0;
+    height = 0;
+
+    if (mip >= m_metadata.mipLevels)
+        return E_INVALIDARG;
+
+    switch (m_metadata.dimension)
+    {
+    case TEX_DIMENSION_TEXTURE1D:
+    case TEX_DIMENSION_TEXTURE2D:
+    {
+        if (item >= m_metadata.arraySize || slice != 0)
+            return E_INVALIDARG;
+
+        // Items are stored one after another, each with its full mip chain
+        uint64_t itemSize = 0;
+        for (size_t level = 0; level < m_metadata.mipLevels; ++level)
+        {
+            size_t ddsRowPitch, ddsSlicePitch;
+            HRESULT hr = ComputePitch(m_metadata.format,
+                std::max<size_t>(1, m_metadata.width >> level),
+                std::max<size_t>(1, m_metadata.height >> level),
+                ddsRowPitch, ddsSlicePitch, CP_FLAGS_NONE);
+            if (FAILED(hr))
+                return hr;
+
+            if (level < mip)
+            {
+                offset += ddsSlicePitch;
+            }
+            else if (level == mip)
+            {
+                rowPitch = ddsRowPitch;
+                height = std::max<size_t>(1, m_metadata.height >> level);
+            }
+
+            itemSize += ddsSlicePitch;
+        }
+
+        offset += itemSize * item;
+    }
+    break;
+
+    case TEX_DIMENSION_TEXTURE3D:
+    {
+        if (item != 0)
+            return E_INVALIDARG;
+
+        // Each mip level holds all of its depth slices
+        size_t depth = m_metadata.depth;
+        for (size_t level = 0; level <= mip; ++level)
+        {
+            size_t ddsRowPitch, ddsSlicePitch;
+            HRESULT hr = ComputePitch(m_metadata.format,
+                std::max<size_t>(1, m_metadata.width >> level),
+                std::max<size_t>(1, m_metadata.height >> level),
+                ddsRowPitch, ddsSlicePitch, CP_FLAGS_NONE);
+            if (FAILED(hr))
+                return hr;
+
+            if (level < mip)
+            {
+                offset += uint64_t(ddsSlicePitch) * depth;
+            }
+            else
+            {
+                if (slice >= depth)
+                    return E_INVALIDARG;
+
+                offset += uint64_t(ddsSlicePitch) * slice;
+                rowPitch = ddsRowPitch;
+                height = std::max<size_t>(1, m_metadata.height >> level);
+            }
+
+            if (depth > 1)
+                depth >>= 1;
+        }
+    }
+    break;
+
+    default:
+        return E_FAIL;
+    }
+
+    return S_OK;
+}
@@ -0,0 +1,578 @@
+//-------------------------------------------------------------------------------------
+// DirectXTexDDSIndex.cpp
+//
+// DirectX Texture Library - DDS metadata index for directory trees
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248926
+//-------------------------------------------------------------------------------------
+
+#include "DirectXTexp.h"
+
+#include "dds.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#pragma warning(disable : 4616 6993)
+#endif
+
+//
+// The on-disk index is a header, an array of fixed-size entries sorted by path, and
+// a pool of UTF-16 paths the entries refer to:
+//
+//      INDEX_HEADER
+//      INDEX_ENTRY[entryCount]
+//      wchar_t[pathChars]
+//
+
+using namespace DirectX;
+
+namespace
+{
+    const uint32_t INDEX_MAGIC = 0x58444444; // "DDDX"
+    const uint32_t INDEX_VERSION = 1;
+
+    const size_t MAX_HEADER_SIZE = sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10);
+
+#pragma pack(push,1)
+    struct INDEX_HEADER
+    {
+        uint32_t    magic;
+        uint32_t    version;
+        uint32_t    ddsFlags;
+        uint32_t    entryCount;
+        uint64_t    pathChars;
+    };
+
+    struct INDEX_ENTRY
+    {
+        uint64_t    fileSize;
+        uint64_t    lastWriteTime;
+        uint64_t    headerHash;
+        uint64_t    pathOffset;
+        uint32_t    pathLength;
+        int32_t     result;
+        uint32_t    width;
+        uint32_t    height;
+        uint32_t    depth;
+        uint32_t    arraySize;
+        uint32_t    mipLevels;
+        uint32_t    miscFlags;
+        uint32_t    miscFlags2;
+        uint32_t    format;
+        uint32_t    dimension;
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(INDEX_HEADER) == 24, "Index header size mismatch");
+    static_assert(sizeof(INDEX_ENTRY) == 76, "Index entry size mismatch");
+
+    struct FoundFile
+    {
+        std::wstring    path;
+        uint64_t        fileSize;
+        uint64_t        lastWriteTime;
+    };
+
+    inline bool PathLess(const std::wstring& a, const std::wstring& b)
+    {
+        return _wcsicmp(a.c_str(), b.c_str()) < 0;
+    }
+
+    inline bool IsDDSFile(_In_z_ const wchar_t* szName)
+    {
+        const wchar_t* ext = wcsrchr(szName, L'.');
+        return ext && (_wcsicmp(ext, L".dds") == 0);
+    }
+
+    //-------------------------------------------------------------------------------------
+    // FNV-1a hash of the file header bytes
+    //-------------------------------------------------------------------------------------
+    uint64_t HashHeader(_In_reads_bytes_(size) const uint8_t* pData, size_t size)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= pData[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    //-------------------------------------------------------------------------------------
+    // Lists the DDS files and subdirectories of one directory
+    //-------------------------------------------------------------------------------------
+    HRESULT EnumerateDirectory(
+        const std::wstring& root,
+        const std::wstring& relDir,
+        std::vector<std::wstring>& subDirs,
+        std::vector<FoundFile>& files)
+    {
+        std::wstring pattern = root;
+        if (!relDir.empty())
+        {
+            pattern += L'\\';
+            pattern += relDir;
+        }
+        pattern += L"\\*";
+
+        WIN32_FIND_DATAW findData = {};
+        ScopedFindHandle hFind(safe_handle(FindFirstFileExW(pattern.c_str(),
+            FindExInfoBasic, &findData,
+            FindExSearchNameMatch, nullptr,
+            FIND_FIRST_EX_LARGE_FETCH)));
+        if (!hFind)
+        {
+            // A drive root with nothing in it has no '.' entry, so it reports no files rather than an empty list
+            DWORD error = GetLastError();
+            return (error == ERROR_FILE_NOT_FOUND) ? S_OK : HRESULT_FROM_WIN32(error);
+        }
+
+        do
+        {
+            std::wstring relPath = relDir;
+            if (!relPath.empty())
+                relPath += L'\\';
+            relPath += findData.cFileName;
+
+            if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+            {
+                // Skip '.', '..', and reparse points so links can't create cycles
+                if (wcscmp(findData.cFileName, L".") == 0
+                    || wcscmp(findData.cFileName, L"..") == 0
+                    || (findData.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT))
+                    continue;
+
+                subDirs.emplace_back(std::move(relPath));
+            }
+            else if (IsDDSFile(findData.cFileName))
+            {
+                FoundFile file;
+                file.path = std::move(relPath);
+                file.fileSize = (uint64_t(findData.nFileSizeHigh) << 32) | findData.nFileSizeLow;
+                file.lastWriteTime = (uint64_t(findData.ftLastWriteTime.dwHighDateTime) << 32) | findData.ftLastWriteTime.dwLowDateTime;
+                files.emplace_back(std::move(file));
+            }
+        } while (FindNextFileW(hFind.get(), &findData));
+
+        DWORD error = GetLastError();
+        if (error != ERROR_NO_MORE_FILES)
+        {
+            // A partial listing would make the files not yet seen look deleted
+            subDirs.clear();
+            files.clear();
+            return HRESULT_FROM_WIN32(error);
+        }
+
+        return S_OK;
+    }
+
+    //-------------------------------------------------------------------------------------
+    // Reads and decodes the header of one DDS file
+    //-------------------------------------------------------------------------------------
+    HRESULT ReadHeader(
+        _In_z_ const wchar_t* szFile,
+        DWORD flags,
+        _In_opt_ const DDSMetadataIndex::Entry* previous,
+        DDSMetadataIndex::Entry& entry)
+    {
+#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+        ScopedHandle hFile(safe_handle(CreateFile2(szFile, GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr)));
+#else
+        ScopedHandle hFile(safe_handle(CreateFileW(szFile, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_FLAG_SEQUENTIAL_SCAN, nullptr)));
+#endif
+        if (!hFile)
+        {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+
+        uint8_t header[MAX_HEADER_SIZE] = {};
+
+        DWORD bytesRead = 0;
+        if (!ReadFile(hFile.get(), header, MAX_HEADER_SIZE, &bytesRead, nullptr))
+        {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+
+        entry.headerHash = HashHeader(header, bytesRead);
+
+        // The metadata is derived only from the header, so an identical header needs no decoding
+        if (previous && SUCCEEDED(previous->result) && previous->headerHash == entry.headerHash)
+        {
+            entry.metadata = previous->metadata;
+            return S_OK;
+        }
+
+        return GetMetadataFromDDSMemory(header, bytesRead, flags, entry.metadata);
+    }
+}
+
+
+//=====================================================================================
+// Entry-points
+//=====================================================================================
+
+//-------------------------------------------------------------------------------------
+// Scan a directory tree, reusing entries for unchanged files
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DDSMetadataIndex::Scan(const wchar_t* szRoot, DWORD flags)
+{
+    if (!szRoot || !*szRoot)
+        return E_INVALIDARG;
+
+    std::wstring root(szRoot);
+    while (!root.empty() && (root.back() == L'\\' || root.back() == L'/'))
+        root.pop_back();
+
+    // Enumerate the tree a directory level at a time, listing the directories of each level in parallel
+    std::vector<FoundFile> files;
+    std::vector<std::wstring> level(1);
+    while (!level.empty())
+    {
+        std::vector<std::vector<std::wstring>> subDirs(level.size());
+        std::vector<std::vector<FoundFile>> levelFiles(level.size());
+        std::vector<HRESULT> levelResults(level.size(), S_OK);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) if (level.size() > 1 && _UseParallel())
+#endif
+        for (int i = 0; i < static_cast<int>(level.size()); ++i)
+        {
+            levelResults[size_t(i)] = EnumerateDirectory(root, level[size_t(i)], subDirs[size_t(i)], levelFiles[size_t(i)]);
+        }
+
+        std::vector<std::wstring> next;
+        for (size_t i = 0; i < level.size(); ++i)
+        {
+            if (FAILED(levelResults[i]))
+            {
+                // Without the root there is nothing to index, so leave the current index untouched
+                if (level[i].empty())
+                    return levelResults[i];
+
+                // A subdirectory that can't be listed right now (locked, access changing, network hiccup)
+                // keeps the files previously indexed under it rather than having them dropped
+                std::wstring prefix = level[i] + L'\\';
+                for (const auto& entry : m_entries)
+                {
+                    if (_wcsnicmp(entry.path.c_str(), prefix.c_str(), prefix.size()) == 0)
+                    {
+                        FoundFile file;
+                        file.path = entry.path;
+                        file.fileSize = entry.fileSize;
+                        file.lastWriteTime = entry.lastWriteTime;
+                        files.emplace_back(std::move(file));
+                    }
+                }
+                continue;
+            }
+
+            for (auto& dir : subDirs[i])
+                next.emplace_back(std::move(dir));
+            for (auto& file : levelFiles[i])
+                files.emplace_back(std::move(file));
+        }
+        level.swap(next);
+    }
+
+    std::sort(files.begin(), files.end(), [](const FoundFile& a, const FoundFile& b) { return PathLess(a.path, b.path); });
+
+    // Entries read with different flags may decode differently, so none of them can be reused
+    const bool reuse = (flags == m_flags);
+
+    std::vector<Entry> entries(files.size());
+    std::vector<const Entry*> previous(files.size(), nullptr);
+    std::vector<size_t> pending;
+
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        Entry& entry = entries[i];
+        entry.path = std::move(files[i].path);
+        entry.fileSize = files[i].fileSize;
+        entry.lastWriteTime = files[i].lastWriteTime;
+        entry.headerHash = 0;
+        entry.result = S_OK;
+        entry.metadata = {};
+
+        const Entry* old = reuse ? Find(entry.path.c_str()) : nullptr;
+        if (old && old->fileSize == entry.fileSize && old->lastWriteTime == entry.lastWriteTime)
+        {
+            entry.headerHash = old->headerHash;
+            entry.result = old->result;
+            entry.metadata = old->metadata;
+        }
+        else
+        {
+            previous[i] = old;
+            pending.push_back(i);
+        }
+    }
+
+    // Read the headers of new or changed files
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) if (pending.size() > 1 && _UseParallel())
+#endif
+    for (int j = 0; j < static_cast<int>(pending.size()); ++j)
+    {
+        size_t i = pending[size_t(j)];
+        Entry& entry = entries[i];
+
+        std::wstring fullPath = root + L'\\' + entry.path;
+        entry.result = ReadHeader(fullPath.c_str(), flags, previous[i], entry);
+        if (FAILED(entry.result))
+            entry.metadata = {};
+    }
+
+    m_entries.swap(entries);
+    m_flags = flags;
+
+    return S_OK;
+}
+
+
+//-------------------------------------------------------------------------------------
+// Look up an entry by root-relative path
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+const DDSMetadataIndex::Entry* DDSMetadataIndex::Find(const wchar_t* szPath) const
+{
+    if (!szPath)
+        return nullptr;
+
+    auto it = std::lower_bound(m_entries.cbegin(), m_entries.cend(), szPath,
+        [](const Entry& entry, const wchar_t* path) { return _wcsicmp(entry.path.c_str(), path) < 0; });
+
+    if (it == m_entries.cend() || _wcsicmp(it->path.c_str(), szPath) != 0)
+        return nullptr;
+
+    return &(*it);
+}
+
+
+//-------------------------------------------------------------------------------------
+// Load an index from disk
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DDSMetadataIndex::Load(const wchar_t* szIndexFile)
+{
+    if (!szIndexFile)
+        return E_INVALIDARG;
+
+    Clear();
+
+#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+    ScopedHandle hFile(safe_handle(CreateFile2(szIndexFile, GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr)));
+#else
+    ScopedHandle hFile(safe_handle(CreateFileW(szIndexFile, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_FLAG_SEQUENTIAL_SCAN, nullptr)));
+#endif
+    if (!hFile)
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    // Get the file size
+    FILE_STANDARD_INFO fileInfo;
+    if (!GetFileInformationByHandleEx(hFile.get(), FileStandardInfo, &fileInfo, sizeof(fileInfo)))
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    if (fileInfo.EndOfFile.HighPart > 0)
+    {
+        return HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE);
+    }
+
+    const size_t size = fileInfo.EndOfFile.LowPart;
+    if (size < sizeof(INDEX_HEADER))
+    {
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+
+    // Read the whole index in one go
+    std::unique_ptr<uint8_t[]> data(new (std::nothrow) uint8_t[size]);
+    if (!data)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    DWORD bytesRead = 0;
+    if (!ReadFile(hFile.get(), data.get(), static_cast<DWORD>(size), &bytesRead, nullptr))
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    if (bytesRead != size)
+    {
+        return E_FAIL;
+    }
+
+    auto header = reinterpret_cast<const INDEX_HEADER*>(data.get());
+    if (header->magic != INDEX_MAGIC || header->version != INDEX_VERSION)
+    {
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+
+    const uint64_t entryBytes = uint64_t(header->entryCount) * sizeof(INDEX_ENTRY);
+    const uint64_t pathBytes = header->pathChars * sizeof(wchar_t);
+    if (header->pathChars > size || (sizeof(INDEX_HEADER) + entryBytes + pathBytes) != size)
+    {
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+
+    auto indexEntries = reinterpret_cast<const INDEX_ENTRY*>(data.get() + sizeof(INDEX_HEADER));
+    auto paths = reinterpret_cast<const wchar_t*>(data.get() + sizeof(INDEX_HEADER) + entryBytes);
+
+    std::vector<Entry> entries(header->entryCount);
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        const INDEX_ENTRY& src = indexEntries[i];
+        if (src.pathOffset > header->pathChars || src.pathLength > (header->pathChars - src.pathOffset))
+        {
+            return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+        }
+
+        Entry& entry = entries[i];
+        entry.path.assign(paths + src.pathOffset, src.pathLength);
+        entry.fileSize = src.fileSize;
+        entry.lastWriteTime = src.lastWriteTime;
+        entry.headerHash = src.headerHash;
+        entry.result = static_cast<HRESULT>(src.result);
+        entry.metadata.width = src.width;
+        entry.metadata.height = src.height;
+        entry.metadata.depth = src.depth;
+        entry.metadata.arraySize = src.arraySize;
+        entry.metadata.mipLevels = src.mipLevels;
+        entry.metadata.miscFlags = src.miscFlags;
+        entry.metadata.miscFlags2 = src.miscFlags2;
+        entry.metadata.format = static_cast<DXGI_FORMAT>(src.format);
+        entry.metadata.dimension = static_cast<TEX_DIMENSION>(src.dimension);
+
+        if (i > 0 && !PathLess(entries[i - 1].path, entry.path))
+        {
+            return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+        }
+    }
+
+    m_entries.swap(entries);
+    m_flags = header->ddsFlags;
+
+    return S_OK;
+}
+
+
+//-------------------------------------------------------------------------------------
+// Save the index to disk
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DDSMetadataIndex::Save(const wchar_t* szIndexFile) const
+{
+    if (!szIndexFile)
+        return E_INVALIDARG;
+
+    if (m_entries.size() > UINT32_MAX)
+        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+    // Build the entry table and path pool
+    std::vector<INDEX_ENTRY> indexEntries(m_entries.size());
+    std::vector<wchar_t> paths;
+
+    for (size_t i = 0; i < m_entries.size(); ++i)
+    {
+        const Entry& src = m_entries[i];
+        if (src.path.size() > UINT32_MAX)
+            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+        INDEX_ENTRY& entry = indexEntries[i];
+        entry.fileSize = src.fileSize;
+        entry.lastWriteTime = src.lastWriteTime;
+        entry.headerHash = src.headerHash;
+        entry.pathOffset = paths.size();
+        entry.pathLength = static_cast<uint32_t>(src.path.size());
+        entry.result = static_cast<int32_t>(src.result);
+        entry.width = static_cast<uint32_t>(src.metadata.width);
+        entry.height = static_cast<uint32_t>(src.metadata.height);
+        entry.depth = static_cast<uint32_t>(src.metadata.depth);
+        entry.arraySize = static_cast<uint32_t>(src.metadata.arraySize);
+        entry.mipLevels = static_cast<uint32_t>(src.metadata.mipLevels);
+        entry.miscFlags = src.metadata.miscFlags;
+        entry.miscFlags2 = src.metadata.miscFlags2;
+        entry.format = static_cast<uint32_t>(src.metadata.format);
+        entry.dimension = static_cast<uint32_t>(src.metadata.dimension);
+
+        paths.insert(paths.end(), src.path.cbegin(), src.path.cend());
+    }
+
+    INDEX_HEADER header = {};
+    header.magic = INDEX_MAGIC;
+    header.version = INDEX_VERSION;
+    header.ddsFlags = m_flags;
+    header.entryCount = static_cast<uint32_t>(indexEntries.size());
+    header.pathChars = paths.size();
+
+    const uint64_t total = sizeof(INDEX_HEADER)
+        + uint64_t(indexEntries.size()) * sizeof(INDEX_ENTRY)
+        + uint64_t(paths.size()) * sizeof(wchar_t);
+    if (total > UINT32_MAX)
+        return HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE);
+
+    // Create file and write it out
+#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+    ScopedHandle hFile(safe_handle(CreateFile2(szIndexFile, GENERIC_WRITE | DELETE, 0, CREATE_ALWAYS, nullptr)));
+#else
+    ScopedHandle hFile(safe_handle(CreateFileW(szIndexFile, GENERIC_WRITE | DELETE, 0, nullptr, CREATE_ALWAYS, 0, nullptr)));
+#endif
+    if (!hFile)
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    auto_delete_file delonfail(hFile.get());
+
+    DWORD bytesWritten;
+    if (!WriteFile(hFile.get(), &header, sizeof(INDEX_HEADER), &bytesWritten, nullptr))
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    if (bytesWritten != sizeof(INDEX_HEADER))
+    {
+        return E_FAIL;
+    }
+
+    if (!indexEntries.empty())
+    {
+        auto bytes = static_cast<DWORD>(indexEntries.size() * sizeof(INDEX_ENTRY));
+        if (!WriteFile(hFile.get(), indexEntries.data(), bytes, &bytesWritten, nullptr))
+        {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+
+        if (bytesWritten != bytes)
+        {
+            return E_FAIL;
+        }
+    }
+
+    if (!paths.empty())
+    {
+        auto bytes = static_cast<DWORD>(paths.size() * sizeof(wchar_t));
+        if (!WriteFile(hFile.get(), paths.data(), bytes, &bytesWritten, nullptr))
+        {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+
+        if (bytesWritten != bytes)
+        {
+            return E_FAIL;
+        }
+    }
+
+    delonfail.clear();
+
+    return S_OK;
+}
@@ -11,6 +11,11 @@
 
 #include "DirectXTexp.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#pragma warning(disable : 4616 6993)
+#endif
+
 //
 // In theory HDR (RGBE) Radiance files can have any of the following data orientations
 //
@@ -286,6 +291,230 @@ namespace
         return S_OK;
     }
 
+    // Scanlines are decoded and encoded in parallel once there are at least this many
+    const size_t c_HDRParallelRows = 32;
+
+    // Number of scanlines encoded per batch when writing
+    const size_t c_HDRBandRows = 256;
+
+    //-------------------------------------------------------------------------------------
+    // Finds the end of the scanline starting at pSource, validating its packets so the
+    // scanlines can then be decoded independently; returns the number of bytes used, or
+    // 0 if the data is invalid
+    //-------------------------------------------------------------------------------------
+    size_t FindScanlineEnd(_In_reads_bytes_(size) const uint8_t* pSource, size_t size, size_t width)
+    {
+        if (size < 4)
+            return 0;
+
+        const uint8_t* sPtr = pSource;
+        const uint8_t* endPtr = pSource + size;
+
+        uint8_t inColor[4];
+        memcpy(inColor, sPtr, 4);
+        sPtr += 4;
+
+        if (inColor[0] == 2 && inColor[1] == 2 && inColor[2] < 128)
+        {
+            // Adaptive Run Length Encoding (RLE)
+            if (size_t((size_t(inColor[2]) << 8) + inColor[3]) != width)
+                return 0;
+
+            for (int channel = 0; channel < 4; ++channel)
+            {
+                for (size_t pixelCount = 0; pixelCount < width;)
+                {
+                    if (endPtr - sPtr < 2)
+                        return 0;
+
+                    size_t runLen = *sPtr;
+                    if (runLen > 128)
+                    {
+                        runLen &= 127;
+                        if (pixelCount + runLen > width)
+                            return 0;
+
+                        sPtr += 2;
+                    }
+                    else
+                    {
+                        if (size_t(endPtr - sPtr) < runLen + 1 || pixelCount + runLen > width)
+                            return 0;
+
+                        sPtr += runLen + 1;
+                    }
+
+                    pixelCount += runLen;
+                }
+            }
+        }
+        else
+        {
+            int bitShift = 0;
+            for (size_t pixelCount = 0; pixelCount < width;)
+            {
+                if (inColor[0] == 1 && inColor[1] == 1 && inColor[2] == 1)
+                {
+                    // "Standard" Run Length Encoding
+                    if (bitShift > 24)
+                        return 0;
+
+                    size_t spanLen = size_t(inColor[3]) << bitShift;
+                    if (spanLen + pixelCount > width)
+                        return 0;
+
+                    pixelCount += spanLen;
+                    bitShift += 8;
+                }
+                else
+                {
+                    // Uncompressed
+                    bitShift = 0;
+                    ++pixelCount;
+                }
+
+                if (pixelCount >= width)
+                    break;
+
+                if (endPtr - sPtr < 4)
+                    return 0;
+
+                memcpy(inColor, sPtr, 4);
+                sPtr += 4;
+            }
+        }
+
+        return size_t(sPtr - pSource);
+    }
+
+
+    //-------------------------------------------------------------------------------------
+    // Decodes a scanline validated by FindScanlineEnd to RGBE bytes
+    //-------------------------------------------------------------------------------------
+    void DecodeScanline(_In_ const uint8_t* sPtr, size_t width, _Out_writes_(width * 4) uint8_t* rgbe)
+    {
+        uint8_t inColor[4];
+        memcpy(inColor, sPtr, 4);
+        sPtr += 4;
+
+        if (inColor[0] == 2 && inColor[1] == 2 && inColor[2] < 128)
+        {
+            // Adaptive Run Length Encoding (RLE)
+            for (int channel = 0; channel < 4; ++channel)
+            {
+                uint8_t* pixelLoc = rgbe + channel;
+                for (size_t pixelCount = 0; pixelCount < width;)
+                {
+                    size_t runLen = *sPtr;
+                    if (runLen > 128)
+                    {
+                        runLen &= 127;
+
+                        uint8_t val = sPtr[1];
+                        for (size_t j = 0; j < runLen; ++j)
+                        {
+                            *pixelLoc = val;
+                            pixelLoc += 4;
+                        }
+                        sPtr += 2;
+                    }
+                    else
+                    {
+                        ++sPtr;
+                        for (size_t j = 0; j < runLen; ++j)
+                        {
+                            *pixelLoc = *sPtr++;
+                            pixelLoc += 4;
+                        }
+                    }
+
+                    pixelCount += runLen;
+                }
+            }
+        }
+        else
+        {
+            uint8_t* pixelLoc = rgbe;
+
+            uint8_t prevColor[4];
+            memcpy(prevColor, inColor, 4);
+
+            int bitShift = 0;
+            for (size_t pixelCount = 0; pixelCount < width;)
+            {
+                if (inColor[0] == 1 && inColor[1] == 1 && inColor[2] == 1)
+                {
+                    // "Standard" Run Length Encoding
+                    size_t spanLen = size_t(inColor[3]) << bitShift;
+                    for (size_t j = 0; j < spanLen; ++j)
+                    {
+                        memcpy(pixelLoc, prevColor, 4);
+                        pixelLoc += 4;
+                    }
+                    pixelCount += spanLen;
+                    bitShift += 8;
+                }
+                else
+                {
+                    // Uncompressed
+                    memcpy(prevColor, inColor, 4);
+                    memcpy(pixelLoc, inColor, 4);
+                    bitShift = 0;
+                    ++pixelCount;
+                    pixelLoc += 4;
+                }
+
+                if (pixelCount >= width)
+                    break;
+
+                memcpy(inColor, sPtr, 4);
+                sPtr += 4;
+            }
+        }
+    }
+
+
+    //-------------------------------------------------------------------------------------
+    // RGBEToFloat
+    //-------------------------------------------------------------------------------------
+    void RGBEToFloat(
+        _Out_writes_(width * 4) float* pDestination,
+        _In_reads_(width * 4) const uint8_t* pSource,
+        size_t width,
+        float invExposure,
+        _In_reads_(256) const float* scales)
+    {
+        // scales[e] is 2^(e - 136), so (v + 0.5) * scales[e] is exactly ldexpf(v + 0.5, e - (128 + 8))
+#if defined(_XM_SSE_INTRINSICS_)
+        const __m128i zero = _mm_setzero_si128();
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 vinvExposure = _mm_set1_ps(invExposure);
+        const __m128 rgbMask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+        const __m128 oneW = _mm_setr_ps(0.f, 0.f, 0.f, 1.f);
+
+        for (size_t j = 0; j < width; ++j, pSource += 4, pDestination += 4)
+        {
+            int t;
+            memcpy(&t, pSource, 4);
+
+            __m128i v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(t), zero), zero);
+            __m128 f = _mm_add_ps(_mm_cvtepi32_ps(v), half);
+            f = _mm_mul_ps(vinvExposure, _mm_mul_ps(f, _mm_set1_ps(scales[pSource[3]])));
+            _mm_storeu_ps(pDestination, _mm_or_ps(_mm_and_ps(f, rgbMask), oneW));
+        }
+#else
+        for (size_t j = 0; j < width; ++j, pSource += 4, pDestination += 4)
+        {
+            const float scale = scales[pSource[3]];
+            pDestination[0] = invExposure * ((float(pSource[0]) + 0.5f) * scale);
+            pDestination[1] = invExposure * ((float(pSource[1]) + 0.5f) * scale);
+            pDestination[2] = invExposure * ((float(pSource[2]) + 0.5f) * scale);
+            pDestination[3] = 1.f;
+        }
+#endif
+    }
+
+
     //-------------------------------------------------------------------------------------
     // FloatToRGBE
     //-------------------------------------------------------------------------------------
@@ -293,7 +522,73 @@ namespace
     {
         auto ePtr = pSource + width * fpp;
 
-        for (size_t j = 0; j < width; ++j)
+        size_t j = 0;
+
+#if defined(_XM_SSE_INTRINSICS_)
+        // Four pixels at a time; this matches the scalar loop below bit-for-bit
+        {
+            // Largest float which fails the scalar 'max_xyz > 1e-32' test (done in double)
+            float threshold = 1e-32f;
+            if (double(threshold) > 1e-32)
+                threshold = nextafterf(threshold, 0.f);
+
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 vthreshold = _mm_set1_ps(threshold);
+            const __m128 v256 = _mm_set1_ps(256.f);
+            const __m128i mantissaMask = _mm_set1_epi32(static_cast<int>(0x807fffff));
+            const __m128i halfExponent = _mm_set1_epi32(126 << 23);
+            const __m128i byteMask = _mm_set1_epi32(0xff);
+            const __m128i expBias = _mm_set1_epi32(128 - 126);
+
+            for (; j + 4 <= width; j += 4)
+            {
+                __m128 r, g, b;
+                if (fpp == 4)
+                {
+                    r = _mm_loadu_ps(pSource);
+                    g = _mm_loadu_ps(pSource + 4);
+                    b = _mm_loadu_ps(pSource + 8);
+                    __m128 a = _mm_loadu_ps(pSource + 12);
+                    _MM_TRANSPOSE4_PS(r, g, b, a);
+                }
+                else
+                {
+                    r = _mm_setr_ps(pSource[0], pSource[3], pSource[6], pSource[9]);
+                    g = _mm_setr_ps(pSource[1], pSource[4], pSource[7], pSource[10]);
+                    b = _mm_setr_ps(pSource[2], pSource[5], pSource[8], pSource[11]);
+                }
+                pSource += 4 * fpp;
+
+                // maxps returns the second operand for NaN, so negatives and NaNs become zero
+                r = _mm_max_ps(r, zero);
+                g = _mm_max_ps(g, zero);
+                b = _mm_max_ps(b, zero);
+
+                __m128 maxv = _mm_max_ps(_mm_max_ps(r, g), b);
+                __m128i valid = _mm_castps_si128(_mm_cmpgt_ps(maxv, vthreshold));
+
+                // frexpf for normal values; anything small enough to matter is masked off above
+                __m128i bits = _mm_castps_si128(maxv);
+                __m128i e = _mm_add_epi32(_mm_and_si128(_mm_srli_epi32(bits, 23), byteMask), expBias);
+                __m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, mantissaMask), halfExponent));
+                __m128 scale = _mm_div_ps(_mm_mul_ps(m, v256), maxv);
+
+                __m128i red = _mm_and_si128(_mm_cvttps_epi32(_mm_mul_ps(r, scale)), byteMask);
+                __m128i green = _mm_and_si128(_mm_cvttps_epi32(_mm_mul_ps(g, scale)), byteMask);
+                __m128i blue = _mm_and_si128(_mm_cvttps_epi32(_mm_mul_ps(b, scale)), byteMask);
+
+                __m128i any = _mm_or_si128(_mm_or_si128(red, green), blue);
+                e = _mm_andnot_si128(_mm_cmpeq_epi32(any, _mm_setzero_si128()), _mm_and_si128(e, byteMask));
+
+                __m128i pixels = _mm_or_si128(_mm_or_si128(red, _mm_slli_epi32(green, 8)),
+                    _mm_or_si128(_mm_slli_epi32(blue, 16), _mm_slli_epi32(e, 24)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination), _mm_and_si128(pixels, valid));
+                pDestination += 16;
+            }
+        }
+#endif
+
+        for (; j < width; ++j)
         {
             if (pSource + 2 >= ePtr) break;
             float r = pSource[0] >= 0.f ? pSource[0] : 0.f;
@@ -511,6 +806,79 @@ namespace
         return encSize;
 #endif
     }
+
+#ifndef DISABLE_COMPRESS
+    //-------------------------------------------------------------------------------------
+    // Encodes 'count' scanlines starting at 'y' into pDestination, converting and RLE
+    // encoding each in parallel into its own rowPitch slot and then packing the results
+    //-------------------------------------------------------------------------------------
+    HRESULT EncodeScanlines(
+        const Image& image,
+        _In_range_(3, 4) int fpp,
+        size_t y,
+        size_t count,
+        _Out_writes_bytes_(count * image.width * 4) uint8_t* pDestination,
+        size_t& encoded)
+    {
+        encoded = 0;
+
+        const size_t rowPitch = image.width * 4;
+
+        std::unique_ptr<size_t[]> sizes(new (std::nothrow) size_t[count]);
+        if (!sizes)
+            return E_OUTOFMEMORY;
+
+        bool outOfMemory = false;
+
+#ifdef _OPENMP
+#pragma omp parallel if (count >= c_HDRParallelRows && _UseParallel())
+#endif
+        {
+            std::unique_ptr<uint8_t[]> rgbe(new (std::nothrow) uint8_t[rowPitch]);
+            if (!rgbe)
+                outOfMemory = true;
+
+#ifdef _OPENMP
+#pragma omp for
+#endif
+            for (int row = 0; row < static_cast<int>(count); ++row)
+            {
+                if (!rgbe)
+                    continue;
+
+                auto sPtr = image.pixels + (y + size_t(row)) * image.rowPitch;
+                auto enc = pDestination + size_t(row) * rowPitch;
+
+                FloatToRGBE(rgbe.get(), reinterpret_cast<const float*>(sPtr), image.width, fpp);
+
+                size_t encSize = EncodeRLE(enc, rgbe.get(), rowPitch, image.width);
+                if (!encSize)
+                {
+                    memcpy(enc, rgbe.get(), rowPitch);
+                    encSize = rowPitch;
+                }
+
+                sizes[size_t(row)] = encSize;
+            }
+        }
+
+        if (outOfMemory)
+            return E_OUTOFMEMORY;
+
+        // Pack the scanlines; each one only ever moves towards the start of the buffer
+        for (size_t row = 0; row < count; ++row)
+        {
+            auto enc = pDestination + row * rowPitch;
+            if (pDestination + encoded != enc)
+            {
+                memmove(pDestination + encoded, enc, sizes[row]);
+            }
+            encoded += sizes[row];
+        }
+
+        return S_OK;
+    }
+#endif
 }
 
 
@@ -614,8 +982,6 @@ HRESULT DirectX::LoadFromHDRMemory(const void* pSource, size_t size, TexMetadata
     // Copy pixels
     auto sourcePtr = static_cast<const uint8_t*>(pSource) + offset;
 
-    size_t pixelLen = remaining;
-
     const Image* img = image.GetImage(0, 0, 0);
     if (!img)
     {
@@ -623,173 +989,69 @@ HRESULT DirectX::LoadFromHDRMemory(const void* pSource, size_t size, TexMetadata
         return E_POINTER;
     }
 
-    auto destPtr = img->pixels;
-
 #ifdef _DEBUG
     memset(img->pixels, 0xFF, img->rowPitch * img->height);
 #endif
 
-    for (size_t scan = 0; scan < mdata.height; ++scan)
+    // Find where each scanline starts, validating the packets as we go
+    std::unique_ptr<size_t[]> scanOffsets(new (std::nothrow) size_t[mdata.height]);
+    if (!scanOffsets)
+    {
+        image.Release();
+        return E_OUTOFMEMORY;
+    }
+
+    for (size_t scan = 0, pos = 0; scan < mdata.height; ++scan)
     {
-        if (pixelLen < 4)
+        scanOffsets[scan] = pos;
+
+        size_t scanLen = FindScanlineEnd(sourcePtr + pos, remaining - pos, mdata.width);
+        if (!scanLen)
         {
             image.Release();
             return E_FAIL;
         }
 
-        uint8_t inColor[4];
-        memcpy(inColor, sourcePtr, 4);
-        sourcePtr += 4;
-        pixelLen -= 4;
+        pos += scanLen;
+    }
 
-        auto scanLine = reinterpret_cast<float*>(destPtr);
-        
-        if (inColor[0] == 2 && inColor[1] == 2 && inColor[2] < 128)
-        {
-            // Adaptive Run Length Encoding (RLE)
-            if (size_t((size_t(inColor[2]) << 8) + inColor[3]) != mdata.width)
-            {
-                image.Release();
-                return E_FAIL;
-            }
+    // Decode the scanlines and transform the values
+    float scales[256];
+    for (int e = 0; e < 256; ++e)
+    {
+        scales[e] = ldexpf(1.f, e - (128 + 8));
+    }
 
-            for (int channel = 0; channel < 4; ++channel)
-            {
-                auto pixelLoc = scanLine + channel;
-                for(size_t pixelCount = 0; pixelCount < mdata.width;)
-                {
-                    if (pixelLen < 2)
-                    {
-                        image.Release();
-                        return E_FAIL;
-                    }
+    const float invExposure = 1.0f / exposure;
 
-                    assert(sourcePtr < (reinterpret_cast<const uint8_t*>(pSource) + size));
+    bool outOfMemory = false;
 
-                    uint8_t runLen = *sourcePtr;
-                    if (runLen > 128)
-                    {
-                        runLen &= 127;
-                        if (pixelCount + runLen > mdata.width)
-                        {
-                            image.Release();
-                            return E_FAIL;
-                        }
+#ifdef _OPENMP
+#pragma omp parallel if (mdata.height >= c_HDRParallelRows && _UseParallel())
+#endif
+    {
+        std::unique_ptr<uint8_t[]> rgbe(new (std::nothrow) uint8_t[mdata.width * 4]);
+        if (!rgbe)
+            outOfMemory = true;
 
-                        auto val = static_cast<float>(sourcePtr[1]);
-                        for (uint8_t j = 0; j < runLen; ++j)
-                        {
-                            *pixelLoc = val;
-                            pixelLoc += 4;
-                        }
-                        pixelCount += runLen;
-                        sourcePtr += 2;
-                        pixelLen -= 2;
-                    }
-                    else if ((size < size_t(runLen) + 1) || ((pixelCount + size_t(runLen)) > mdata.width))
-                    {
-                        image.Release();
-                        return E_FAIL;
-                    }
-                    else
-                    {
-                        ++sourcePtr;
-                        for (uint8_t j = 0; j < runLen; ++j)
-                        {
-                            auto val = static_cast<float>(*sourcePtr++);
-                            *pixelLoc = val;
-                            pixelLoc += 4;
-                        }
-                        pixelCount += runLen;
-                        pixelLen -= size_t(runLen) + 1;
-                    }
-                }
-            }
-        }
-        else
+#ifdef _OPENMP
+#pragma omp for
+#endif
+        for (int y = 0; y < static_cast<int>(mdata.height); ++y)
         {
-            auto pixelLoc = scanLine;
+            if (!rgbe)
+                continue;
 
-            float prevColor[4];
-            prevColor[0] = inColor[0];
-            prevColor[1] = inColor[1];
-            prevColor[2] = inColor[2];
-            prevColor[3] = inColor[3];
+            DecodeScanline(sourcePtr + scanOffsets[size_t(y)], mdata.width, rgbe.get());
 
-            int bitShift = 0;
-            for (size_t pixelCount = 0; pixelCount < mdata.width;)
-            {
-                if (inColor[0] == 1 && inColor[1] == 1 && inColor[2] == 1)
-                {
-                    if (bitShift > 24)
-                    {
-                        image.Release();
-                        return E_FAIL;
-                    }
-
-                    // "Standard" Run Length Encoding
-                    size_t spanLen = size_t(inColor[3]) << bitShift;
-                    if (spanLen + pixelCount > mdata.width)
-                    {
-                        image.Release();
-                        return E_FAIL;
-                    }
-
-                    for (size_t j = 0; j < spanLen; ++j)
-                    {
-                        pixelLoc[0] = prevColor[0];
-                        pixelLoc[1] = prevColor[1];
-                        pixelLoc[2] = prevColor[2];
-                        pixelLoc[3] = prevColor[3];
-                        pixelLoc += 4;
-                    }
-                    pixelCount += spanLen;
-                    bitShift += 8;
-                }
-                else
-                {
-                    // Uncompressed
-                    pixelLoc[0] = prevColor[0] = inColor[0];
-                    pixelLoc[1] = prevColor[1] = inColor[1];
-                    pixelLoc[2] = prevColor[2] = inColor[2];
-                    pixelLoc[3] = prevColor[3] = inColor[3];
-                    bitShift = 0;
-                    ++pixelCount;
-                    pixelLoc += 4;
-                }
-
-                if (pixelCount >= mdata.width)
-                    break;
-
-                if (pixelLen < 4)
-                {
-                    image.Release();
-                    return E_FAIL;
-                }
-
-                memcpy(inColor, sourcePtr, 4);
-                sourcePtr += 4;
-                pixelLen -= 4;
-            }
+            RGBEToFloat(reinterpret_cast<float*>(img->pixels + size_t(y) * img->rowPitch), rgbe.get(), mdata.width, invExposure, scales);
         }
-
-        destPtr += img->rowPitch;
     }
 
-    // Transform values
+    if (outOfMemory)
     {
-        auto fdata = reinterpret_cast<float*>(image.GetPixels());
-
-        for (size_t j = 0; j < image.GetPixelsSize(); j += 16)
-        {
-            auto exponent = static_cast<int>(fdata[3]);
-            fdata[0] = 1.0f / exposure*ldexpf((fdata[0] + 0.5f), exponent - (128 + 8));
-            fdata[1] = 1.0f / exposure*ldexpf((fdata[1] + 0.5f), exponent - (128 + 8));
-            fdata[2] = 1.0f / exposure*ldexpf((fdata[2] + 0.5f), exponent - (128 + 8));
-            fdata[3] = 1.f;
-
-            fdata += 4;
-        }
+        image.Release();
+        return E_OUTOFMEMORY;
     }
 
     if (metadata)
@@ -923,33 +1185,21 @@ HRESULT DirectX::SaveToHDRMemory(const Image& image, Blob& blob)
         sPtr += image.rowPitch;
     }
 #else
-    std::unique_ptr<uint8_t[]> temp(new (std::nothrow) uint8_t[rowPitch * 2]);
-    if (!temp)
+    // Scanlines are encoded in place in bands; the packed output never overtakes the
+    // rowPitch slots of the band being encoded, so this fits in the uncompressed size
+    for (size_t y = 0; y < image.height; y += c_HDRBandRows)
     {
-        blob.Release();
-        return E_OUTOFMEMORY;
-    }
-
-    auto rgbe = temp.get();
-    auto enc = temp.get() + rowPitch;
-
-    const uint8_t* sPtr = image.pixels;
-    for (size_t scan = 0; scan < image.height; ++scan)
-    {
-        FloatToRGBE(rgbe, reinterpret_cast<const float*>(sPtr), image.width, fpp);
-        sPtr += image.rowPitch;
+        const size_t count = std::min<size_t>(c_HDRBandRows, image.height - y);
 
-        size_t encSize = EncodeRLE(enc, rgbe, rowPitch, image.width);
-        if (encSize > 0)
-        {
-            memcpy(dPtr, enc, encSize);
-            dPtr += encSize;
-        }
-        else
+        size_t encoded;
+        hr = EncodeScanlines(image, fpp, y, count, dPtr, encoded);
+        if (FAILED(hr))
         {
-            memcpy(dPtr, rgbe, rowPitch);
-            dPtr += rowPitch;
+            blob.Release();
+            return hr;
         }
+
+        dPtr += encoded;
     }
 #endif
 
@@ -1043,13 +1293,16 @@ HRESULT DirectX::SaveToHDRFile(const Image& image, const wchar_t* szFile)
     }
     else
     {
-        // Otherwise, write the image one scanline at a time...
-        std::unique_ptr<uint8_t[]> temp(new (std::nothrow) uint8_t[rowPitch * 2]);
+        // Otherwise, write the image a band of scanlines at a time...
+#ifdef DISABLE_COMPRESS
+        const size_t tempRows = 1;
+#else
+        const size_t tempRows = std::min<size_t>(image.height, c_HDRBandRows);
+#endif
+        std::unique_ptr<uint8_t[]> temp(new (std::nothrow) uint8_t[rowPitch * tempRows]);
         if (!temp)
             return E_OUTOFMEMORY;
 
-        auto rgbe = temp.get();
-
         // Write header
         char header[256] = {};
         sprintf_s(header, g_Header, image.height, image.width);
@@ -1067,6 +1320,8 @@ HRESULT DirectX::SaveToHDRFile(const Image& image, const wchar_t* szFile)
 
 #ifdef DISABLE_COMPRESS
         // Uncompressed write
+        auto rgbe = temp.get();
+
         auto sPtr = reinterpret_cast<const uint8_t*>(image.pixels);
         for (size_t scan = 0; scan < image.height; ++scan)
         {
@@ -1082,38 +1337,25 @@ HRESULT DirectX::SaveToHDRFile(const Image& image, const wchar_t* szFile)
                 return E_FAIL;
         }
 #else
-        auto enc = temp.get() + rowPitch;
-
-        const uint8_t* sPtr = image.pixels;
-        for (size_t scan = 0; scan < image.height; ++scan)
+        for (size_t y = 0; y < image.height; y += c_HDRBandRows)
         {
-            FloatToRGBE(rgbe, reinterpret_cast<const float*>(sPtr), image.width, fpp);
-            sPtr += image.rowPitch;
+            const size_t count = std::min<size_t>(c_HDRBandRows, image.height - y);
 
-            size_t encSize = EncodeRLE(enc, rgbe, rowPitch, image.width);
-            if (encSize > 0)
-            {
-                if (encSize > UINT32_MAX)
-                    return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+            size_t encoded;
+            HRESULT hr = EncodeScanlines(image, fpp, y, count, temp.get(), encoded);
+            if (FAILED(hr))
+                return hr;
 
-                if (!WriteFile(hFile.get(), enc, static_cast<DWORD>(encSize), &bytesWritten, nullptr))
-                {
-                    return HRESULT_FROM_WIN32(GetLastError());
-                }
+            if (encoded > UINT32_MAX)
+                return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
 
-                if (bytesWritten != encSize)
-                    return E_FAIL;
-            }
-            else
+            if (!WriteFile(hFile.get(), temp.get(), static_cast<DWORD>(encoded), &bytesWritten, nullptr))
             {
-                if (!WriteFile(hFile.get(), rgbe, static_cast<DWORD>(rowPitch), &bytesWritten, nullptr))
-                {
-                    return HRESULT_FROM_WIN32(GetLastError());
-                }
-
-                if (bytesWritten != rowPitch)
-                    return E_FAIL;
+                return HRESULT_FROM_WIN32(GetLastError());
             }
+
+            if (bytesWritten != encoded)
+                return E_FAIL;
         }
 #endif
     }
@@ -11,6 +11,10 @@
 
 #include "DirectXTexp.h"
 
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+#define USE_FILE_MAPPING
+#endif
+
 namespace DirectX
 {
     extern bool _CalculateMipLevels(_In_ size_t width, _In_ size_t height, _Inout_ size_t& mipLevels);
@@ -268,11 +272,15 @@ ScratchImage& ScratchImage::operator= (ScratchImage&& moveFrom) noexcept
         m_metadata = moveFrom.m_metadata;
         m_image = moveFrom.m_image;
         m_memory = moveFrom.m_memory;
+        m_view = moveFrom.m_view;
+        m_allocator = moveFrom.m_allocator;
 
         moveFrom.m_nimages = 0;
         moveFrom.m_size = 0;
         moveFrom.m_image = nullptr;
         moveFrom.m_memory = nullptr;
+        moveFrom.m_view = nullptr;
+        moveFrom.m_allocator = nullptr;
     }
     return *this;
 }
@@ -351,7 +359,8 @@ HRESULT ScratchImage::Initialize(const TexMetadata& mdata, DWORD flags)
     m_nimages = nimages;
     memset(m_image, 0, sizeof(Image) * nimages);
 
-    m_memory = static_cast<uint8_t*>(_aligned_malloc(pixelSize, 16));
+    m_allocator = GetImageAllocator();
+    m_memory = static_cast<uint8_t*>(m_allocator->Allocate(pixelSize));
     if (!m_memory)
     {
         Release();
@@ -418,7 +427,8 @@ HRESULT ScratchImage::Initialize2D(DXGI_FORMAT fmt, size_t width, size_t height,
     m_nimages = nimages;
     memset(m_image, 0, sizeof(Image) * nimages);
 
-    m_memory = static_cast<uint8_t*>(_aligned_malloc(pixelSize, 16));
+    m_allocator = GetImageAllocator();
+    m_memory = static_cast<uint8_t*>(m_allocator->Allocate(pixelSize));
     if (!m_memory)
     {
         Release();
@@ -471,7 +481,8 @@ HRESULT ScratchImage::Initialize3D(DXGI_FORMAT fmt, size_t width, size_t height,
     m_nimages = nimages;
     memset(m_image, 0, sizeof(Image) * nimages);
 
-    m_memory = static_cast<uint8_t*>(_aligned_malloc(pixelSize, 16));
+    m_allocator = GetImageAllocator();
+    m_memory = static_cast<uint8_t*>(m_allocator->Allocate(pixelSize));
     if (!m_memory)
     {
         Release();
@@ -677,10 +688,85 @@ HRESULT ScratchImage::Initialize3DFromImages(const Image* images, size_t depth,
     return S_OK;
 }
 
+_Use_decl_annotations_
+HRESULT ScratchImage::InitializeFromMappedFile(const TexMetadata& mdata, HANDLE hFile, size_t offset)
+{
+#ifndef USE_FILE_MAPPING
+    UNREFERENCED_PARAMETER(mdata);
+    UNREFERENCED_PARAMETER(hFile);
+    UNREFERENCED_PARAMETER(offset);
+    return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+#else
+    if (!hFile)
+        return E_INVALIDARG;
+
+    if (!IsValid(mdata.format) || !mdata.mipLevels)
+        return E_INVALIDARG;
+
+    if (IsPalettized(mdata.format))
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(hFile, &fileSize))
+        return HRESULT_FROM_WIN32(GetLastError());
+
+    Release();
+
+    m_metadata = mdata;
+
+    size_t pixelSize, nimages;
+    if (!_DetermineImageArray(m_metadata, CP_FLAGS_NONE, nimages, pixelSize))
+    {
+        Release();
+        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+    }
+
+    if (uint64_t(offset) + uint64_t(pixelSize) > uint64_t(fileSize.QuadPart))
+    {
+        Release();
+        return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+    }
+
+    m_image = new (std::nothrow) Image[nimages];
+    if (!m_image)
+    {
+        Release();
+        return E_OUTOFMEMORY;
+    }
+
+    m_nimages = nimages;
+    memset(m_image, 0, sizeof(Image) * nimages);
+
+    // Copy-on-write so callers can still modify the images in place without touching the file
+    ScopedHandle hMapping(CreateFileMappingW(hFile, nullptr, PAGE_WRITECOPY, 0, 0, nullptr));
+    if (!hMapping)
+    {
+        Release();
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    m_view = MapViewOfFile(hMapping.get(), FILE_MAP_COPY, 0, 0, 0);
+    if (!m_view)
+    {
+        Release();
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    m_memory = static_cast<uint8_t*>(m_view) + offset;
+    m_size = pixelSize;
+    if (!_SetupImageArray(m_memory, pixelSize, m_metadata, CP_FLAGS_NONE, m_image, nimages))
+    {
+        Release();
+        return E_FAIL;
+    }
+
+    return S_OK;
+#endif // USE_FILE_MAPPING
+}
+
 void ScratchImage::Release()
 {
     m_nimages = 0;
-    m_size = 0;
 
     if (m_image)
     {
@@ -688,12 +774,25 @@ void ScratchImage::Release()
         m_image = nullptr;
     }
 
+#ifdef USE_FILE_MAPPING
+    if (m_view)
+    {
+        // m_memory points into the mapped view
+        UnmapViewOfFile(m_view);
+        m_view = nullptr;
+        m_memory = nullptr;
+    }
+    else
+#endif
     if (m_memory)
     {
-        _aligned_free(m_memory);
+        m_allocator->Free(m_memory, m_size);
         m_memory = nullptr;
     }
 
+    m_size = 0;
+    m_allocator = nullptr;
+
     memset(&m_metadata, 0, sizeof(m_metadata));
 }
 
@@ -821,3 +920,118 @@ bool ScratchImage::IsAlphaAllOpaque() const
 
     return true;
 }
+
+
+//=====================================================================================
+// ScratchImageView - Non-owning view of an image array subset
+//=====================================================================================
+
+_Use_decl_annotations_
+HRESULT ScratchImageView::Initialize(const ScratchImage& image, size_t mipStart, size_t mipCount, size_t itemStart, size_t itemCount)
+{
+    return Initialize(image.GetImages(), image.GetImageCount(), image.GetMetadata(), mipStart, mipCount, itemStart, itemCount);
+}
+
+_Use_decl_annotations_
+HRESULT ScratchImageView::Initialize(
+    const Image* images,
+    size_t nimages,
+    const TexMetadata& metadata,
+    size_t mipStart,
+    size_t mipCount,
+    size_t itemStart,
+    size_t itemCount)
+{
+    Release();
+
+    if (!images || !nimages)
+        return E_INVALIDARG;
+
+    size_t items = (metadata.dimension == TEX_DIMENSION_TEXTURE3D) ? 1 : metadata.arraySize;
+
+    if (!mipCount)
+        mipCount = (mipStart < metadata.mipLevels) ? (metadata.mipLevels - mipStart) : 0;
+
+    if (!itemCount)
+        itemCount = (itemStart < items) ? (items - itemStart) : 0;
+
+    if (!mipCount || (mipStart + mipCount) > metadata.mipLevels || !itemCount || (itemStart + itemCount) > items)
+        return E_INVALIDARG;
+
+    // Describe the subset
+    TexMetadata sdata = metadata;
+    sdata.width = std::max<size_t>(1, metadata.width >> mipStart);
+    sdata.height = std::max<size_t>(1, metadata.height >> mipStart);
+    sdata.depth = std::max<size_t>(1, metadata.depth >> mipStart);
+    sdata.mipLevels = mipCount;
+    sdata.arraySize = itemCount;
+
+    if (metadata.IsCubemap() && ((itemStart % 6) != 0 || (itemCount % 6) != 0))
+    {
+        // Not whole cubes, so it is viewed as a 2D array
+        sdata.miscFlags &= ~static_cast<uint32_t>(TEX_MISC_TEXTURECUBE);
+    }
+
+    // Gather the subset's entries in the same order a ScratchImage lays them out
+    std::vector<Image> subset;
+
+    switch (metadata.dimension)
+    {
+    case TEX_DIMENSION_TEXTURE1D:
+    case TEX_DIMENSION_TEXTURE2D:
+        subset.reserve(itemCount * mipCount);
+
+        for (size_t item = itemStart; item < itemStart + itemCount; ++item)
+        {
+            for (size_t level = mipStart; level < mipStart + mipCount; ++level)
+            {
+                size_t index = metadata.ComputeIndex(level, item, 0);
+                if (index >= nimages)
+                    return E_FAIL;
+
+                subset.push_back(images[index]);
+            }
+        }
+        break;
+
+    case TEX_DIMENSION_TEXTURE3D:
+        for (size_t level = mipStart; level < mipStart + mipCount; ++level)
+        {
+            size_t d = std::max<size_t>(1, metadata.depth >> level);
+
+            for (size_t slice = 0; slice < d; ++slice)
+            {
+                size_t index = metadata.ComputeIndex(level, 0, slice);
+                if (index >= nimages)
+                    return E_FAIL;
+
+                subset.push_back(images[index]);
+            }
+        }
+        break;
+
+    default:
+        return E_FAIL;
+    }
+
+    m_metadata = sdata;
+    m_images.swap(subset);
+
+    return S_OK;
+}
+
+void ScratchImageView::Release()
+{
+    memset(&m_metadata, 0, sizeof(m_metadata));
+    m_images.clear();
+}
+
+_Use_decl_annotations_
+const Image* ScratchImageView::GetImage(size_t mip, size_t item, size_t slice) const
+{
+    size_t index = m_metadata.ComputeIndex(mip, item, slice);
+    if (index >= m_images.size())
+        return nullptr;
+
+    return &m_images[index];
+}
@@ -13,11 +13,27 @@
 
 #include "filters.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#pragma warning(disable : 4616 6993)
+#endif
+
+namespace DirectX
+{
+    extern HRESULT _CompressImage(_In_ const Image& image, _In_ const Image& result, _In_ DWORD compress, _In_ float threshold);
+}
+
 using namespace DirectX;
 using Microsoft::WRL::ComPtr;
 
 namespace
 {
+    // Default temporary memory budget and maximum band height for the triangle filter
+    const size_t c_TriangleFilterMemory = 64 * 1024 * 1024;
+    const size_t c_TriangleBandHeight = 64;
+
+    volatile size_t g_TriangleFilterMemory = c_TriangleFilterMemory;
+
     inline bool ispow2(_In_ size_t x)
     {
         return ((x != 0) && !(x & (x - 1)));
@@ -374,6 +390,206 @@ namespace DirectX
 
         return hr;
     }
+
+    //--- Triangle filter resize using bounded memory ---
+    // Destination rows are produced in bands; each band walks the Y filter in source order and only loads the
+    // source scanlines that contribute to it, so temporary memory is one source scanline plus the band's
+    // accumulation rows per thread no matter how large the image is. Every accumulation row still receives its
+    // contributions in the same order as a single full-height pass, so results do not depend on the banding.
+    HRESULT _ResizeTriangleFilter(
+        _In_ const Image& srcImage,
+        _In_ DWORD filter,
+        _In_ const Image& destImage)
+    {
+        if (!srcImage.pixels || !destImage.pixels)
+            return E_POINTER;
+
+        assert(srcImage.format == destImage.format);
+
+        using namespace TriangleFilter;
+
+        const size_t maxMemory = g_TriangleFilterMemory;
+
+        std::unique_ptr<Filter> tfX;
+        HRESULT hr = _Create(srcImage.width, destImage.width, (filter & TEX_FILTER_WRAP_U) != 0, tfX);
+        if (FAILED(hr))
+            return hr;
+
+        std::unique_ptr<Filter> tfY;
+        hr = _Create(srcImage.height, destImage.height, (filter & TEX_FILTER_WRAP_V) != 0, tfY);
+        if (FAILED(hr))
+            return hr;
+
+        // Size the bands to fit the memory budget (1 source scanline and bandHeight accumulation rows per thread)
+        const size_t srcBytes = sizeof(XMVECTOR) * srcImage.width;
+        const size_t accBytes = sizeof(XMVECTOR) * destImage.width;
+        if (maxMemory < srcBytes + accBytes)
+            return E_OUTOFMEMORY;
+
+        size_t threads = 1;
+#ifdef _OPENMP
+        if (_UseParallel())
+        {
+            threads = std::min<size_t>(static_cast<size_t>(omp_get_max_threads()), maxMemory / (srcBytes + accBytes));
+            if (!threads)
+                threads = 1;
+        }
+#endif
+
+        size_t bandHeight = std::min<size_t>(std::min<size_t>(c_TriangleBandHeight, destImage.height),
+            (maxMemory / threads - srcBytes) / accBytes);
+        if (!bandHeight)
+            bandHeight = 1;
+
+        const size_t bands = (destImage.height + bandHeight - 1) / bandHeight;
+        if (bands < threads)
+            threads = bands;
+
+        auto xFromEnd = reinterpret_cast<const FilterFrom*>(reinterpret_cast<const uint8_t*>(tfX.get()) + tfX->sizeInBytes);
+        auto yFromEnd = reinterpret_cast<const FilterFrom*>(reinterpret_cast<const uint8_t*>(tfY.get()) + tfY->sizeInBytes);
+
+        const size_t rowPitch = srcImage.rowPitch;
+        const uint8_t* pEndSrc = srcImage.pixels + rowPitch * srcImage.height;
+
+        bool fail = false;
+        bool nomem = false;
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(static_cast<int>(threads)) if (threads > 1)
+#endif
+        {
+            ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc(srcBytes + accBytes * bandHeight, 16)));
+            if (!scanline)
+            {
+                nomem = true;
+            }
+            else
+            {
+                XMVECTOR* row = scanline.get();
+                XMVECTOR* acc = row + srcImage.width;
+
+#ifdef _DEBUG
+                memset(row, 0xCD, srcBytes);
+#endif
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+                for (int band = 0; band < static_cast<int>(bands); ++band)
+                {
+                    if (fail || nomem)
+                        continue;
+
+                    const size_t v0 = size_t(band) * bandHeight;
+                    const size_t v1 = std::min(v0 + bandHeight, destImage.height);
+
+                    memset(acc, 0, accBytes * (v1 - v0));
+
+                    const uint8_t* pSrc = srcImage.pixels;
+
+                    for (const FilterFrom* yFrom = tfY->from; yFrom < yFromEnd; pSrc += rowPitch)
+                    {
+                        // Skip source scanlines that do not touch this band
+                        bool used = false;
+                        for (size_t j = 0; j < yFrom->count; ++j)
+                        {
+                            size_t v = yFrom->to[j].u;
+                            assert(v < destImage.height);
+                            if (v >= v0 && v < v1)
+                            {
+                                used = true;
+                                break;
+                            }
+                        }
+
+                        if (used)
+                        {
+                            // Load source scanline
+                            if ((pSrc + rowPitch) > pEndSrc
+                                || !_LoadScanlineLinear(row, srcImage.width, pSrc, rowPitch, srcImage.format, filter))
+                            {
+                                fail = true;
+                                break;
+                            }
+
+                            // Process row
+                            size_t x = 0;
+                            for (const FilterFrom* xFrom = tfX->from; xFrom < xFromEnd; ++x)
+                            {
+                                for (size_t j = 0; j < yFrom->count; ++j)
+                                {
+                                    size_t v = yFrom->to[j].u;
+                                    if (v < v0 || v >= v1)
+                                        continue;
+
+                                    float yweight = yFrom->to[j].weight;
+
+                                    XMVECTOR* accPtr = acc + destImage.width * (v - v0);
+
+                                    for (size_t k = 0; k < xFrom->count; ++k)
+                                    {
+                                        size_t u = xFrom->to[k].u;
+                                        assert(u < destImage.width);
+
+                                        XMVECTOR weight = XMVectorReplicate(yweight * xFrom->to[k].weight);
+
+                                        assert(x < srcImage.width);
+                                        accPtr[u] = XMVectorMultiplyAdd(row[x], weight, accPtr[u]);
+                                    }
+                                }
+
+                                xFrom = reinterpret_cast<const FilterFrom*>(reinterpret_cast<const uint8_t*>(xFrom) + xFrom->sizeInBytes);
+                            }
+                        }
+
+                        yFrom = reinterpret_cast<const FilterFrom*>(reinterpret_cast<const uint8_t*>(yFrom) + yFrom->sizeInBytes);
+                    }
+
+                    if (fail)
+                        continue;
+
+                    // Write completed accumulation rows
+                    for (size_t v = v0; v < v1; ++v)
+                    {
+                        XMVECTOR* pAccSrc = acc + destImage.width * (v - v0);
+
+                        switch (destImage.format)
+                        {
+                        case DXGI_FORMAT_R10G10B10A2_UNORM:
+                        case DXGI_FORMAT_R10G10B10A2_UINT:
+                        {
+                            // Need to slightly bias results for floating-point error accumulation which can
+                            // be visible with harshly quantized values
+                            static const XMVECTORF32 Bias = { { { 0.f, 0.f, 0.f, 0.1f } } };
+
+                            XMVECTOR* ptr = pAccSrc;
+                            for (size_t i = 0; i < destImage.width; ++i, ++ptr)
+                            {
+                                *ptr = XMVectorAdd(*ptr, Bias);
+                            }
+                        }
+                        break;
+
+                        default:
+                            break;
+                        }
+
+                        // This performs any required clamping
+                        if (!_StoreScanlineLinear(destImage.pixels + (destImage.rowPitch * v), destImage.rowPitch, destImage.format, pAccSrc, destImage.width, filter))
+                        {
+                            fail = true;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        if (nomem)
+            return E_OUTOFMEMORY;
+
+        return fail ? E_FAIL : S_OK;
+    }
 }
 
 namespace
@@ -399,6 +615,13 @@ namespace
             return false;
         }
 
+        if (filter & TEX_FILTER_SEPARATE_ALPHA)
+        {
+            // The custom filters already treat color and alpha as independent channels, so they give this result
+            // directly (and multithreaded) instead of resizing twice with WIC and merging
+            return false;
+        }
+
 #if defined(_XBOX_ONE) && defined(_TITLE)
         if (format == DXGI_FORMAT_R16G16B16A16_FLOAT
             || format == DXGI_FORMAT_R16_FLOAT)
@@ -594,6 +817,14 @@ namespace
     //-------------------------------------------------------------------------------------
     // Generate (1D/2D) mip-map helpers (custom filtering)
     //-------------------------------------------------------------------------------------
+    // Called once each mip level has been written (see GenerateMipMapsCompressed)
+    typedef std::function<HRESULT __cdecl(size_t level)> MipLevelCallback;
+
+    inline HRESULT LevelDone(_In_opt_ const MipLevelCallback* levelDone, size_t level)
+    {
+        return (levelDone) ? (*levelDone)(level) : S_OK;
+    }
+
     HRESULT Setup2DMips(
         _In_reads_(nimages) const Image* baseImages,
         _In_ size_t nimages,
@@ -610,7 +841,7 @@ namespace
         assert(mdata.height == baseImages[0].height);
         assert(mdata.format == baseImages[0].format);
 
-        HRESULT hr = mipChain.Initialize(mdata);
+        HRESULT hr = mipChain.Initialize(mdata, _ScratchPitchFlags());
         if (FAILED(hr))
             return hr;
 
@@ -649,8 +880,9 @@ namespace
         return S_OK;
     }
 
+
     //--- 2D Point Filter ---
-    HRESULT Generate2DMipsPointFilter(size_t levels, const ScratchImage& mipChain, size_t item)
+    HRESULT Generate2DMipsPointFilter(size_t levels, const ScratchImage& mipChain, size_t item, const MipLevelCallback* levelDone = nullptr)
     {
         if (!mipChain.GetImages())
             return E_INVALIDARG;
@@ -662,22 +894,9 @@ namespace
         size_t width = mipChain.GetMetadata().width;
         size_t height = mipChain.GetMetadata().height;
 
-        // Allocate temporary space (2 scanlines)
-        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc((sizeof(XMVECTOR)*width * 2), 16)));
-        if (!scanline)
-            return E_OUTOFMEMORY;
-
-        XMVECTOR* target = scanline.get();
-
-        XMVECTOR* row = target + width;
-
         // Resize base image to each target mip level
         for (size_t level = 1; level < levels; ++level)
         {
-#ifdef _DEBUG
-            memset(row, 0xCD, sizeof(XMVECTOR)*width);
-#endif
-
             // 2D point filter
             const Image* src = mipChain.GetImage(level - 1, item, 0);
             const Image* dest = mipChain.GetImage(level, item, 0);
@@ -685,9 +904,6 @@ namespace
             if (!src || !dest)
                 return E_POINTER;
 
-            const uint8_t* pSrc = src->pixels;
-            uint8_t* pDest = dest->pixels;
-
             size_t rowPitch = src->rowPitch;
 
             size_t nwidth = (width > 1) ? (width >> 1) : 1;
@@ -696,31 +912,56 @@ namespace
             size_t xinc = (width << 16) / nwidth;
             size_t yinc = (height << 16) / nheight;
 
-            size_t lasty = size_t(-1);
-
-            size_t sy = 0;
-            for (size_t y = 0; y < nheight; ++y)
+            // Each band uses 2 scanlines
+            auto pointRows = [&](size_t y0, size_t y1, XMVECTOR* scanline) -> bool
             {
-                if ((lasty ^ sy) >> 16)
-                {
-                    if (!_LoadScanline(row, width, pSrc + (rowPitch * (sy >> 16)), rowPitch, src->format))
-                        return E_FAIL;
-                    lasty = sy;
-                }
+                XMVECTOR* target = scanline;
+
+                XMVECTOR* row = target + width;
+
+#ifdef _DEBUG
+                memset(row, 0xCD, sizeof(XMVECTOR)*width);
+#endif
+
+                const uint8_t* pSrc = src->pixels;
+                uint8_t* pDest = dest->pixels + dest->rowPitch * y0;
 
-                size_t sx = 0;
-                for (size_t x = 0; x < nwidth; ++x)
+                size_t lasty = size_t(-1);
+
+                size_t sy = yinc * y0;
+                for (size_t y = y0; y < y1; ++y)
                 {
-                    target[x] = row[sx >> 16];
-                    sx += xinc;
+                    if ((lasty ^ sy) >> 16)
+                    {
+                        if (!_LoadScanline(row, width, pSrc + (rowPitch * (sy >> 16)), rowPitch, src->format))
+                            return false;
+                        lasty = sy;
+                    }
+
+                    size_t sx = 0;
+                    for (size_t x = 0; x < nwidth; ++x)
+                    {
+                        target[x] = row[sx >> 16];
+                        sx += xinc;
+                    }
+
+                    if (!_StoreScanline(pDest, dest->rowPitch, dest->format, target, nwidth))
+                        return false;
+                    pDest += dest->rowPitch;
+
+                    sy += yinc;
                 }
 
-                if (!_StoreScanline(pDest, dest->rowPitch, dest->format, target, nwidth))
-                    return E_FAIL;
-                pDest += dest->rowPitch;
+                return true;
+            };
 
-                sy += yinc;
-            }
+            HRESULT hr = _ProcessRowBands(nheight, width * 2, pointRows);
+            if (FAILED(hr))
+                return hr;
+
+            hr = LevelDone(levelDone, level);
+            if (FAILED(hr))
+                return hr;
 
             if (height > 1)
                 height >>= 1;
@@ -733,118 +974,634 @@ namespace
     }
 
 
-    //--- 2D Box Filter ---
-    HRESULT Generate2DMipsBoxFilter(size_t levels, DWORD filter, const ScratchImage& mipChain, size_t item)
-    {
-        if (!mipChain.GetImages())
-            return E_INVALIDARG;
+    //--- 3D slices ---
 
-        // This assumes that the base image is already placed into the mipChain at the top level... (see _Setup2DMips)
+    // Destination slices of a volume mip level are independent of each other, so they are filtered in
+    // parallel with per-thread scanline buffers. The Z filter for the level is built once and shared.
+    template<typename Fn>
+    HRESULT ProcessMipSlices(size_t ndepth, size_t scanlines, Fn& fn)
+    {
+        bool fail = false;
+        bool outOfMemory = false;
 
-        assert(levels > 1);
+#ifdef _OPENMP
+#pragma omp parallel if (ndepth > 1 && _UseParallel())
+#endif
+        {
+            ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc((sizeof(XMVECTOR)*scanlines), 64)));
+            if (!scanline)
+                outOfMemory = true;
 
-        size_t width = mipChain.GetMetadata().width;
-        size_t height = mipChain.GetMetadata().height;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+            for (int slice = 0; slice < static_cast<int>(ndepth); ++slice)
+            {
+                if (!scanline || fail)
+                    continue;
 
-        if (!ispow2(width) || !ispow2(height))
-            return E_FAIL;
+                if (!fn(size_t(slice), scanline.get()))
+                    fail = true;
+            }
+        }
 
-        // Allocate temporary space (3 scanlines)
-        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc((sizeof(XMVECTOR)*width * 3), 16)));
-        if (!scanline)
+        if (outOfMemory)
             return E_OUTOFMEMORY;
 
-        XMVECTOR* target = scanline.get();
+        return (fail) ? E_FAIL : S_OK;
+    }
 
-        XMVECTOR* urow0 = target + width;
-        XMVECTOR* urow1 = target + width * 2;
 
-        const XMVECTOR* urow2 = urow0 + 1;
-        const XMVECTOR* urow3 = urow1 + 1;
+    //--- 2D 8-bit box filter (power-of-two) ---
 
-        // Resize base image to each target mip level
-        for (size_t level = 1; level < levels; ++level)
+    // 4-channel 8-bit levels are box filtered as integers instead of going through XMVECTOR. sRGB color is
+    // averaged in linear space through lookup tables (8-bit sRGB to 16-bit linear, and the top 12 bits of
+    // linear back to 8-bit sRGB); alpha is always averaged directly.
+    //
+    // The integer average rounds halves up, while the float path rounds the float average to nearest even,
+    // so where four texels sum to an exact half the two paths can differ by one code value. This applies to
+    // UNORM as well as sRGB, where the 12-bit lookup back from linear can also round differently.
+    bool UseBox8Filter(DXGI_FORMAT format, DWORD filter, bool& srgb)
+    {
+        switch (format)
         {
-            if (height <= 1)
-            {
-                urow1 = urow0;
-            }
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+            break;
 
-            if (width <= 1)
-            {
-                urow2 = urow0;
-                urow3 = urow1;
-            }
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+            filter |= TEX_FILTER_SRGB;
+            break;
 
-            // 2D box filter
-            const Image* src = mipChain.GetImage(level - 1, item, 0);
-            const Image* dest = mipChain.GetImage(level, item, 0);
+        default:
+            return false;
+        }
 
-            if (!src || !dest)
-                return E_POINTER;
+        // sRGB in without sRGB out (or vice-versa) is a conversion, so leave it to the float path
+        switch (filter & TEX_FILTER_SRGB)
+        {
+        case 0:
+            srgb = false;
+            return true;
 
-            const uint8_t* pSrc = src->pixels;
-            uint8_t* pDest = dest->pixels;
+        case TEX_FILTER_SRGB:
+            srgb = true;
+            return true;
 
-            size_t rowPitch = src->rowPitch;
+        default:
+            return false;
+        }
+    }
 
-            size_t nwidth = (width > 1) ? (width >> 1) : 1;
-            size_t nheight = (height > 1) ? (height >> 1) : 1;
+    struct SRGBTables
+    {
+        uint16_t toLinear[256];
+        uint8_t fromLinear[4096];
 
-            for (size_t y = 0; y < nheight; ++y)
+        SRGBTables()
+        {
+            for (size_t j = 0; j < 256; ++j)
             {
-                if (!_LoadScanlineLinear(urow0, width, pSrc, rowPitch, src->format, filter))
-                    return E_FAIL;
-                pSrc += rowPitch;
-
-                if (urow0 != urow1)
-                {
-                    if (!_LoadScanlineLinear(urow1, width, pSrc, rowPitch, src->format, filter))
-                        return E_FAIL;
-                    pSrc += rowPitch;
-                }
-
-                for (size_t x = 0; x < nwidth; ++x)
-                {
-                    size_t x2 = x << 1;
-
-                    AVERAGE4(target[x], urow0[x2], urow1[x2], urow2[x2], urow3[x2]);
-                }
-
-                if (!_StoreScanlineLinear(pDest, dest->rowPitch, dest->format, target, nwidth, filter))
-                    return E_FAIL;
-                pDest += dest->rowPitch;
+                XMVECTOR v = XMColorSRGBToRGB(XMVectorReplicate(float(j) / 255.f));
+                toLinear[j] = static_cast<uint16_t>(XMVectorGetX(XMVectorSaturate(v)) * 65535.f + 0.5f);
             }
 
-            if (height > 1)
-                height >>= 1;
-
-            if (width > 1)
-                width >>= 1;
+            for (size_t j = 0; j < 4096; ++j)
+            {
+                XMVECTOR v = XMColorRGBToSRGB(XMVectorReplicate((float(j << 4) + 8.f) / 65535.f));
+                fromLinear[j] = static_cast<uint8_t>(XMVectorGetX(XMVectorSaturate(v)) * 255.f + 0.5f);
+            }
         }
+    };
 
-        return S_OK;
+    const SRGBTables& GetSRGBTables()
+    {
+        static const SRGBTables s_tables;
+        return s_tables;
     }
 
-
-    //--- 2D Linear Filter ---
-    HRESULT Generate2DMipsLinearFilter(size_t levels, DWORD filter, const ScratchImage& mipChain, size_t item)
+    void Box8Row(
+        _Out_writes_(nwidth * 4) uint8_t* pDest,
+        _In_reads_(width * 4) const uint8_t* pSrc0,
+        _In_reads_(width * 4) const uint8_t* pSrc1,
+        size_t width,
+        size_t nwidth)
     {
-        if (!mipChain.GetImages())
-            return E_INVALIDARG;
+        size_t x = 0;
 
-        // This assumes that the base image is already placed into the mipChain at the top level... (see _Setup2DMips)
+        if (width > 1)
+        {
+#if defined(_XM_SSE_INTRINSICS_)
+            // 2 destination pixels from 4 source pixels of each row
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i round = _mm_set1_epi16(2);
 
-        assert(levels > 1);
+            for (; x + 2 <= nwidth; x += 2)
+            {
+                __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc0 + x * 8));
+                __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc1 + x * 8));
 
-        size_t width = mipChain.GetMetadata().width;
-        size_t height = mipChain.GetMetadata().height;
+                __m128i sumA = _mm_add_epi16(_mm_unpacklo_epi8(r0, zero), _mm_unpacklo_epi8(r1, zero));
+                __m128i sumB = _mm_add_epi16(_mm_unpackhi_epi8(r0, zero), _mm_unpackhi_epi8(r1, zero));
 
-        // Allocate temporary space (3 scanlines, plus X and Y filters)
-        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc((sizeof(XMVECTOR)*width * 3), 16)));
-        if (!scanline)
-            return E_OUTOFMEMORY;
+                sumA = _mm_add_epi16(sumA, _mm_srli_si128(sumA, 8));
+                sumB = _mm_add_epi16(sumB, _mm_srli_si128(sumB, 8));
 
+                __m128i avg = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(sumA, sumB), round), 2);
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(pDest + x * 4), _mm_packus_epi16(avg, zero));
+            }
+#endif
+
+            for (; x < nwidth; ++x)
+            {
+                const uint8_t* s0 = pSrc0 + x * 8;
+                const uint8_t* s1 = pSrc1 + x * 8;
+                for (size_t c = 0; c < 4; ++c)
+                {
+                    pDest[x * 4 + c] = static_cast<uint8_t>((unsigned(s0[c]) + s0[c + 4] + s1[c] + s1[c + 4] + 2) >> 2);
+                }
+            }
+        }
+        else
+        {
+            for (size_t c = 0; c < 4; ++c)
+            {
+                pDest[c] = static_cast<uint8_t>((unsigned(pSrc0[c]) * 2 + pSrc1[c] * 2 + 2) >> 2);
+            }
+        }
+    }
+
+    void Box8RowSRGB(
+        _Out_writes_(nwidth * 4) uint8_t* pDest,
+        _In_reads_(width * 4) const uint8_t* pSrc0,
+        _In_reads_(width * 4) const uint8_t* pSrc1,
+        size_t width,
+        size_t nwidth,
+        const SRGBTables& tables)
+    {
+        const size_t next = (width > 1) ? 4 : 0;
+
+        for (size_t x = 0; x < nwidth; ++x)
+        {
+            const uint8_t* s0 = pSrc0 + x * 8;
+            const uint8_t* s1 = pSrc1 + x * 8;
+            uint8_t* d = pDest + x * 4;
+
+            for (size_t c = 0; c < 3; ++c)
+            {
+                unsigned sum = unsigned(tables.toLinear[s0[c]]) + tables.toLinear[s0[c + next]]
+                    + tables.toLinear[s1[c]] + tables.toLinear[s1[c + next]];
+                d[c] = tables.fromLinear[((sum + 2) >> 2) >> 4];
+            }
+
+            d[3] = static_cast<uint8_t>((unsigned(s0[3]) + s0[3 + next] + s1[3] + s1[3 + next] + 2) >> 2);
+        }
+    }
+
+    HRESULT Generate2DMipsBox8Level(const Image& src, const Image& dest, bool srgb)
+    {
+        if (!src.pixels || !dest.pixels)
+            return E_POINTER;
+
+        assert(src.format == dest.format);
+
+        const SRGBTables* tables = (srgb) ? &GetSRGBTables() : nullptr;
+
+        const size_t width = src.width;
+        const size_t nwidth = dest.width;
+        const size_t nheight = dest.height;
+        const size_t srcStep = (src.height > 1) ? src.rowPitch : 0;
+
+#ifdef _OPENMP
+#pragma omp parallel for if (nheight >= c_RowBandHeight && _UseParallel())
+#endif
+        for (int y = 0; y < static_cast<int>(nheight); ++y)
+        {
+            const uint8_t* pSrc0 = src.pixels + src.rowPitch * size_t(y) * ((src.height > 1) ? 2 : 1);
+            const uint8_t* pSrc1 = pSrc0 + srcStep;
+            uint8_t* pDest = dest.pixels + dest.rowPitch * size_t(y);
+
+            if (tables)
+            {
+                Box8RowSRGB(pDest, pSrc0, pSrc1, width, nwidth, *tables);
+            }
+            else
+            {
+                Box8Row(pDest, pSrc0, pSrc1, width, nwidth);
+            }
+        }
+
+        return S_OK;
+    }
+
+
+    //--- 2D single-pass tiles (power-of-two) ---
+
+    // With power-of-two sizes, every 2x2 box of a level comes from one aligned tile of the level above, so
+    // the upper part of the chain is produced tile by tile from a single read of the base image while the
+    // tile is still in cache. Each level is requantized to the format before the next is made from it and
+    // uses the same arithmetic as the per-level filter (box, 8-bit box, or linear), so the result matches
+    // the per-level path exactly. Returns the first level (and its source size) still left for the per-level
+    // filters.
+    const size_t c_MipTileSize = 64;
+
+    HRESULT Generate2DMipsTiles(
+        size_t levels,
+        DWORD filter,
+        bool linear,
+        const ScratchImage& mipChain,
+        size_t item,
+        _Out_ size_t& nextLevel,
+        _Inout_ size_t& width,
+        _Inout_ size_t& height)
+    {
+        nextLevel = 1;
+
+        assert(ispow2(width) && ispow2(height));
+
+        const Image* base = mipChain.GetImage(0, item, 0);
+        if (!base || !base->pixels)
+            return E_POINTER;
+
+        const DXGI_FORMAT format = base->format;
+
+        // Tiles are addressed by byte offset within a scanline
+        size_t bpp = BitsPerPixel(format);
+        if (IsPacked(format) || !bpp || (bpp % 8) != 0)
+            return S_OK;
+
+        bpp /= 8;
+
+        bool srgb = false;
+        const bool box8 = !linear && UseBox8Filter(format, filter, srgb);
+        const SRGBTables* tables = (box8 && srgb) ? &GetSRGBTables() : nullptr;
+
+        const size_t tw = std::min(c_MipTileSize, width);
+        const size_t th = std::min(c_MipTileSize, height);
+
+        // A level can be made within the tile until the tile shrinks to 1 in a direction the level does not
+        size_t tlevels = 0;
+        {
+            size_t w = width;
+            size_t h = height;
+            size_t lw = tw;
+            size_t lh = th;
+            while ((1 + tlevels) < levels)
+            {
+                if ((lw == 1 && w > 1) || (lh == 1 && h > 1))
+                    break;
+
+                if (w > 1) { w >>= 1; lw >>= 1; }
+                if (h > 1) { h >>= 1; lh >>= 1; }
+
+                ++tlevels;
+            }
+        }
+
+        if (!tlevels)
+            return S_OK;
+
+        const size_t ntx = width / tw;
+        const size_t ntiles = ntx * (height / th);
+
+        // 8-bit tiles stay in the format; float tiles need one more scanline for storing (which converts in-place)
+        const size_t tileBytes = (box8) ? (tw * th * 4) : (sizeof(XMVECTOR) * (tw * th + tw));
+
+        bool fail = false;
+        bool outOfMemory = false;
+
+#ifdef _OPENMP
+#pragma omp parallel if (ntiles > 1 && _UseParallel())
+#endif
+        {
+            ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc(tileBytes, 16)));
+            if (!scanline)
+                outOfMemory = true;
+
+#ifdef _OPENMP
+#pragma omp for
+#endif
+            for (int t = 0; t < static_cast<int>(ntiles); ++t)
+            {
+                if (!scanline || fail)
+                    continue;
+
+                const size_t tx = size_t(t) % ntx;
+                const size_t ty = size_t(t) / ntx;
+
+                if (box8)
+                {
+                    uint8_t* tile = reinterpret_cast<uint8_t*>(scanline.get());
+
+                    // Load tile from the base level
+                    const uint8_t* pSrc = base->pixels + base->rowPitch * ty * th + tx * tw * 4;
+                    for (size_t y = 0; y < th; ++y)
+                    {
+                        memcpy(tile + y * tw * 4, pSrc, tw * 4);
+                        pSrc += base->rowPitch;
+                    }
+
+                    size_t lw = tw;
+                    size_t lh = th;
+                    for (size_t level = 1; level <= tlevels; ++level)
+                    {
+                        const size_t nlw = (lw > 1) ? (lw >> 1) : 1;
+                        const size_t nlh = (lh > 1) ? (lh >> 1) : 1;
+
+                        // Reduced in-place, as in the float tile below
+                        for (size_t y = 0; y < nlh; ++y)
+                        {
+                            const uint8_t* urow0 = tile + ((lh > 1) ? (y << 1) : y) * lw * 4;
+                            const uint8_t* urow1 = (lh > 1) ? (urow0 + lw * 4) : urow0;
+
+                            if (tables)
+                            {
+                                Box8RowSRGB(tile + y * nlw * 4, urow0, urow1, lw, nlw, *tables);
+                            }
+                            else
+                            {
+                                Box8Row(tile + y * nlw * 4, urow0, urow1, lw, nlw);
+                            }
+                        }
+
+                        const Image* dest = mipChain.GetImage(level, item, 0);
+                        if (!dest || !dest->pixels)
+                        {
+                            fail = true;
+                            break;
+                        }
+
+                        uint8_t* pDest = dest->pixels + dest->rowPitch * ty * nlh + tx * nlw * 4;
+                        for (size_t y = 0; y < nlh; ++y)
+                        {
+                            memcpy(pDest, tile + y * nlw * 4, nlw * 4);
+                            pDest += dest->rowPitch;
+                        }
+
+                        lw = nlw;
+                        lh = nlh;
+                    }
+
+                    continue;
+                }
+
+                XMVECTOR* tile = scanline.get();
+                XMVECTOR* row = tile + tw * th;
+
+                // Load tile from the base level
+                {
+                    const size_t xoffset = tx * tw * bpp;
+                    const uint8_t* pSrc = base->pixels + base->rowPitch * ty * th + xoffset;
+                    for (size_t y = 0; y < th; ++y)
+                    {
+                        if (!_LoadScanlineLinear(tile + y * tw, tw, pSrc, base->rowPitch - xoffset, format, filter))
+                        {
+                            fail = true;
+                            break;
+                        }
+                        pSrc += base->rowPitch;
+                    }
+
+                    if (fail)
+                        continue;
+                }
+
+                size_t lw = tw;
+                size_t lh = th;
+                for (size_t level = 1; level <= tlevels; ++level)
+                {
+                    const size_t nlw = (lw > 1) ? (lw >> 1) : 1;
+                    const size_t nlh = (lh > 1) ? (lh >> 1) : 1;
+
+                    // Halving weighs each pair equally; a size of 1 takes the single texel (see _CreateLinearFilter)
+                    LinearFilter toX = { 0, (lw > 1) ? 0.5f : 0.f, 0, (lw > 1) ? 0.5f : 1.f };
+                    LinearFilter toY = { 0, (lh > 1) ? 0.5f : 0.f, 0, (lh > 1) ? 0.5f : 1.f };
+
+                    // 2D filter, reduced in-place (no pixel is read after its index has been written)
+                    for (size_t y = 0; y < nlh; ++y)
+                    {
+                        const XMVECTOR* urow0 = tile + ((lh > 1) ? (y << 1) : y) * lw;
+                        const XMVECTOR* urow1 = (lh > 1) ? (urow0 + lw) : urow0;
+
+                        XMVECTOR* target = tile + y * nlw;
+                        for (size_t x = 0; x < nlw; ++x)
+                        {
+                            const size_t x2 = (lw > 1) ? (x << 1) : x;
+                            const size_t x3 = (lw > 1) ? (x2 + 1) : x2;
+
+                            if (linear)
+                            {
+                                toX.u0 = x2;
+                                toX.u1 = x3;
+
+                                BILINEAR_INTERPOLATE(target[x], toX, toY, urow0, urow1);
+                            }
+                            else
+                            {
+                                AVERAGE4(target[x], urow0[x2], urow1[x2], urow0[x3], urow1[x3]);
+                            }
+                        }
+                    }
+
+                    const Image* dest = mipChain.GetImage(level, item, 0);
+                    if (!dest || !dest->pixels)
+                    {
+                        fail = true;
+                        break;
+                    }
+
+                    // Store, then reload what was stored so the next level starts from the quantized values
+                    const size_t xoffset = tx * nlw * bpp;
+                    uint8_t* pDest = dest->pixels + dest->rowPitch * ty * nlh + xoffset;
+                    for (size_t y = 0; y < nlh; ++y)
+                    {
+                        memcpy(row, tile + y * nlw, sizeof(XMVECTOR) * nlw);
+                        if (!_StoreScanlineLinear(pDest, dest->rowPitch - xoffset, format, row, nlw, filter))
+                        {
+                            fail = true;
+                            break;
+                        }
+
+                        if (level < tlevels
+                            && !_LoadScanlineLinear(tile + y * nlw, nlw, pDest, dest->rowPitch - xoffset, format, filter))
+                        {
+                            fail = true;
+                            break;
+                        }
+                        pDest += dest->rowPitch;
+                    }
+
+                    if (fail)
+                        break;
+
+                    lw = nlw;
+                    lh = nlh;
+                }
+            }
+        }
+
+        if (outOfMemory)
+            return E_OUTOFMEMORY;
+
+        if (fail)
+            return E_FAIL;
+
+        for (size_t level = 0; level < tlevels; ++level)
+        {
+            if (height > 1)
+                height >>= 1;
+
+            if (width > 1)
+                width >>= 1;
+        }
+
+        nextLevel = 1 + tlevels;
+
+        return S_OK;
+    }
+
+
+    //--- 2D Box Filter ---
+    HRESULT Generate2DMipsBoxFilter(size_t levels, DWORD filter, const ScratchImage& mipChain, size_t item, const MipLevelCallback* levelDone = nullptr)
+    {
+        if (!mipChain.GetImages())
+            return E_INVALIDARG;
+
+        // This assumes that the base image is already placed into the mipChain at the top level... (see _Setup2DMips)
+
+        assert(levels > 1);
+
+        size_t width = mipChain.GetMetadata().width;
+        size_t height = mipChain.GetMetadata().height;
+
+        if (!ispow2(width) || !ispow2(height))
+            return E_FAIL;
+
+        bool srgb = false;
+        const bool box8 = UseBox8Filter(mipChain.GetMetadata().format, filter, srgb);
+
+        size_t level;
+        HRESULT hr = Generate2DMipsTiles(levels, filter, false, mipChain, item, level, width, height);
+        if (FAILED(hr))
+            return hr;
+
+        for (size_t tlevel = 1; tlevel < level; ++tlevel)
+        {
+            hr = LevelDone(levelDone, tlevel);
+            if (FAILED(hr))
+                return hr;
+        }
+
+        // Resize to each remaining target mip level
+        for (; level < levels; ++level)
+        {
+            // 2D box filter
+            const Image* src = mipChain.GetImage(level - 1, item, 0);
+            const Image* dest = mipChain.GetImage(level, item, 0);
+
+            if (!src || !dest)
+                return E_POINTER;
+
+            if (box8)
+            {
+                hr = Generate2DMipsBox8Level(*src, *dest, srgb);
+                if (FAILED(hr))
+                    return hr;
+
+                hr = LevelDone(levelDone, level);
+                if (FAILED(hr))
+                    return hr;
+
+                if (height > 1)
+                    height >>= 1;
+
+                if (width > 1)
+                    width >>= 1;
+
+                continue;
+            }
+
+            size_t rowPitch = src->rowPitch;
+
+            size_t nwidth = (width > 1) ? (width >> 1) : 1;
+            size_t nheight = (height > 1) ? (height >> 1) : 1;
+
+            // Each band uses 3 scanlines
+            auto boxRows = [&](size_t y0, size_t y1, XMVECTOR* scanline) -> bool
+            {
+                XMVECTOR* target = scanline;
+
+                XMVECTOR* urow0 = target + width;
+                XMVECTOR* urow1 = (height > 1) ? (target + width * 2) : urow0;
+
+                const XMVECTOR* urow2 = (width > 1) ? (urow0 + 1) : urow0;
+                const XMVECTOR* urow3 = (width > 1) ? (urow1 + 1) : urow1;
+
+                const uint8_t* pSrc = src->pixels + rowPitch * y0 * ((height > 1) ? 2 : 1);
+                uint8_t* pDest = dest->pixels + dest->rowPitch * y0;
+
+                for (size_t y = y0; y < y1; ++y)
+                {
+                    if (!_LoadScanlineLinear(urow0, width, pSrc, rowPitch, src->format, filter))
+                        return false;
+                    pSrc += rowPitch;
+
+                    if (urow0 != urow1)
+                    {
+                        if (!_LoadScanlineLinear(urow1, width, pSrc, rowPitch, src->format, filter))
+                            return false;
+                        pSrc += rowPitch;
+                    }
+
+                    for (size_t x = 0; x < nwidth; ++x)
+                    {
+                        size_t x2 = x << 1;
+
+                        AVERAGE4(target[x], urow0[x2], urow1[x2], urow2[x2], urow3[x2]);
+                    }
+
+                    if (!_StoreScanlineLinear(pDest, dest->rowPitch, dest->format, target, nwidth, filter))
+                        return false;
+                    pDest += dest->rowPitch;
+                }
+
+                return true;
+            };
+
+            hr = _ProcessRowBands(nheight, width * 3, boxRows);
+            if (FAILED(hr))
+                return hr;
+
+            hr = LevelDone(levelDone, level);
+            if (FAILED(hr))
+                return hr;
+
+            if (height > 1)
+                height >>= 1;
+
+            if (width > 1)
+                width >>= 1;
+        }
+
+        return S_OK;
+    }
+
+
+    //--- 2D Linear Filter ---
+    HRESULT Generate2DMipsLinearFilter(size_t levels, DWORD filter, const ScratchImage& mipChain, size_t item, const MipLevelCallback* levelDone = nullptr)
+    {
+        if (!mipChain.GetImages())
+            return E_INVALIDARG;
+
+        // This assumes that the base image is already placed into the mipChain at the top level... (see _Setup2DMips)
+
+        assert(levels > 1);
+
+        size_t width = mipChain.GetMetadata().width;
+        size_t height = mipChain.GetMetadata().height;
+
+        // Allocate X and Y filters (scanlines are allocated per band)
         std::unique_ptr<LinearFilter[]> lf(new (std::nothrow) LinearFilter[width + height]);
         if (!lf)
             return E_OUTOFMEMORY;
@@ -852,13 +1609,24 @@ namespace
         LinearFilter* lfX = lf.get();
         LinearFilter* lfY = lf.get() + width;
 
-        XMVECTOR* target = scanline.get();
+        // Halving a power-of-two size weights each pair of texels equally, the same as the box filter
+        size_t level = 1;
+        if (ispow2(width) && ispow2(height))
+        {
+            HRESULT hr = Generate2DMipsTiles(levels, filter, true, mipChain, item, level, width, height);
+            if (FAILED(hr))
+                return hr;
 
-        XMVECTOR* row0 = target + width;
-        XMVECTOR* row1 = target + width * 2;
+            for (size_t tlevel = 1; tlevel < level; ++tlevel)
+            {
+                hr = LevelDone(levelDone, tlevel);
+                if (FAILED(hr))
+                    return hr;
+            }
+        }
 
-        // Resize base image to each target mip level
-        for (size_t level = 1; level < levels; ++level)
+        // Resize to each remaining target mip level
+        for (; level < levels; ++level)
         {
             // 2D linear filter
             const Image* src = mipChain.GetImage(level - 1, item, 0);
@@ -867,9 +1635,6 @@ namespace
             if (!src || !dest)
                 return E_POINTER;
 
-            const uint8_t* pSrc = src->pixels;
-            uint8_t* pDest = dest->pixels;
-
             size_t rowPitch = src->rowPitch;
 
             size_t nwidth = (width > 1) ? (width >> 1) : 1;
@@ -878,55 +1643,77 @@ namespace
             size_t nheight = (height > 1) ? (height >> 1) : 1;
             _CreateLinearFilter(height, nheight, (filter & TEX_FILTER_WRAP_V) != 0, lfY);
 
+            // Each band uses 3 scanlines
+            auto linearRows = [&](size_t y0, size_t y1, XMVECTOR* scanline) -> bool
+            {
+                XMVECTOR* target = scanline;
+
+                XMVECTOR* row0 = target + width;
+                XMVECTOR* row1 = target + width * 2;
+
 #ifdef _DEBUG
-            memset(row0, 0xCD, sizeof(XMVECTOR)*width);
-            memset(row1, 0xDD, sizeof(XMVECTOR)*width);
+                memset(row0, 0xCD, sizeof(XMVECTOR)*width);
+                memset(row1, 0xDD, sizeof(XMVECTOR)*width);
 #endif
 
-            size_t u0 = size_t(-1);
-            size_t u1 = size_t(-1);
+                const uint8_t* pSrc = src->pixels;
+                uint8_t* pDest = dest->pixels + dest->rowPitch * y0;
 
-            for (size_t y = 0; y < nheight; ++y)
-            {
-                auto& toY = lfY[y];
+                size_t u0 = size_t(-1);
+                size_t u1 = size_t(-1);
 
-                if (toY.u0 != u0)
+                for (size_t y = y0; y < y1; ++y)
                 {
-                    if (toY.u0 != u1)
+                    auto& toY = lfY[y];
+
+                    if (toY.u0 != u0)
                     {
-                        u0 = toY.u0;
+                        if (toY.u0 != u1)
+                        {
+                            u0 = toY.u0;
 
-                        if (!_LoadScanlineLinear(row0, width, pSrc + (rowPitch * u0), rowPitch, src->format, filter))
-                            return E_FAIL;
+                            if (!_LoadScanlineLinear(row0, width, pSrc + (rowPitch * u0), rowPitch, src->format, filter))
+                                return false;
+                        }
+                        else
+                        {
+                            u0 = u1;
+                            u1 = size_t(-1);
+
+                            std::swap(row0, row1);
+                        }
                     }
-                    else
+
+                    if (toY.u1 != u1)
                     {
-                        u0 = u1;
-                        u1 = size_t(-1);
+                        u1 = toY.u1;
 
-                        std::swap(row0, row1);
+                        if (!_LoadScanlineLinear(row1, width, pSrc + (rowPitch * u1), rowPitch, src->format, filter))
+                            return false;
                     }
-                }
 
-                if (toY.u1 != u1)
-                {
-                    u1 = toY.u1;
+                    for (size_t x = 0; x < nwidth; ++x)
+                    {
+                        auto& toX = lfX[x];
 
-                    if (!_LoadScanlineLinear(row1, width, pSrc + (rowPitch * u1), rowPitch, src->format, filter))
-                        return E_FAIL;
+                        BILINEAR_INTERPOLATE(target[x], toX, toY, row0, row1);
+                    }
+
+                    if (!_StoreScanlineLinear(pDest, dest->rowPitch, dest->format, target, nwidth, filter))
+                        return false;
+                    pDest += dest->rowPitch;
                 }
 
-                for (size_t x = 0; x < nwidth; ++x)
-                {
-                    auto& toX = lfX[x];
+                return true;
+            };
 
-                    BILINEAR_INTERPOLATE(target[x], toX, toY, row0, row1);
-                }
+            HRESULT hr = _ProcessRowBands(nheight, width * 3, linearRows);
+            if (FAILED(hr))
+                return hr;
 
-                if (!_StoreScanlineLinear(pDest, dest->rowPitch, dest->format, target, nwidth, filter))
-                    return E_FAIL;
-                pDest += dest->rowPitch;
-            }
+            hr = LevelDone(levelDone, level);
+            if (FAILED(hr))
+                return hr;
 
             if (height > 1)
                 height >>= 1;
@@ -939,7 +1726,7 @@ namespace
     }
 
     //--- 2D Cubic Filter ---
-    HRESULT Generate2DMipsCubicFilter(size_t levels, DWORD filter, const ScratchImage& mipChain, size_t item)
+    HRESULT Generate2DMipsCubicFilter(size_t levels, DWORD filter, const ScratchImage& mipChain, size_t item, const MipLevelCallback* levelDone = nullptr)
     {
         if (!mipChain.GetImages())
             return E_INVALIDARG;
@@ -951,11 +1738,7 @@ namespace
         size_t width = mipChain.GetMetadata().width;
         size_t height = mipChain.GetMetadata().height;
 
-        // Allocate temporary space (5 scanlines, plus X and Y filters)
-        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc((sizeof(XMVECTOR)*width * 5), 16)));
-        if (!scanline)
-            return E_OUTOFMEMORY;
-
+        // Allocate X and Y filters (scanlines are allocated per band)
         std::unique_ptr<CubicFilter[]> cf(new (std::nothrow) CubicFilter[width + height]);
         if (!cf)
             return E_OUTOFMEMORY;
@@ -963,13 +1746,6 @@ namespace
         CubicFilter* cfX = cf.get();
         CubicFilter* cfY = cf.get() + width;
 
-        XMVECTOR* target = scanline.get();
-
-        XMVECTOR* row0 = target + width;
-        XMVECTOR* row1 = target + width * 2;
-        XMVECTOR* row2 = target + width * 3;
-        XMVECTOR* row3 = target + width * 4;
-
         // Resize base image to each target mip level
         for (size_t level = 1; level < levels; ++level)
         {
@@ -980,9 +1756,6 @@ namespace
             if (!src || !dest)
                 return E_POINTER;
 
-            const uint8_t* pSrc = src->pixels;
-            uint8_t* pDest = dest->pixels;
-
             size_t rowPitch = src->rowPitch;
 
             size_t nwidth = (width > 1) ? (width >> 1) : 1;
@@ -991,127 +1764,153 @@ namespace
             size_t nheight = (height > 1) ? (height >> 1) : 1;
             _CreateCubicFilter(height, nheight, (filter & TEX_FILTER_WRAP_V) != 0, (filter & TEX_FILTER_MIRROR_V) != 0, cfY);
 
+            // Each band uses 5 scanlines
+            const size_t stride = _ScanlineStride(width);
+
+            auto cubicRows = [&](size_t y0, size_t y1, XMVECTOR* scanline) -> bool
+            {
+                XMVECTOR* target = scanline;
+
+                XMVECTOR* row0 = target + stride;
+                XMVECTOR* row1 = target + stride * 2;
+                XMVECTOR* row2 = target + stride * 3;
+                XMVECTOR* row3 = target + stride * 4;
+
 #ifdef _DEBUG
-            memset(row0, 0xCD, sizeof(XMVECTOR)*width);
-            memset(row1, 0xDD, sizeof(XMVECTOR)*width);
-            memset(row2, 0xED, sizeof(XMVECTOR)*width);
-            memset(row3, 0xFD, sizeof(XMVECTOR)*width);
+                memset(row0, 0xCD, sizeof(XMVECTOR)*width);
+                memset(row1, 0xDD, sizeof(XMVECTOR)*width);
+                memset(row2, 0xED, sizeof(XMVECTOR)*width);
+                memset(row3, 0xFD, sizeof(XMVECTOR)*width);
 #endif
 
-            size_t u0 = size_t(-1);
-            size_t u1 = size_t(-1);
-            size_t u2 = size_t(-1);
-            size_t u3 = size_t(-1);
+                const uint8_t* pSrc = src->pixels;
+                uint8_t* pDest = dest->pixels + dest->rowPitch * y0;
 
-            for (size_t y = 0; y < nheight; ++y)
-            {
-                auto& toY = cfY[y];
+                size_t u0 = size_t(-1);
+                size_t u1 = size_t(-1);
+                size_t u2 = size_t(-1);
+                size_t u3 = size_t(-1);
 
-                // Scanline 1
-                if (toY.u0 != u0)
+                for (size_t y = y0; y < y1; ++y)
                 {
-                    if (toY.u0 != u1 && toY.u0 != u2 && toY.u0 != u3)
-                    {
-                        u0 = toY.u0;
+                    auto& toY = cfY[y];
 
-                        if (!_LoadScanlineLinear(row0, width, pSrc + (rowPitch * u0), rowPitch, src->format, filter))
-                            return E_FAIL;
-                    }
-                    else if (toY.u0 == u1)
+                    // Scanline 1
+                    if (toY.u0 != u0)
                     {
-                        u0 = u1;
-                        u1 = size_t(-1);
+                        if (toY.u0 != u1 && toY.u0 != u2 && toY.u0 != u3)
+                        {
+                            u0 = toY.u0;
 
-                        std::swap(row0, row1);
-                    }
-                    else if (toY.u0 == u2)
-                    {
-                        u0 = u2;
-                        u2 = size_t(-1);
+                            if (!_LoadScanlineLinear(row0, width, pSrc + (rowPitch * u0), rowPitch, src->format, filter))
+                                return false;
+                        }
+                        else if (toY.u0 == u1)
+                        {
+                            u0 = u1;
+                            u1 = size_t(-1);
 
-                        std::swap(row0, row2);
-                    }
-                    else if (toY.u0 == u3)
-                    {
-                        u0 = u3;
-                        u3 = size_t(-1);
+                            std::swap(row0, row1);
+                        }
+                        else if (toY.u0 == u2)
+                        {
+                            u0 = u2;
+                            u2 = size_t(-1);
 
-                        std::swap(row0, row3);
+                            std::swap(row0, row2);
+                        }
+                        else if (toY.u0 == u3)
+                        {
+                            u0 = u3;
+                            u3 = size_t(-1);
+
+                            std::swap(row0, row3);
+                        }
                     }
-                }
 
-                // Scanline 2
-                if (toY.u1 != u1)
-                {
-                    if (toY.u1 != u2 && toY.u1 != u3)
+                    // Scanline 2
+                    if (toY.u1 != u1)
                     {
-                        u1 = toY.u1;
+                        if (toY.u1 != u2 && toY.u1 != u3)
+                        {
+                            u1 = toY.u1;
 
-                        if (!_LoadScanlineLinear(row1, width, pSrc + (rowPitch * u1), rowPitch, src->format, filter))
-                            return E_FAIL;
-                    }
-                    else if (toY.u1 == u2)
-                    {
-                        u1 = u2;
-                        u2 = size_t(-1);
+                            if (!_LoadScanlineLinear(row1, width, pSrc + (rowPitch * u1), rowPitch, src->format, filter))
+                                return false;
+                        }
+                        else if (toY.u1 == u2)
+                        {
+                            u1 = u2;
+                            u2 = size_t(-1);
 
-                        std::swap(row1, row2);
-                    }
-                    else if (toY.u1 == u3)
-                    {
-                        u1 = u3;
-                        u3 = size_t(-1);
+                            std::swap(row1, row2);
+                        }
+                        else if (toY.u1 == u3)
+                        {
+                            u1 = u3;
+                            u3 = size_t(-1);
 
-                        std::swap(row1, row3);
+                            std::swap(row1, row3);
+                        }
                     }
-                }
 
-                // Scanline 3
-                if (toY.u2 != u2)
-                {
-                    if (toY.u2 != u3)
+                    // Scanline 3
+                    if (toY.u2 != u2)
                     {
-                        u2 = toY.u2;
+                        if (toY.u2 != u3)
+                        {
+                            u2 = toY.u2;
 
-                        if (!_LoadScanlineLinear(row2, width, pSrc + (rowPitch * u2), rowPitch, src->format, filter))
-                            return E_FAIL;
+                            if (!_LoadScanlineLinear(row2, width, pSrc + (rowPitch * u2), rowPitch, src->format, filter))
+                                return false;
+                        }
+                        else
+                        {
+                            u2 = u3;
+                            u3 = size_t(-1);
+
+                            std::swap(row2, row3);
+                        }
                     }
-                    else
+
+                    // Scanline 4
+                    if (toY.u3 != u3)
                     {
-                        u2 = u3;
-                        u3 = size_t(-1);
+                        u3 = toY.u3;
 
-                        std::swap(row2, row3);
+                        if (!_LoadScanlineLinear(row3, width, pSrc + (rowPitch * u3), rowPitch, src->format, filter))
+                            return false;
                     }
-                }
 
-                // Scanline 4
-                if (toY.u3 != u3)
-                {
-                    u3 = toY.u3;
+                    for (size_t x = 0; x < nwidth; ++x)
+                    {
+                        auto& toX = cfX[x];
 
-                    if (!_LoadScanlineLinear(row3, width, pSrc + (rowPitch * u3), rowPitch, src->format, filter))
-                        return E_FAIL;
-                }
+                        XMVECTOR C0, C1, C2, C3;
 
-                for (size_t x = 0; x < nwidth; ++x)
-                {
-                    auto& toX = cfX[x];
+                        CUBIC_INTERPOLATE(C0, toX.x, row0[toX.u0], row0[toX.u1], row0[toX.u2], row0[toX.u3]);
+                        CUBIC_INTERPOLATE(C1, toX.x, row1[toX.u0], row1[toX.u1], row1[toX.u2], row1[toX.u3]);
+                        CUBIC_INTERPOLATE(C2, toX.x, row2[toX.u0], row2[toX.u1], row2[toX.u2], row2[toX.u3]);
+                        CUBIC_INTERPOLATE(C3, toX.x, row3[toX.u0], row3[toX.u1], row3[toX.u2], row3[toX.u3]);
 
-                    XMVECTOR C0, C1, C2, C3;
+                        CUBIC_INTERPOLATE(target[x], toY.x, C0, C1, C2, C3);
+                    }
+
+                    if (!_StoreScanlineLinear(pDest, dest->rowPitch, dest->format, target, nwidth, filter))
+                        return false;
+                    pDest += dest->rowPitch;
+                }
 
-                    CUBIC_INTERPOLATE(C0, toX.x, row0[toX.u0], row0[toX.u1], row0[toX.u2], row0[toX.u3]);
-                    CUBIC_INTERPOLATE(C1, toX.x, row1[toX.u0], row1[toX.u1], row1[toX.u2], row1[toX.u3]);
-                    CUBIC_INTERPOLATE(C2, toX.x, row2[toX.u0], row2[toX.u1], row2[toX.u2], row2[toX.u3]);
-                    CUBIC_INTERPOLATE(C3, toX.x, row3[toX.u0], row3[toX.u1], row3[toX.u2], row3[toX.u3]);
+                return true;
+            };
 
-                    CUBIC_INTERPOLATE(target[x], toY.x, C0, C1, C2, C3);
-                }
+            HRESULT hr = _ProcessRowBands(nheight, stride * 5, cubicRows);
+            if (FAILED(hr))
+                return hr;
 
-                if (!_StoreScanlineLinear(pDest, dest->rowPitch, dest->format, target, nwidth, filter))
-                    return E_FAIL;
-                pDest += dest->rowPitch;
-            }
+            hr = LevelDone(levelDone, level);
+            if (FAILED(hr))
+                return hr;
 
             if (height > 1)
                 height >>= 1;
@@ -1125,212 +1924,31 @@ namespace
 
 
     //--- 2D Triangle Filter ---
-    HRESULT Generate2DMipsTriangleFilter(size_t levels, DWORD filter, const ScratchImage& mipChain, size_t item)
+    HRESULT Generate2DMipsTriangleFilter(size_t levels, DWORD filter, const ScratchImage& mipChain, size_t item, const MipLevelCallback* levelDone = nullptr)
     {
         if (!mipChain.GetImages())
             return E_INVALIDARG;
 
-        using namespace TriangleFilter;
-
         // This assumes that the base image is already placed into the mipChain at the top level... (see _Setup2DMips)
 
         assert(levels > 1);
 
-        size_t width = mipChain.GetMetadata().width;
-        size_t height = mipChain.GetMetadata().height;
-
-        // Allocate initial temporary space (1 scanline, accumulation rows, plus X and Y filters)
-        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * width, 16)));
-        if (!scanline)
-            return E_OUTOFMEMORY;
-
-        std::unique_ptr<TriangleRow[]> rowActive(new (std::nothrow) TriangleRow[height]);
-        if (!rowActive)
-            return E_OUTOFMEMORY;
-
-        TriangleRow * rowFree = nullptr;
-
-        std::unique_ptr<Filter> tfX, tfY;
-
-        XMVECTOR* row = scanline.get();
-
-        // Resize base image to each target mip level
+        // Resize each mip level from the one above it (see _ResizeTriangleFilter for the bounded-memory banding)
         for (size_t level = 1; level < levels; ++level)
         {
-            // 2D triangle filter
             const Image* src = mipChain.GetImage(level - 1, item, 0);
             const Image* dest = mipChain.GetImage(level, item, 0);
 
             if (!src || !dest)
                 return E_POINTER;
 
-            const uint8_t* pSrc = src->pixels;
-            size_t rowPitch = src->rowPitch;
-            const uint8_t* pEndSrc = pSrc + rowPitch * height;
-
-            uint8_t* pDest = dest->pixels;
-
-            size_t nwidth = (width > 1) ? (width >> 1) : 1;
-            HRESULT hr = _Create(width, nwidth, (filter & TEX_FILTER_WRAP_U) != 0, tfX);
+            HRESULT hr = _ResizeTriangleFilter(*src, filter, *dest);
             if (FAILED(hr))
                 return hr;
 
-            size_t nheight = (height > 1) ? (height >> 1) : 1;
-            hr = _Create(height, nheight, (filter & TEX_FILTER_WRAP_V) != 0, tfY);
+            hr = LevelDone(levelDone, level);
             if (FAILED(hr))
                 return hr;
-
-#ifdef _DEBUG
-            memset(row, 0xCD, sizeof(XMVECTOR)*width);
-#endif
-
-            auto xFromEnd = reinterpret_cast<const FilterFrom*>(reinterpret_cast<const uint8_t*>(tfX.get()) + tfX->sizeInBytes);
-            auto yFromEnd = reinterpret_cast<const FilterFrom*>(reinterpret_cast<const uint8_t*>(tfY.get()) + tfY->sizeInBytes);
-
-            // Count times rows get written (and clear out any leftover accumulation rows from last miplevel)
-            for (FilterFrom* yFrom = tfY->from; yFrom < yFromEnd; )
-            {
-                for (size_t j = 0; j < yFrom->count; ++j)
-                {
-                    size_t v = yFrom->to[j].u;
-                    assert(v < nheight);
-                    TriangleRow* rowAcc = &rowActive[v];
-
-                    ++rowAcc->remaining;
-
-                    if (rowAcc->scanline)
-                    {
-                        memset(rowAcc->scanline.get(), 0, sizeof(XMVECTOR) * nwidth);
-                    }
-                }
-
-                yFrom = reinterpret_cast<FilterFrom*>(reinterpret_cast<uint8_t*>(yFrom) + yFrom->sizeInBytes);
-            }
-
-            // Filter image
-            for (FilterFrom* yFrom = tfY->from; yFrom < yFromEnd; )
-            {
-                // Create accumulation rows as needed
-                for (size_t j = 0; j < yFrom->count; ++j)
-                {
-                    size_t v = yFrom->to[j].u;
-                    assert(v < nheight);
-                    TriangleRow* rowAcc = &rowActive[v];
-
-                    if (!rowAcc->scanline)
-                    {
-                        if (rowFree)
-                        {
-                            // Steal and reuse scanline from 'free row' list
-                            // (it will always be at least as wide as nwidth due to loop decending order)
-                            assert(rowFree->scanline != nullptr);
-                            rowAcc->scanline.reset(rowFree->scanline.release());
-                            rowFree = rowFree->next;
-                        }
-                        else
-                        {
-                            rowAcc->scanline.reset(static_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * nwidth, 16)));
-                            if (!rowAcc->scanline)
-                                return E_OUTOFMEMORY;
-                        }
-
-                        memset(rowAcc->scanline.get(), 0, sizeof(XMVECTOR) * nwidth);
-                    }
-                }
-
-                // Load source scanline
-                if ((pSrc + rowPitch) > pEndSrc)
-                    return E_FAIL;
-
-                if (!_LoadScanlineLinear(row, width, pSrc, rowPitch, src->format, filter))
-                    return E_FAIL;
-
-                pSrc += rowPitch;
-
-                // Process row
-                size_t x = 0;
-                for (FilterFrom* xFrom = tfX->from; xFrom < xFromEnd; ++x)
-                {
-                    for (size_t j = 0; j < yFrom->count; ++j)
-                    {
-                        size_t v = yFrom->to[j].u;
-                        assert(v < nheight);
-                        float yweight = yFrom->to[j].weight;
-
-                        XMVECTOR* accPtr = rowActive[v].scanline.get();
-                        if (!accPtr)
-                            return E_POINTER;
-
-                        for (size_t k = 0; k < xFrom->count; ++k)
-                        {
-                            size_t u = xFrom->to[k].u;
-                            assert(u < nwidth);
-
-                            XMVECTOR weight = XMVectorReplicate(yweight * xFrom->to[k].weight);
-
-                            assert(x < width);
-                            accPtr[u] = XMVectorMultiplyAdd(row[x], weight, accPtr[u]);
-                        }
-                    }
-
-                    xFrom = reinterpret_cast<FilterFrom*>(reinterpret_cast<uint8_t*>(xFrom) + xFrom->sizeInBytes);
-                }
-
-                // Write completed accumulation rows
-                for (size_t j = 0; j < yFrom->count; ++j)
-                {
-                    size_t v = yFrom->to[j].u;
-                    assert(v < nheight);
-                    TriangleRow* rowAcc = &rowActive[v];
-
-                    assert(rowAcc->remaining > 0);
-                    --rowAcc->remaining;
-
-                    if (!rowAcc->remaining)
-                    {
-                        XMVECTOR* pAccSrc = rowAcc->scanline.get();
-                        if (!pAccSrc)
-                            return E_POINTER;
-
-                        switch (dest->format)
-                        {
-                        case DXGI_FORMAT_R10G10B10A2_UNORM:
-                        case DXGI_FORMAT_R10G10B10A2_UINT:
-                        {
-                            // Need to slightly bias results for floating-point error accumulation which can
-                            // be visible with harshly quantized values
-                            static const XMVECTORF32 Bias = { { { 0.f, 0.f, 0.f, 0.1f } } };
-
-                            XMVECTOR* ptr = pAccSrc;
-                            for (size_t i = 0; i < dest->width; ++i, ++ptr)
-                            {
-                                *ptr = XMVectorAdd(*ptr, Bias);
-                            }
-                        }
-                        break;
-
-                        default:
-                            break;
-                        }
-
-                        // This performs any required clamping
-                        if (!_StoreScanlineLinear(pDest + (dest->rowPitch * v), dest->rowPitch, dest->format, pAccSrc, dest->width, filter))
-                            return E_FAIL;
-
-                        // Put row on freelist to reuse it's allocated scanline
-                        rowAcc->next = rowFree;
-                        rowFree = rowAcc;
-                    }
-                }
-
-                yFrom = reinterpret_cast<FilterFrom*>(reinterpret_cast<uint8_t*>(yFrom) + yFrom->sizeInBytes);
-            }
-
-            if (height > 1)
-                height >>= 1;
-
-            if (width > 1)
-                width >>= 1;
         }
 
         return S_OK;
@@ -1354,7 +1972,7 @@ namespace
         size_t width = baseImages[0].width;
         size_t height = baseImages[0].height;
 
-        HRESULT hr = mipChain.Initialize3D(baseImages[0].format, width, height, depth, levels);
+        HRESULT hr = mipChain.Initialize3D(baseImages[0].format, width, height, depth, levels, _ScratchPitchFlags());
         if (FAILED(hr))
             return hr;
 
@@ -1395,7 +2013,7 @@ namespace
 
 
     //--- 3D Point Filter ---
-    HRESULT Generate3DMipsPointFilter(size_t depth, size_t levels, const ScratchImage& mipChain)
+    HRESULT Generate3DMipsPointFilter(size_t depth, size_t levels, const ScratchImage& mipChain, const MipLevelCallback* levelDone = nullptr)
     {
         if (!depth || !mipChain.GetImages())
             return E_INVALIDARG;
@@ -1526,6 +2144,10 @@ namespace
                 }
             }
 
+            HRESULT hr = LevelDone(levelDone, level);
+            if (FAILED(hr))
+                return hr;
+
             if (height > 1)
                 height >>= 1;
 
@@ -1541,7 +2163,7 @@ namespace
 
 
     //--- 3D Box Filter ---
-    HRESULT Generate3DMipsBoxFilter(size_t depth, size_t levels, DWORD filter, const ScratchImage& mipChain)
+    HRESULT Generate3DMipsBoxFilter(size_t depth, size_t levels, DWORD filter, const ScratchImage& mipChain, const MipLevelCallback* levelDone = nullptr)
     {
         if (!depth || !mipChain.GetImages())
             return E_INVALIDARG;
@@ -1556,46 +2178,24 @@ namespace
         if (!ispow2(width) || !ispow2(height) || !ispow2(depth))
             return E_FAIL;
 
-        // Allocate temporary space (5 scanlines)
-        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc((sizeof(XMVECTOR)*width * 5), 16)));
+        // Allocate temporary space (3 scanlines for the 2D levels; 3D levels use per-thread buffers)
+        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc((sizeof(XMVECTOR)*width * 3), 16)));
         if (!scanline)
             return E_OUTOFMEMORY;
 
-        XMVECTOR* target = scanline.get();
-
-        XMVECTOR* urow0 = target + width;
-        XMVECTOR* urow1 = target + width * 2;
-        XMVECTOR* vrow0 = target + width * 3;
-        XMVECTOR* vrow1 = target + width * 4;
-
-        const XMVECTOR* urow2 = urow0 + 1;
-        const XMVECTOR* urow3 = urow1 + 1;
-        const XMVECTOR* vrow2 = vrow0 + 1;
-        const XMVECTOR* vrow3 = vrow1 + 1;
-
         // Resize base image to each target mip level
         for (size_t level = 1; level < levels; ++level)
         {
-            if (height <= 1)
-            {
-                urow1 = urow0;
-                vrow1 = vrow0;
-            }
-
-            if (width <= 1)
-            {
-                urow2 = urow0;
-                urow3 = urow1;
-                vrow2 = vrow0;
-                vrow3 = vrow1;
-            }
-
             if (depth > 1)
             {
                 // 3D box filter
                 size_t ndepth = depth >> 1;
 
-                for (size_t slice = 0; slice < ndepth; ++slice)
+                size_t nwidth = (width > 1) ? (width >> 1) : 1;
+                size_t nheight = (height > 1) ? (height >> 1) : 1;
+
+                // Each slice uses 5 scanlines
+                auto boxSlice = [&](size_t slice, XMVECTOR* buffer) -> bool
                 {
                     size_t slicea = std::min<size_t>(slice * 2, depth - 1);
                     size_t sliceb = std::min<size_t>(slicea + 1, depth - 1);
@@ -1605,7 +2205,19 @@ namespace
                     const Image* dest = mipChain.GetImage(level, 0, slice);
 
                     if (!srca || !srcb || !dest)
-                        return E_POINTER;
+                        return false;
+
+                    XMVECTOR* target = buffer;
+
+                    XMVECTOR* urow0 = target + width;
+                    XMVECTOR* urow1 = (height > 1) ? (target + width * 2) : urow0;
+                    XMVECTOR* vrow0 = target + width * 3;
+                    XMVECTOR* vrow1 = (height > 1) ? (target + width * 4) : vrow0;
+
+                    const XMVECTOR* urow2 = (width > 1) ? (urow0 + 1) : urow0;
+                    const XMVECTOR* urow3 = (width > 1) ? (urow1 + 1) : urow1;
+                    const XMVECTOR* vrow2 = (width > 1) ? (vrow0 + 1) : vrow0;
+                    const XMVECTOR* vrow3 = (width > 1) ? (vrow1 + 1) : vrow1;
 
                     const uint8_t* pSrc1 = srca->pixels;
                     const uint8_t* pSrc2 = srcb->pixels;
@@ -1614,30 +2226,27 @@ namespace
                     size_t aRowPitch = srca->rowPitch;
                     size_t bRowPitch = srcb->rowPitch;
 
-                    size_t nwidth = (width > 1) ? (width >> 1) : 1;
-                    size_t nheight = (height > 1) ? (height >> 1) : 1;
-
                     for (size_t y = 0; y < nheight; ++y)
                     {
                         if (!_LoadScanlineLinear(urow0, width, pSrc1, aRowPitch, srca->format, filter))
-                            return E_FAIL;
+                            return false;
                         pSrc1 += aRowPitch;
 
                         if (urow0 != urow1)
                         {
                             if (!_LoadScanlineLinear(urow1, width, pSrc1, aRowPitch, srca->format, filter))
-                                return E_FAIL;
+                                return false;
                             pSrc1 += aRowPitch;
                         }
 
                         if (!_LoadScanlineLinear(vrow0, width, pSrc2, bRowPitch, srcb->format, filter))
-                            return E_FAIL;
+                            return false;
                         pSrc2 += bRowPitch;
 
                         if (vrow0 != vrow1)
                         {
                             if (!_LoadScanlineLinear(vrow1, width, pSrc2, bRowPitch, srcb->format, filter))
-                                return E_FAIL;
+                                return false;
                             pSrc2 += bRowPitch;
                         }
 
@@ -1650,14 +2259,28 @@ namespace
                         }
 
                         if (!_StoreScanlineLinear(pDest, dest->rowPitch, dest->format, target, nwidth, filter))
-                            return E_FAIL;
+                            return false;
                         pDest += dest->rowPitch;
                     }
-                }
+
+                    return true;
+                };
+
+                HRESULT hr = ProcessMipSlices(ndepth, width * 5, boxSlice);
+                if (FAILED(hr))
+                    return hr;
             }
             else
             {
                 // 2D box filter
+                XMVECTOR* target = scanline.get();
+
+                XMVECTOR* urow0 = target + width;
+                XMVECTOR* urow1 = (height > 1) ? (target + width * 2) : urow0;
+
+                const XMVECTOR* urow2 = (width > 1) ? (urow0 + 1) : urow0;
+                const XMVECTOR* urow3 = (width > 1) ? (urow1 + 1) : urow1;
+
                 const Image* src = mipChain.GetImage(level - 1, 0, 0);
                 const Image* dest = mipChain.GetImage(level, 0, 0);
 
@@ -1698,6 +2321,10 @@ namespace
                 }
             }
 
+            HRESULT hr = LevelDone(levelDone, level);
+            if (FAILED(hr))
+                return hr;
+
             if (height > 1)
                 height >>= 1;
 
@@ -1713,7 +2340,7 @@ namespace
 
 
     //--- 3D Linear Filter ---
-    HRESULT Generate3DMipsLinearFilter(size_t depth, size_t levels, DWORD filter, const ScratchImage& mipChain)
+    HRESULT Generate3DMipsLinearFilter(size_t depth, size_t levels, DWORD filter, const ScratchImage& mipChain, const MipLevelCallback* levelDone = nullptr)
     {
         if (!depth || !mipChain.GetImages())
             return E_INVALIDARG;
@@ -1725,8 +2352,8 @@ namespace
         size_t width = mipChain.GetMetadata().width;
         size_t height = mipChain.GetMetadata().height;
 
-        // Allocate temporary space (5 scanlines, plus X/Y/Z filters)
-        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc((sizeof(XMVECTOR)*width * 5), 16)));
+        // Allocate temporary space (3 scanlines for the 2D levels, plus X/Y/Z filters; 3D levels use per-thread buffers)
+        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc((sizeof(XMVECTOR)*width * 3), 16)));
         if (!scanline)
             return E_OUTOFMEMORY;
 
@@ -1738,13 +2365,6 @@ namespace
         LinearFilter* lfY = lf.get() + width;
         LinearFilter* lfZ = lf.get() + width + height;
 
-        XMVECTOR* target = scanline.get();
-
-        XMVECTOR* urow0 = target + width;
-        XMVECTOR* urow1 = target + width * 2;
-        XMVECTOR* vrow0 = target + width * 3;
-        XMVECTOR* vrow1 = target + width * 4;
-
         // Resize base image to each target mip level
         for (size_t level = 1; level < levels; ++level)
         {
@@ -1754,34 +2374,42 @@ namespace
             size_t nheight = (height > 1) ? (height >> 1) : 1;
             _CreateLinearFilter(height, nheight, (filter & TEX_FILTER_WRAP_V) != 0, lfY);
 
-#ifdef _DEBUG
-            memset(urow0, 0xCD, sizeof(XMVECTOR)*width);
-            memset(urow1, 0xDD, sizeof(XMVECTOR)*width);
-            memset(vrow0, 0xED, sizeof(XMVECTOR)*width);
-            memset(vrow1, 0xFD, sizeof(XMVECTOR)*width);
-#endif
-
             if (depth > 1)
             {
                 // 3D linear filter
                 size_t ndepth = depth >> 1;
                 _CreateLinearFilter(depth, ndepth, (filter & TEX_FILTER_WRAP_W) != 0, lfZ);
 
-                for (size_t slice = 0; slice < ndepth; ++slice)
+                // Each slice uses 5 scanlines
+                auto linearSlice = [&](size_t slice, XMVECTOR* buffer) -> bool
                 {
                     auto& toZ = lfZ[slice];
 
                     const Image* srca = mipChain.GetImage(level - 1, 0, toZ.u0);
                     const Image* srcb = mipChain.GetImage(level - 1, 0, toZ.u1);
                     if (!srca || !srcb)
-                        return E_POINTER;
+                        return false;
 
                     size_t u0 = size_t(-1);
                     size_t u1 = size_t(-1);
 
                     const Image* dest = mipChain.GetImage(level, 0, slice);
                     if (!dest)
-                        return E_POINTER;
+                        return false;
+
+                    XMVECTOR* target = buffer;
+
+                    XMVECTOR* urow0 = target + width;
+                    XMVECTOR* urow1 = target + width * 2;
+                    XMVECTOR* vrow0 = target + width * 3;
+                    XMVECTOR* vrow1 = target + width * 4;
+
+#ifdef _DEBUG
+                    memset(urow0, 0xCD, sizeof(XMVECTOR)*width);
+                    memset(urow1, 0xDD, sizeof(XMVECTOR)*width);
+                    memset(vrow0, 0xED, sizeof(XMVECTOR)*width);
+                    memset(vrow1, 0xFD, sizeof(XMVECTOR)*width);
+#endif
 
                     uint8_t* pDest = dest->pixels;
 
@@ -1797,7 +2425,7 @@ namespace
 
                                 if (!_LoadScanlineLinear(urow0, width, srca->pixels + (srca->rowPitch * u0), srca->rowPitch, srca->format, filter)
                                     || !_LoadScanlineLinear(vrow0, width, srcb->pixels + (srcb->rowPitch * u0), srcb->rowPitch, srcb->format, filter))
-                                    return E_FAIL;
+                                    return false;
                             }
                             else
                             {
@@ -1815,7 +2443,7 @@ namespace
 
                             if (!_LoadScanlineLinear(urow1, width, srca->pixels + (srca->rowPitch * u1), srca->rowPitch, srca->format, filter)
                                 || !_LoadScanlineLinear(vrow1, width, srcb->pixels + (srcb->rowPitch * u1), srcb->rowPitch, srcb->format, filter))
-                                return E_FAIL;
+                                return false;
                         }
 
                         for (size_t x = 0; x < nwidth; ++x)
@@ -1826,14 +2454,30 @@ namespace
                         }
 
                         if (!_StoreScanlineLinear(pDest, dest->rowPitch, dest->format, target, nwidth, filter))
-                            return E_FAIL;
+                            return false;
                         pDest += dest->rowPitch;
                     }
-                }
+
+                    return true;
+                };
+
+                HRESULT hr = ProcessMipSlices(ndepth, width * 5, linearSlice);
+                if (FAILED(hr))
+                    return hr;
             }
             else
             {
                 // 2D linear filter
+                XMVECTOR* target = scanline.get();
+
+                XMVECTOR* urow0 = target + width;
+                XMVECTOR* urow1 = target + width * 2;
+
+#ifdef _DEBUG
+                memset(urow0, 0xCD, sizeof(XMVECTOR)*width);
+                memset(urow1, 0xDD, sizeof(XMVECTOR)*width);
+#endif
+
                 const Image* src = mipChain.GetImage(level - 1, 0, 0);
                 const Image* dest = mipChain.GetImage(level, 0, 0);
 
@@ -1891,6 +2535,10 @@ namespace
                 }
             }
 
+            HRESULT hr = LevelDone(levelDone, level);
+            if (FAILED(hr))
+                return hr;
+
             if (height > 1)
                 height >>= 1;
 
@@ -1906,7 +2554,7 @@ namespace
 
 
     //--- 3D Cubic Filter ---
-    HRESULT Generate3DMipsCubicFilter(size_t depth, size_t levels, DWORD filter, const ScratchImage& mipChain)
+    HRESULT Generate3DMipsCubicFilter(size_t depth, size_t levels, DWORD filter, const ScratchImage& mipChain, const MipLevelCallback* levelDone = nullptr)
     {
         if (!depth || !mipChain.GetImages())
             return E_INVALIDARG;
@@ -1918,8 +2566,8 @@ namespace
         size_t width = mipChain.GetMetadata().width;
         size_t height = mipChain.GetMetadata().height;
 
-        // Allocate temporary space (17 scanlines, plus X/Y/Z filters)
-        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc((sizeof(XMVECTOR)*width * 17), 16)));
+        // Allocate temporary space (17 scanlines for the 2D levels, plus X/Y/Z filters; 3D levels use per-thread buffers)
+        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc((sizeof(XMVECTOR)*_ScanlineStride(width) * 17), 64)));
         if (!scanline)
             return E_OUTOFMEMORY;
 
@@ -1931,22 +2579,6 @@ namespace
         CubicFilter* cfY = cf.get() + width;
         CubicFilter* cfZ = cf.get() + width + height;
 
-        XMVECTOR* target = scanline.get();
-
-        XMVECTOR* urow[4];
-        XMVECTOR* vrow[4];
-        XMVECTOR* srow[4];
-        XMVECTOR* trow[4];
-
-        XMVECTOR *ptr = scanline.get() + width;
-        for (size_t j = 0; j < 4; ++j)
-        {
-            urow[j] = ptr;  ptr += width;
-            vrow[j] = ptr;  ptr += width;
-            srow[j] = ptr;  ptr += width;
-            trow[j] = ptr;  ptr += width;
-        }
-
         // Resize base image to each target mip level
         for (size_t level = 1; level < levels; ++level)
         {
@@ -1956,15 +2588,7 @@ namespace
             size_t nheight = (height > 1) ? (height >> 1) : 1;
             _CreateCubicFilter(height, nheight, (filter & TEX_FILTER_WRAP_V) != 0, (filter & TEX_FILTER_MIRROR_V) != 0, cfY);
 
-#ifdef _DEBUG
-            for (size_t j = 0; j < 4; ++j)
-            {
-                memset(urow[j], 0xCD, sizeof(XMVECTOR)*width);
-                memset(vrow[j], 0xDD, sizeof(XMVECTOR)*width);
-                memset(srow[j], 0xED, sizeof(XMVECTOR)*width);
-                memset(trow[j], 0xFD, sizeof(XMVECTOR)*width);
-            }
-#endif
+            const size_t stride = _ScanlineStride(width);
 
             if (depth > 1)
             {
@@ -1972,7 +2596,8 @@ namespace
                 size_t ndepth = depth >> 1;
                 _CreateCubicFilter(depth, ndepth, (filter & TEX_FILTER_WRAP_W) != 0, (filter & TEX_FILTER_MIRROR_W) != 0, cfZ);
 
-                for (size_t slice = 0; slice < ndepth; ++slice)
+                // Each slice uses 17 scanlines
+                auto cubicSlice = [&](size_t slice, XMVECTOR* buffer) -> bool
                 {
                     auto& toZ = cfZ[slice];
 
@@ -1981,7 +2606,7 @@ namespace
                     const Image* srcc = mipChain.GetImage(level - 1, 0, toZ.u2);
                     const Image* srcd = mipChain.GetImage(level - 1, 0, toZ.u3);
                     if (!srca || !srcb || !srcc || !srcd)
-                        return E_POINTER;
+                        return false;
 
                     size_t u0 = size_t(-1);
                     size_t u1 = size_t(-1);
@@ -1990,7 +2615,33 @@ namespace
 
                     const Image* dest = mipChain.GetImage(level, 0, slice);
                     if (!dest)
-                        return E_POINTER;
+                        return false;
+
+                    XMVECTOR* target = buffer;
+
+                    XMVECTOR* urow[4];
+                    XMVECTOR* vrow[4];
+                    XMVECTOR* srow[4];
+                    XMVECTOR* trow[4];
+
+                    XMVECTOR *ptr = buffer + stride;
+                    for (size_t j = 0; j < 4; ++j)
+                    {
+                        urow[j] = ptr;  ptr += stride;
+                        vrow[j] = ptr;  ptr += stride;
+                        srow[j] = ptr;  ptr += stride;
+                        trow[j] = ptr;  ptr += stride;
+                    }
+
+#ifdef _DEBUG
+                    for (size_t j = 0; j < 4; ++j)
+                    {
+                        memset(urow[j], 0xCD, sizeof(XMVECTOR)*width);
+                        memset(vrow[j], 0xDD, sizeof(XMVECTOR)*width);
+                        memset(srow[j], 0xED, sizeof(XMVECTOR)*width);
+                        memset(trow[j], 0xFD, sizeof(XMVECTOR)*width);
+                    }
+#endif
 
                     uint8_t* pDest = dest->pixels;
 
@@ -2009,7 +2660,7 @@ namespace
                                     || !_LoadScanlineLinear(urow[1], width, srcb->pixels + (srcb->rowPitch * u0), srcb->rowPitch, srcb->format, filter)
                                     || !_LoadScanlineLinear(urow[2], width, srcc->pixels + (srcc->rowPitch * u0), srcc->rowPitch, srcc->format, filter)
                                     || !_LoadScanlineLinear(urow[3], width, srcd->pixels + (srcd->rowPitch * u0), srcd->rowPitch, srcd->format, filter))
-                                    return E_FAIL;
+                                    return false;
                             }
                             else if (toY.u0 == u1)
                             {
@@ -2054,7 +2705,7 @@ namespace
                                     || !_LoadScanlineLinear(vrow[1], width, srcb->pixels + (srcb->rowPitch * u1), srcb->rowPitch, srcb->format, filter)
                                     || !_LoadScanlineLinear(vrow[2], width, srcc->pixels + (srcc->rowPitch * u1), srcc->rowPitch, srcc->format, filter)
                                     || !_LoadScanlineLinear(vrow[3], width, srcd->pixels + (srcd->rowPitch * u1), srcd->rowPitch, srcd->format, filter))
-                                    return E_FAIL;
+                                    return false;
                             }
                             else if (toY.u1 == u2)
                             {
@@ -2089,7 +2740,7 @@ namespace
                                     || !_LoadScanlineLinear(srow[1], width, srcb->pixels + (srcb->rowPitch * u2), srcb->rowPitch, srcb->format, filter)
                                     || !_LoadScanlineLinear(srow[2], width, srcc->pixels + (srcc->rowPitch * u2), srcc->rowPitch, srcc->format, filter)
                                     || !_LoadScanlineLinear(srow[3], width, srcd->pixels + (srcd->rowPitch * u2), srcd->rowPitch, srcd->format, filter))
-                                    return E_FAIL;
+                                    return false;
                             }
                             else
                             {
@@ -2112,7 +2763,7 @@ namespace
                                 || !_LoadScanlineLinear(trow[1], width, srcb->pixels + (srcb->rowPitch * u3), srcb->rowPitch, srcb->format, filter)
                                 || !_LoadScanlineLinear(trow[2], width, srcc->pixels + (srcc->rowPitch * u3), srcc->rowPitch, srcc->format, filter)
                                 || !_LoadScanlineLinear(trow[3], width, srcd->pixels + (srcd->rowPitch * u3), srcd->rowPitch, srcd->format, filter))
-                                return E_FAIL;
+                                return false;
                         }
 
                         for (size_t x = 0; x < nwidth; ++x)
@@ -2136,14 +2787,46 @@ namespace
                         }
 
                         if (!_StoreScanlineLinear(pDest, dest->rowPitch, dest->format, target, nwidth, filter))
-                            return E_FAIL;
+                            return false;
                         pDest += dest->rowPitch;
                     }
-                }
+
+                    return true;
+                };
+
+                HRESULT hr = ProcessMipSlices(ndepth, stride * 17, cubicSlice);
+                if (FAILED(hr))
+                    return hr;
             }
             else
             {
                 // 2D cubic filter
+                XMVECTOR* target = scanline.get();
+
+                XMVECTOR* urow[4];
+                XMVECTOR* vrow[4];
+                XMVECTOR* srow[4];
+                XMVECTOR* trow[4];
+
+                XMVECTOR *ptr = scanline.get() + stride;
+                for (size_t j = 0; j < 4; ++j)
+                {
+                    urow[j] = ptr;  ptr += stride;
+                    vrow[j] = ptr;  ptr += stride;
+                    srow[j] = ptr;  ptr += stride;
+                    trow[j] = ptr;  ptr += stride;
+                }
+
+#ifdef _DEBUG
+                for (size_t j = 0; j < 4; ++j)
+                {
+                    memset(urow[j], 0xCD, sizeof(XMVECTOR)*width);
+                    memset(vrow[j], 0xDD, sizeof(XMVECTOR)*width);
+                    memset(srow[j], 0xED, sizeof(XMVECTOR)*width);
+                    memset(trow[j], 0xFD, sizeof(XMVECTOR)*width);
+                }
+#endif
+
                 const Image* src = mipChain.GetImage(level - 1, 0, 0);
                 const Image* dest = mipChain.GetImage(level, 0, 0);
 
@@ -2270,6 +2953,10 @@ namespace
                 }
             }
 
+            HRESULT hr = LevelDone(levelDone, level);
+            if (FAILED(hr))
+                return hr;
+
             if (height > 1)
                 height >>= 1;
 
@@ -2285,7 +2972,7 @@ namespace
 
 
     //--- 3D Triangle Filter ---
-    HRESULT Generate3DMipsTriangleFilter(size_t depth, size_t levels, DWORD filter, const ScratchImage& mipChain)
+    HRESULT Generate3DMipsTriangleFilter(size_t depth, size_t levels, DWORD filter, const ScratchImage& mipChain, const MipLevelCallback* levelDone = nullptr)
     {
         if (!depth || !mipChain.GetImages())
             return E_INVALIDARG;
@@ -2296,24 +2983,13 @@ namespace
 
         assert(levels > 1);
 
+        const size_t maxMemory = g_TriangleFilterMemory;
+
         size_t width = mipChain.GetMetadata().width;
         size_t height = mipChain.GetMetadata().height;
 
-        // Allocate initial temporary space (1 scanline, accumulation rows, plus X/Y/Z filters)
-        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * width, 16)));
-        if (!scanline)
-            return E_OUTOFMEMORY;
-
-        std::unique_ptr<TriangleRow[]> sliceActive(new (std::nothrow) TriangleRow[depth]);
-        if (!sliceActive)
-            return E_OUTOFMEMORY;
-
-        TriangleRow * sliceFree = nullptr;
-
         std::unique_ptr<Filter> tfX, tfY, tfZ;
 
-        XMVECTOR* row = scanline.get();
-
         // Resize base image to each target mip level
         for (size_t level = 1; level < levels; ++level)
         {
@@ -2332,187 +3008,246 @@ namespace
             if (FAILED(hr))
                 return hr;
 
-#ifdef _DEBUG
-            memset(row, 0xCD, sizeof(XMVECTOR)*width);
-#endif
-
             auto xFromEnd = reinterpret_cast<const FilterFrom*>(reinterpret_cast<const uint8_t*>(tfX.get()) + tfX->sizeInBytes);
             auto yFromEnd = reinterpret_cast<const FilterFrom*>(reinterpret_cast<const uint8_t*>(tfY.get()) + tfY->sizeInBytes);
             auto zFromEnd = reinterpret_cast<const FilterFrom*>(reinterpret_cast<const uint8_t*>(tfZ.get()) + tfZ->sizeInBytes);
 
-            // Count times slices get written (and clear out any leftover accumulation slices from last miplevel)
-            for (FilterFrom* zFrom = tfZ->from; zFrom < zFromEnd; )
+            // Work is split into bands of destination rows across a group of destination slices, sized to the
+            // memory budget (1 source scanline and the accumulation rows per thread, see _ResizeTriangleFilter).
+            // Each contributing source scanline is loaded once per band and added to every destination slice of
+            // the group it contributes to, in source order, so results do not depend on the banding.
+            const size_t srcBytes = sizeof(XMVECTOR) * width;
+            const size_t accBytes = sizeof(XMVECTOR) * nwidth;
+            if (maxMemory < srcBytes + accBytes)
+                return E_OUTOFMEMORY;
+
+            size_t threads = 1;
+#ifdef _OPENMP
+            if (_UseParallel())
             {
-                for (size_t j = 0; j < zFrom->count; ++j)
-                {
-                    size_t w = zFrom->to[j].u;
-                    assert(w < ndepth);
-                    TriangleRow* sliceAcc = &sliceActive[w];
-
-                    ++sliceAcc->remaining;
-
-                    if (sliceAcc->scanline)
-                    {
-                        memset(sliceAcc->scanline.get(), 0, sizeof(XMVECTOR) * nwidth * nheight);
-                    }
-                }
-
-                zFrom = reinterpret_cast<FilterFrom*>(reinterpret_cast<uint8_t*>(zFrom) + zFrom->sizeInBytes);
+                threads = std::min<size_t>(static_cast<size_t>(omp_get_max_threads()), maxMemory / (srcBytes + accBytes));
+                if (!threads)
+                    threads = 1;
             }
+#endif
 
-            // Filter image
-            size_t z = 0;
-            for (FilterFrom* zFrom = tfZ->from; zFrom < zFromEnd; ++z)
-            {
-                // Create accumulation slices as needed
-                for (size_t j = 0; j < zFrom->count; ++j)
-                {
-                    size_t w = zFrom->to[j].u;
-                    assert(w < ndepth);
-                    TriangleRow* sliceAcc = &sliceActive[w];
-
-                    if (!sliceAcc->scanline)
-                    {
-                        if (sliceFree)
-                        {
-                            // Steal and reuse scanline from 'free slice' list
-                            // (it will always be at least as large as nwidth*nheight due to loop decending order)
-                            assert(sliceFree->scanline != nullptr);
-                            sliceAcc->scanline.reset(sliceFree->scanline.release());
-                            sliceFree = sliceFree->next;
-                        }
-                        else
-                        {
-                            size_t bytes = sizeof(XMVECTOR) * nwidth * nheight;
-                            sliceAcc->scanline.reset(static_cast<XMVECTOR*>(_aligned_malloc(bytes, 16)));
-                            if (!sliceAcc->scanline)
-                                return E_OUTOFMEMORY;
-                        }
-
-                        memset(sliceAcc->scanline.get(), 0, sizeof(XMVECTOR) * nwidth * nheight);
-                    }
-                }
+            const size_t accRows = (maxMemory / threads - srcBytes) / accBytes;
 
-                assert(z < depth);
-                const Image* src = mipChain.GetImage(level - 1, 0, z);
-                if (!src)
-                    return E_POINTER;
+            size_t bandHeight = std::min<size_t>(std::min<size_t>(c_TriangleBandHeight, nheight), accRows);
+            if (!bandHeight)
+                bandHeight = 1;
 
-                const uint8_t* pSrc = src->pixels;
-                size_t rowPitch = src->rowPitch;
-                const uint8_t* pEndSrc = pSrc + rowPitch * height;
+            size_t bandSlices = std::min<size_t>(ndepth, accRows / bandHeight);
+            if (!bandSlices)
+                bandSlices = 1;
 
-                for (FilterFrom* yFrom = tfY->from; yFrom < yFromEnd; )
-                {
-                    // Load source scanline
-                    if ((pSrc + rowPitch) > pEndSrc)
-                        return E_FAIL;
+            const size_t rowBands = (nheight + bandHeight - 1) / bandHeight;
+            const size_t bands = rowBands * ((ndepth + bandSlices - 1) / bandSlices);
+            if (bands < threads)
+                threads = bands;
 
-                    if (!_LoadScanlineLinear(row, width, pSrc, rowPitch, src->format, filter))
-                        return E_FAIL;
+            bool fail = false;
+            bool nomem = false;
 
-                    pSrc += rowPitch;
+#ifdef _OPENMP
+#pragma omp parallel num_threads(static_cast<int>(threads)) if (threads > 1)
+#endif
+            {
+                ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc(srcBytes + accBytes * bandHeight * bandSlices, 16)));
+                if (!scanline)
+                {
+                    nomem = true;
+                }
+                else
+                {
+                    XMVECTOR* row = scanline.get();
+                    XMVECTOR* acc = row + width;
 
-                    // Process row
-                    size_t x = 0;
-                    for (FilterFrom* xFrom = tfX->from; xFrom < xFromEnd; ++x)
+#ifdef _DEBUG
+                    memset(row, 0xCD, srcBytes);
+#endif
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+                    for (int band = 0; band < static_cast<int>(bands); ++band)
                     {
-                        for (size_t j = 0; j < zFrom->count; ++j)
-                        {
-                            size_t w = zFrom->to[j].u;
-                            assert(w < ndepth);
-                            float zweight = zFrom->to[j].weight;
+                        if (fail || nomem)
+                            continue;
 
-                            XMVECTOR* accSlice = sliceActive[w].scanline.get();
-                            if (!accSlice)
-                                return E_POINTER;
+                        const size_t v0 = (size_t(band) % rowBands) * bandHeight;
+                        const size_t v1 = std::min(v0 + bandHeight, nheight);
 
-                            for (size_t k = 0; k < yFrom->count; ++k)
-                            {
-                                size_t v = yFrom->to[k].u;
-                                assert(v < nheight);
-                                float yweight = yFrom->to[k].weight;
+                        const size_t w0 = (size_t(band) / rowBands) * bandSlices;
+                        const size_t w1 = std::min(w0 + bandSlices, ndepth);
 
-                                XMVECTOR * accPtr = accSlice + v * nwidth;
+                        // Accumulation rows for slice w and row v are at ((w - w0) * bandHeight + (v - v0))
+                        memset(acc, 0, accBytes * bandHeight * (w1 - w0));
 
-                                for (size_t l = 0; l < xFrom->count; ++l)
+                        size_t z = 0;
+                        for (const FilterFrom* zFrom = tfZ->from; zFrom < zFromEnd; ++z)
+                        {
+                            // Skip source slices that do not touch this group of slices
+                            bool used = false;
+                            for (size_t j = 0; j < zFrom->count; ++j)
+                            {
+                                size_t w = zFrom->to[j].u;
+                                assert(w < ndepth);
+                                if (w >= w0 && w < w1)
                                 {
-                                    size_t u = xFrom->to[l].u;
-                                    assert(u < nwidth);
-
-                                    XMVECTOR weight = XMVectorReplicate(zweight * yweight * xFrom->to[l].weight);
-
-                                    assert(x < width);
-                                    accPtr[u] = XMVectorMultiplyAdd(row[x], weight, accPtr[u]);
+                                    used = true;
+                                    break;
                                 }
                             }
-                        }
 
-                        xFrom = reinterpret_cast<FilterFrom*>(reinterpret_cast<uint8_t*>(xFrom) + xFrom->sizeInBytes);
-                    }
+                            if (used)
+                            {
+                                assert(z < depth);
+                                const Image* src = mipChain.GetImage(level - 1, 0, z);
+                                if (!src)
+                                {
+                                    fail = true;
+                                    break;
+                                }
 
-                    yFrom = reinterpret_cast<FilterFrom*>(reinterpret_cast<uint8_t*>(yFrom) + yFrom->sizeInBytes);
-                }
+                                const uint8_t* pSrc = src->pixels;
+                                const size_t rowPitch = src->rowPitch;
+                                const uint8_t* pEndSrc = pSrc + rowPitch * height;
 
-                // Write completed accumulation slices
-                for (size_t j = 0; j < zFrom->count; ++j)
-                {
-                    size_t w = zFrom->to[j].u;
-                    assert(w < ndepth);
-                    TriangleRow* sliceAcc = &sliceActive[w];
+                                for (const FilterFrom* yFrom = tfY->from; yFrom < yFromEnd; pSrc += rowPitch)
+                                {
+                                    // Skip source scanlines that do not touch this band
+                                    used = false;
+                                    for (size_t k = 0; k < yFrom->count; ++k)
+                                    {
+                                        size_t v = yFrom->to[k].u;
+                                        assert(v < nheight);
+                                        if (v >= v0 && v < v1)
+                                        {
+                                            used = true;
+                                            break;
+                                        }
+                                    }
+
+                                    if (used)
+                                    {
+                                        // Load source scanline
+                                        if ((pSrc + rowPitch) > pEndSrc
+                                            || !_LoadScanlineLinear(row, width, pSrc, rowPitch, src->format, filter))
+                                        {
+                                            fail = true;
+                                            break;
+                                        }
+
+                                        // Process row
+                                        size_t x = 0;
+                                        for (const FilterFrom* xFrom = tfX->from; xFrom < xFromEnd; ++x)
+                                        {
+                                            for (size_t j = 0; j < zFrom->count; ++j)
+                                            {
+                                                size_t w = zFrom->to[j].u;
+                                                if (w < w0 || w >= w1)
+                                                    continue;
+
+                                                float zweight = zFrom->to[j].weight;
+
+                                                for (size_t k = 0; k < yFrom->count; ++k)
+                                                {
+                                                    size_t v = yFrom->to[k].u;
+                                                    if (v < v0 || v >= v1)
+                                                        continue;
+
+                                                    float yweight = yFrom->to[k].weight;
+
+                                                    XMVECTOR* accPtr = acc + nwidth * ((w - w0) * bandHeight + (v - v0));
+
+                                                    for (size_t l = 0; l < xFrom->count; ++l)
+                                                    {
+                                                        size_t u = xFrom->to[l].u;
+                                                        assert(u < nwidth);
+
+                                                        XMVECTOR weight = XMVectorReplicate(zweight * yweight * xFrom->to[l].weight);
+
+                                                        assert(x < width);
+                                                        accPtr[u] = XMVectorMultiplyAdd(row[x], weight, accPtr[u]);
+                                                    }
+                                                }
+                                            }
+
+                                            xFrom = reinterpret_cast<const FilterFrom*>(reinterpret_cast<const uint8_t*>(xFrom) + xFrom->sizeInBytes);
+                                        }
+                                    }
+
+                                    yFrom = reinterpret_cast<const FilterFrom*>(reinterpret_cast<const uint8_t*>(yFrom) + yFrom->sizeInBytes);
+                                }
 
-                    assert(sliceAcc->remaining > 0);
-                    --sliceAcc->remaining;
+                                if (fail)
+                                    break;
+                            }
 
-                    if (!sliceAcc->remaining)
-                    {
-                        const Image* dest = mipChain.GetImage(level, 0, w);
-                        XMVECTOR* pAccSrc = sliceAcc->scanline.get();
-                        if (!dest || !pAccSrc)
-                            return E_POINTER;
+                            zFrom = reinterpret_cast<const FilterFrom*>(reinterpret_cast<const uint8_t*>(zFrom) + zFrom->sizeInBytes);
+                        }
 
-                        uint8_t* pDest = dest->pixels;
+                        if (fail)
+                            continue;
 
-                        for (size_t h = 0; h < nheight; ++h)
+                        // Write completed accumulation rows
+                        for (size_t w = w0; w < w1 && !fail; ++w)
                         {
-                            switch (dest->format)
+                            const Image* dest = mipChain.GetImage(level, 0, w);
+                            if (!dest)
                             {
-                            case DXGI_FORMAT_R10G10B10A2_UNORM:
-                            case DXGI_FORMAT_R10G10B10A2_UINT:
+                                fail = true;
+                                break;
+                            }
+
+                            for (size_t v = v0; v < v1; ++v)
                             {
-                                // Need to slightly bias results for floating-point error accumulation which can
-                                // be visible with harshly quantized values
-                                static const XMVECTORF32 Bias = { { { 0.f, 0.f, 0.f, 0.1f } } };
+                                XMVECTOR* pAccSrc = acc + nwidth * ((w - w0) * bandHeight + (v - v0));
 
-                                XMVECTOR* ptr = pAccSrc;
-                                for (size_t i = 0; i < dest->width; ++i, ++ptr)
+                                switch (dest->format)
+                                {
+                                case DXGI_FORMAT_R10G10B10A2_UNORM:
+                                case DXGI_FORMAT_R10G10B10A2_UINT:
                                 {
-                                    *ptr = XMVectorAdd(*ptr, Bias);
+                                    // Need to slightly bias results for floating-point error accumulation which can
+                                    // be visible with harshly quantized values
+                                    static const XMVECTORF32 Bias = { { { 0.f, 0.f, 0.f, 0.1f } } };
+
+                                    XMVECTOR* ptr = pAccSrc;
+                                    for (size_t i = 0; i < dest->width; ++i, ++ptr)
+                                    {
+                                        *ptr = XMVectorAdd(*ptr, Bias);
+                                    }
                                 }
-                            }
-                            break;
-
-                            default:
                                 break;
-                            }
 
-                            // This performs any required clamping
-                            if (!_StoreScanlineLinear(pDest, dest->rowPitch, dest->format, pAccSrc, dest->width, filter))
-                                return E_FAIL;
+                                default:
+                                    break;
+                                }
 
-                            pDest += dest->rowPitch;
-                            pAccSrc += nwidth;
+                                // This performs any required clamping
+                                if (!_StoreScanlineLinear(dest->pixels + (dest->rowPitch * v), dest->rowPitch, dest->format, pAccSrc, dest->width, filter))
+                                {
+                                    fail = true;
+                                    break;
+                                }
+                            }
                         }
-
-                        // Put slice on freelist to reuse it's allocated scanline
-                        sliceAcc->next = sliceFree;
-                        sliceFree = sliceAcc;
                     }
                 }
-
-                zFrom = reinterpret_cast<FilterFrom*>(reinterpret_cast<uint8_t*>(zFrom) + zFrom->sizeInBytes);
             }
 
+            if (nomem)
+                return E_OUTOFMEMORY;
+
+            if (fail)
+                return E_FAIL;
+
+            hr = LevelDone(levelDone, level);
+            if (FAILED(hr))
+                return hr;
+
             if (height > 1)
                 height >>= 1;
 
@@ -2525,13 +3260,163 @@ namespace
 
         return S_OK;
     }
-}
 
+    //--- Block compression of each mip level, overlapped with generating the next ---
+
+    HRESULT CompressMipLevel(
+        const ScratchImage& mipChain,
+        size_t level,
+        const ScratchImage& cChain,
+        size_t item,
+        DWORD compress,
+        float threshold)
+    {
+        const TexMetadata& metadata = mipChain.GetMetadata();
+        const size_t depth = (metadata.IsVolumemap()) ? std::max<size_t>(metadata.depth >> level, 1) : 1;
+
+        for (size_t slice = 0; slice < depth; ++slice)
+        {
+            const Image* src = mipChain.GetImage(level, 0, slice);
+            const Image* dest = cChain.GetImage(level, item, slice);
+            if (!src || !dest)
+                return E_POINTER;
+
+            HRESULT hr = _CompressImage(*src, *dest, compress, threshold);
+            if (FAILED(hr))
+                return hr;
+        }
+
+        return S_OK;
+    }
+
+    // The generator releases the semaphore as each level is written, and the worker thread compresses the levels
+    // in order. Generating level n + 1 and compressing level n both only read level n, so the two can overlap.
+    struct CompressLevelsWork
+    {
+        const ScratchImage* mipChain;
+        const ScratchImage* cChain;
+        size_t item;
+        size_t levels;
+        DWORD compress;
+        float threshold;
+        HANDLE levelReady;
+        volatile LONG abort;
+        volatile LONG failed;
+        HRESULT hr;
+    };
+
+    DWORD WINAPI CompressLevelsThread(_In_ LPVOID lpParameter)
+    {
+        auto work = static_cast<CompressLevelsWork*>(lpParameter);
+
+        for (size_t level = 0; level < work->levels; ++level)
+        {
+            if (WaitForSingleObjectEx(work->levelReady, INFINITE, FALSE) != WAIT_OBJECT_0)
+            {
+                work->hr = HRESULT_FROM_WIN32(GetLastError());
+                InterlockedExchange(&work->failed, 1);
+                return 1;
+            }
+
+            if (work->abort)
+                return 0;
+
+            work->hr = CompressMipLevel(*work->mipChain, level, *work->cChain, work->item, work->compress, work->threshold);
+            if (FAILED(work->hr))
+            {
+                InterlockedExchange(&work->failed, 1);
+                return 1;
+            }
+        }
+
+        return 0;
+    }
+
+    // Runs generate(levelDone) and compresses every level of the chain it produces into cChain, on a worker thread
+    // when parallel processing is enabled and on the calling thread otherwise
+    template<typename Fn>
+    HRESULT GenerateAndCompress(
+        const ScratchImage& mipChain,
+        size_t levels,
+        const ScratchImage& cChain,
+        size_t item,
+        DWORD compress,
+        float threshold,
+        Fn& generate)
+    {
+        if (!_UseParallel())
+        {
+            MipLevelCallback compressLevel = [&](size_t level) -> HRESULT
+            {
+                return CompressMipLevel(mipChain, level, cChain, item, compress, threshold);
+            };
+
+            HRESULT hr = compressLevel(0);
+            if (FAILED(hr))
+                return hr;
+
+            return generate(&compressLevel);
+        }
+
+        ScopedHandle levelReady(CreateSemaphoreEx(nullptr, 0, static_cast<LONG>(levels + 1), nullptr, 0, SEMAPHORE_ALL_ACCESS));
+        if (!levelReady)
+            return HRESULT_FROM_WIN32(GetLastError());
+
+        CompressLevelsWork work = { &mipChain, &cChain, item, levels, compress, threshold, levelReady.get(), 0, 0, S_OK };
+
+        ScopedHandle thread(CreateThread(nullptr, 0, CompressLevelsThread, &work, 0, nullptr));
+        if (!thread)
+            return HRESULT_FROM_WIN32(GetLastError());
+
+        MipLevelCallback signalLevel = [&](size_t) -> HRESULT
+        {
+            // Stop generating once compression has failed
+            if (work.failed)
+                return E_ABORT;
+
+            if (!ReleaseSemaphore(levelReady.get(), 1, nullptr))
+                return HRESULT_FROM_WIN32(GetLastError());
+
+            return S_OK;
+        };
+
+        HRESULT hr = signalLevel(0);
+        if (SUCCEEDED(hr))
+        {
+            hr = generate(&signalLevel);
+        }
+
+        if (FAILED(hr))
+        {
+            // Wake the worker if it is waiting for a level that won't come
+            InterlockedExchange(&work.abort, 1);
+            ReleaseSemaphore(levelReady.get(), 1, nullptr);
+        }
+
+        if (WaitForSingleObjectEx(thread.get(), INFINITE, FALSE) != WAIT_OBJECT_0)
+            return HRESULT_FROM_WIN32(GetLastError());
+
+        if (FAILED(work.hr))
+            return work.hr;
+
+        return hr;
+    }
+}
 
 //=====================================================================================
 // Entry-points
 //=====================================================================================
 
+//-------------------------------------------------------------------------------------
+// Triangle filter memory budget
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+size_t DirectX::SetTriangleFilterMemory(size_t maxBytes)
+{
+    return static_cast<size_t>(InterlockedExchangeSizeT(&g_TriangleFilterMemory, (maxBytes) ? maxBytes : c_TriangleFilterMemory));
+}
+
+
 //-------------------------------------------------------------------------------------
 // Generate mipmap chain
 //-------------------------------------------------------------------------------------
@@ -2622,8 +3507,8 @@ HRESULT DirectX::GenerateMipMaps(
 
                 ScratchImage tMipChain;
                 hr = (baseImage.height > 1 || !allow1D)
-                    ? tMipChain.Initialize2D(DXGI_FORMAT_R32G32B32A32_FLOAT, baseImage.width, baseImage.height, 1, levels)
-                    : tMipChain.Initialize1D(DXGI_FORMAT_R32G32B32A32_FLOAT, baseImage.width, 1, levels);
+                    ? tMipChain.Initialize2D(DXGI_FORMAT_R32G32B32A32_FLOAT, baseImage.width, baseImage.height, 1, levels, _ScratchPitchFlags())
+                    : tMipChain.Initialize1D(DXGI_FORMAT_R32G32B32A32_FLOAT, baseImage.width, 1, levels, _ScratchPitchFlags());
                 if (FAILED(hr))
                     return hr;
 
@@ -2839,7 +3724,7 @@ HRESULT DirectX::GenerateMipMaps(
                 mdata2.mipLevels = levels;
                 mdata2.format = DXGI_FORMAT_R32G32B32A32_FLOAT;
                 ScratchImage tMipChain;
-                hr = tMipChain.Initialize(mdata2);
+                hr = tMipChain.Initialize(mdata2, _ScratchPitchFlags());
                 if (FAILED(hr))
                     return hr;
 
@@ -2954,6 +3839,225 @@ HRESULT DirectX::GenerateMipMaps(
 }
 
 
+//-------------------------------------------------------------------------------------
+// Generate mipmap chain and block compress each level as it is produced
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::GenerateMipMapsCompressed(
+    const Image& baseImage,
+    DWORD filter,
+    size_t levels,
+    DXGI_FORMAT format,
+    DWORD compress,
+    float threshold,
+    ScratchImage& cChain,
+    bool allow1D)
+{
+    TexMetadata mdata = {};
+    mdata.width = baseImage.width;
+    if (baseImage.height > 1 || !allow1D)
+    {
+        mdata.height = baseImage.height;
+        mdata.dimension = TEX_DIMENSION_TEXTURE2D;
+    }
+    else
+    {
+        mdata.height = 1;
+        mdata.dimension = TEX_DIMENSION_TEXTURE1D;
+    }
+    mdata.depth = mdata.arraySize = 1;
+    mdata.mipLevels = 1;
+    mdata.format = baseImage.format;
+
+    return GenerateMipMapsCompressed(&baseImage, 1, mdata, filter, levels, format, compress, threshold, cChain);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::GenerateMipMapsCompressed(
+    const Image* srcImages,
+    size_t nimages,
+    const TexMetadata& metadata,
+    DWORD filter,
+    size_t levels,
+    DXGI_FORMAT format,
+    DWORD compress,
+    float threshold,
+    ScratchImage& cChain)
+{
+    if (!srcImages || !nimages || !IsValid(metadata.format))
+        return E_INVALIDARG;
+
+    if (!IsCompressed(format))
+        return E_INVALIDARG;
+
+    if (IsTypeless(format)
+        || IsCompressed(metadata.format) || IsTypeless(metadata.format) || IsPlanar(metadata.format) || IsPalettized(metadata.format))
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+#ifndef _OPENMP
+    if (compress & TEX_COMPRESS_PARALLEL)
+        return E_NOTIMPL;
+#endif
+
+    const bool volume = metadata.IsVolumemap();
+    if (volume)
+    {
+        if (filter & TEX_FILTER_FORCE_WIC)
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+        if (!_CalculateMipLevels3D(metadata.width, metadata.height, metadata.depth, levels))
+            return E_INVALIDARG;
+    }
+    else if (!_CalculateMipLevels(metadata.width, metadata.height, levels))
+        return E_INVALIDARG;
+
+    if (levels <= 1)
+        return E_INVALIDARG;
+
+    const size_t nbase = (volume) ? metadata.depth : metadata.arraySize;
+    std::vector<Image> baseImages;
+    baseImages.reserve(nbase);
+    for (size_t j = 0; j < nbase; ++j)
+    {
+        size_t index = (volume) ? metadata.ComputeIndex(0, 0, j) : metadata.ComputeIndex(0, j, 0);
+        if (index >= nimages)
+            return E_FAIL;
+
+        const Image& src = srcImages[index];
+        if (!src.pixels)
+            return E_POINTER;
+
+        if (src.format != metadata.format || src.width != metadata.width || src.height != metadata.height)
+        {
+            // All base images must be the same format, width, and height
+            return E_FAIL;
+        }
+
+        baseImages.push_back(src);
+    }
+
+    static_assert(TEX_FILTER_POINT == 0x100000, "TEX_FILTER_ flag values don't match TEX_FILTER_MASK");
+
+    DWORD filter_select = (filter & TEX_FILTER_MASK);
+    if (volume)
+    {
+        if (!filter_select)
+        {
+            // Default filter choice
+            filter_select = (ispow2(metadata.width) && ispow2(metadata.height) && ispow2(metadata.depth)) ? TEX_FILTER_BOX : TEX_FILTER_TRIANGLE;
+        }
+    }
+    else
+    {
+        if (!filter_select)
+        {
+            // Default filter choice
+            filter_select = (ispow2(metadata.width) && ispow2(metadata.height)) ? TEX_FILTER_BOX : TEX_FILTER_LINEAR;
+        }
+
+        if (filter_select == TEX_FILTER_BOX && (!ispow2(metadata.width) || !ispow2(metadata.height)))
+            filter_select = TEX_FILTER_LINEAR;
+    }
+
+    TexMetadata mdata2 = metadata;
+    mdata2.mipLevels = levels;
+    mdata2.format = format;
+    HRESULT hr = cChain.Initialize(mdata2);
+    if (FAILED(hr))
+        return hr;
+
+    ScratchImage mipChain;
+
+    if (volume)
+    {
+        hr = Setup3DMips(&baseImages[0], metadata.depth, levels, mipChain);
+        if (FAILED(hr))
+        {
+            cChain.Release();
+            return hr;
+        }
+
+        auto generate = [&](const MipLevelCallback* levelDone) -> HRESULT
+        {
+            switch (filter_select)
+            {
+            case TEX_FILTER_BOX:
+                return Generate3DMipsBoxFilter(metadata.depth, levels, filter, mipChain, levelDone);
+
+            case TEX_FILTER_POINT:
+                return Generate3DMipsPointFilter(metadata.depth, levels, mipChain, levelDone);
+
+            case TEX_FILTER_LINEAR:
+                return Generate3DMipsLinearFilter(metadata.depth, levels, filter, mipChain, levelDone);
+
+            case TEX_FILTER_CUBIC:
+                return Generate3DMipsCubicFilter(metadata.depth, levels, filter, mipChain, levelDone);
+
+            case TEX_FILTER_TRIANGLE:
+                return Generate3DMipsTriangleFilter(metadata.depth, levels, filter, mipChain, levelDone);
+
+            default:
+                return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+            }
+        };
+
+        hr = GenerateAndCompress(mipChain, levels, cChain, 0, compress, threshold, generate);
+        if (FAILED(hr))
+            cChain.Release();
+        return hr;
+    }
+
+    // Only one array item's uncompressed chain is kept at a time
+    TexMetadata mdata = metadata;
+    mdata.arraySize = 1;
+    mdata.mipLevels = levels;
+    mdata.miscFlags &= ~TEX_MISC_TEXTURECUBE;
+
+    for (size_t item = 0; item < metadata.arraySize; ++item)
+    {
+        hr = Setup2DMips(&baseImages[item], 1, mdata, mipChain);
+        if (FAILED(hr))
+        {
+            cChain.Release();
+            return hr;
+        }
+
+        auto generate = [&](const MipLevelCallback* levelDone) -> HRESULT
+        {
+            switch (filter_select)
+            {
+            case TEX_FILTER_BOX:
+                return Generate2DMipsBoxFilter(levels, filter, mipChain, 0, levelDone);
+
+            case TEX_FILTER_POINT:
+                return Generate2DMipsPointFilter(levels, mipChain, 0, levelDone);
+
+            case TEX_FILTER_LINEAR:
+                return Generate2DMipsLinearFilter(levels, filter, mipChain, 0, levelDone);
+
+            case TEX_FILTER_CUBIC:
+                return Generate2DMipsCubicFilter(levels, filter, mipChain, 0, levelDone);
+
+            case TEX_FILTER_TRIANGLE:
+                return Generate2DMipsTriangleFilter(levels, filter, mipChain, 0, levelDone);
+
+            default:
+                return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+            }
+        };
+
+        hr = GenerateAndCompress(mipChain, levels, cChain, item, compress, threshold, generate);
+        if (FAILED(hr))
+        {
+            cChain.Release();
+            return hr;
+        }
+    }
+
+    return S_OK;
+}
+
+
 //-------------------------------------------------------------------------------------
 // Generate mipmap chain for volume texture
 //-------------------------------------------------------------------------------------
@@ -11,18 +11,30 @@
 
 #include "DirectXTexp.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#pragma warning(disable : 4616 6993)
+#endif
+
 using namespace DirectX;
 
 namespace
 {
     const XMVECTORF32 g_Gamma22 = { { { 2.2f, 2.2f, 2.2f, 1.f } } };
 
+    // Images with fewer bands of 4x4 blocks than this are compared on one thread
+    const size_t c_MSEParallelBands = 8;
+
+    //-------------------------------------------------------------------------------------
+    // Rows are processed as bands of 4x4 blocks in parallel, each thread with its own scanline
+    // buffers. Each band's sum is kept and the bands are added up in order, so the result
+    // doesn't depend on the number of threads
     //-------------------------------------------------------------------------------------
     HRESULT ComputeMSE_(
         const Image& image1,
         const Image& image2,
-        float& mse,
-        _Out_writes_opt_(4) float* mseV,
+        XMVECTOR& sum,
+        _Out_writes_opt_(((image1.width + 3) / 4) * ((image1.height + 3) / 4)) float* blockMSE,
         DWORD flags)
     {
         if (!image1.pixels || !image2.pixels)
@@ -32,10 +44,7 @@ namespace
         assert(!IsCompressed(image1.format) && !IsCompressed(image2.format));
 
         const size_t width = image1.width;
-
-        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc((sizeof(XMVECTOR)*width) * 2, 16)));
-        if (!scanline)
-            return E_OUTOFMEMORY;
+        const size_t height = image1.height;
 
         // Flags implied from image formats
         switch (image1.format)
@@ -84,89 +93,240 @@ namespace
             break;
         }
 
-        const uint8_t *pSrc1 = image1.pixels;
-        const size_t rowPitch1 = image1.rowPitch;
-
-        const uint8_t *pSrc2 = image2.pixels;
-        const size_t rowPitch2 = image2.rowPitch;
+        // Channels that are ignored are masked off the differences
+        const XMVECTOR mask = XMVectorSelectControl(
+            (flags & CMSE_IGNORE_RED) ? 0u : 1u,
+            (flags & CMSE_IGNORE_GREEN) ? 0u : 1u,
+            (flags & CMSE_IGNORE_BLUE) ? 0u : 1u,
+            (flags & CMSE_IGNORE_ALPHA) ? 0u : 1u);
 
-        XMVECTOR acc = g_XMZero;
         static XMVECTORF32 two = { { { 2.0f, 2.0f, 2.0f, 2.0f } } };
 
-        for (size_t h = 0; h < image1.height; ++h)
+        auto convert = [&](XMVECTOR* ptr, bool srgb, bool x2bias)
         {
-            XMVECTOR* ptr1 = scanline.get();
-            if (!_LoadScanline(ptr1, width, pSrc1, rowPitch1, image1.format))
-                return E_FAIL;
-
-            XMVECTOR* ptr2 = scanline.get() + width;
-            if (!_LoadScanline(ptr2, width, pSrc2, rowPitch2, image2.format))
-                return E_FAIL;
-
-            for (size_t i = 0; i < width; ++i)
+            if (srgb)
             {
-                XMVECTOR v1 = *(ptr1++);
-                if (flags & CMSE_IMAGE1_SRGB)
+                for (size_t i = 0; i < width; ++i)
                 {
-                    v1 = XMVectorPow(v1, g_Gamma22);
+                    ptr[i] = XMVectorPow(ptr[i], g_Gamma22);
                 }
-                if (flags & CMSE_IMAGE1_X2_BIAS)
+            }
+            if (x2bias)
+            {
+                for (size_t i = 0; i < width; ++i)
                 {
-                    v1 = XMVectorMultiplyAdd(v1, two, g_XMNegativeOne);
+                    ptr[i] = XMVectorMultiplyAdd(ptr[i], two, g_XMNegativeOne);
                 }
+            }
+        };
 
-                XMVECTOR v2 = *(ptr2++);
-                if (flags & CMSE_IMAGE2_SRGB)
-                {
-                    v2 = XMVectorPow(v2, g_Gamma22);
-                }
-                if (flags & CMSE_IMAGE2_X2_BIAS)
-                {
-                    v2 = XMVectorMultiplyAdd(v2, two, g_XMNegativeOne);
-                }
+        const size_t blocksWide = (width + 3) / 4;
+        const size_t nbands = (height + 3) / 4;
 
-                // sum[ (I1 - I2)^2 ]
-                XMVECTOR v = XMVectorSubtract(v1, v2);
-                if (flags & CMSE_IGNORE_RED)
-                {
-                    v = XMVectorSelect(v, g_XMZero, g_XMMaskX);
-                }
-                if (flags & CMSE_IGNORE_GREEN)
+        ScopedAlignedArrayXMVECTOR bandSums(static_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * nbands, 16)));
+        if (!bandSums)
+            return E_OUTOFMEMORY;
+
+        bool fail = false;
+        bool outOfMemory = false;
+
+#ifdef _OPENMP
+#pragma omp parallel if (nbands >= c_MSEParallelBands && _UseParallel())
+#endif
+        {
+            ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * (width * 2 + blocksWide), 16)));
+            if (!scanline)
+                outOfMemory = true;
+
+#ifdef _OPENMP
+#pragma omp for
+#endif
+            for (int band = 0; band < static_cast<int>(nbands); ++band)
+            {
+                if (!scanline || fail)
+                    continue;
+
+                XMVECTOR* ptr1 = scanline.get();
+                XMVECTOR* ptr2 = scanline.get() + width;
+                XMVECTOR* blockSums = scanline.get() + width * 2;
+
+                for (size_t bx = 0; bx < blocksWide; ++bx)
                 {
-                    v = XMVectorSelect(v, g_XMZero, g_XMMaskY);
+                    blockSums[bx] = g_XMZero;
                 }
-                if (flags & CMSE_IGNORE_BLUE)
+
+                const size_t y0 = size_t(band) * 4;
+                const size_t y1 = std::min(y0 + 4, height);
+
+                for (size_t y = y0; y < y1; ++y)
                 {
-                    v = XMVectorSelect(v, g_XMZero, g_XMMaskZ);
+                    if (!_LoadScanline(ptr1, width, image1.pixels + image1.rowPitch * y, image1.rowPitch, image1.format)
+                        || !_LoadScanline(ptr2, width, image2.pixels + image2.rowPitch * y, image2.rowPitch, image2.format))
+                    {
+                        fail = true;
+                        break;
+                    }
+
+                    convert(ptr1, (flags & CMSE_IMAGE1_SRGB) != 0, (flags & CMSE_IMAGE1_X2_BIAS) != 0);
+                    convert(ptr2, (flags & CMSE_IMAGE2_SRGB) != 0, (flags & CMSE_IMAGE2_X2_BIAS) != 0);
+
+                    // sum[ (I1 - I2)^2 ]
+                    for (size_t bx = 0, x = 0; bx < blocksWide; ++bx)
+                    {
+                        XMVECTOR acc = blockSums[bx];
+
+                        for (const size_t x1 = std::min(x + 4, width); x < x1; ++x)
+                        {
+                            XMVECTOR v = XMVectorAndInt(XMVectorSubtract(ptr1[x], ptr2[x]), mask);
+                            acc = XMVectorMultiplyAdd(v, v, acc);
+                        }
+
+                        blockSums[bx] = acc;
+                    }
                 }
-                if (flags & CMSE_IGNORE_ALPHA)
+
+                if (fail)
+                    continue;
+
+                XMVECTOR acc = g_XMZero;
+                for (size_t bx = 0; bx < blocksWide; ++bx)
                 {
-                    v = XMVectorSelect(v, g_XMZero, g_XMMaskW);
+                    acc = XMVectorAdd(acc, blockSums[bx]);
+
+                    if (blockMSE)
+                    {
+                        // Edge blocks are averaged over the pixels they actually cover
+                        const size_t bw = std::min<size_t>(4, width - bx * 4);
+                        XMVECTOR v = XMVectorSum(blockSums[bx]);
+                        blockMSE[size_t(band) * blocksWide + bx] = XMVectorGetX(v) / float(bw * (y1 - y0));
+                    }
                 }
 
-                acc = XMVectorMultiplyAdd(v, v, acc);
+                bandSums[size_t(band)] = acc;
             }
+        }
 
-            pSrc1 += rowPitch1;
-            pSrc2 += rowPitch2;
+        if (outOfMemory)
+            return E_OUTOFMEMORY;
+
+        if (fail)
+            return E_FAIL;
+
+        XMVECTOR acc = g_XMZero;
+        for (size_t band = 0; band < nbands; ++band)
+        {
+            acc = XMVectorAdd(acc, bandSums[band]);
         }
 
-        // MSE = sum[ (I1 - I2)^2 ] / w*h
-        XMVECTOR d = XMVectorReplicate(float(image1.width * image1.height));
-        XMVECTOR v = XMVectorDivide(acc, d);
-        if (mseV)
+        sum = acc;
+
+        return S_OK;
+    }
+
+    //-------------------------------------------------------------------------------------
+    // Sum of the squared errors, expanding compressed images first
+    //-------------------------------------------------------------------------------------
+    HRESULT ComputeSquaredErrors(
+        const Image& image1,
+        const Image& image2,
+        XMVECTOR& sum,
+        _Out_writes_opt_(((image1.width + 3) / 4) * ((image1.height + 3) / 4)) float* blockMSE,
+        DWORD flags)
+    {
+        if (!image1.pixels || !image2.pixels)
+            return E_POINTER;
+
+        if (image1.width != image2.width || image1.height != image2.height)
+            return E_INVALIDARG;
+
+        if (!IsValid(image1.format) || !IsValid(image2.format))
+            return E_INVALIDARG;
+
+        if (IsPlanar(image1.format) || IsPlanar(image2.format)
+            || IsPalettized(image1.format) || IsPalettized(image2.format)
+            || IsTypeless(image1.format) || IsTypeless(image2.format))
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+        if (IsCompressed(image1.format))
         {
-            XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(mseV), v);
-            mse = mseV[0] + mseV[1] + mseV[2] + mseV[3];
+            if (IsCompressed(image2.format))
+            {
+                // Case 1: both images are compressed, expand to RGBA32F
+                ScratchImage temp1;
+                HRESULT hr = Decompress(image1, DXGI_FORMAT_R32G32B32A32_FLOAT, temp1);
+                if (FAILED(hr))
+                    return hr;
+
+                ScratchImage temp2;
+                hr = Decompress(image2, DXGI_FORMAT_R32G32B32A32_FLOAT, temp2);
+                if (FAILED(hr))
+                    return hr;
+
+                const Image* img1 = temp1.GetImage(0, 0, 0);
+                const Image* img2 = temp2.GetImage(0, 0, 0);
+                if (!img1 || !img2)
+                    return E_POINTER;
+
+                return ComputeMSE_(*img1, *img2, sum, blockMSE, flags);
+            }
+            else
+            {
+                // Case 2: image1 is compressed, expand to RGBA32F
+                ScratchImage temp;
+                HRESULT hr = Decompress(image1, DXGI_FORMAT_R32G32B32A32_FLOAT, temp);
+                if (FAILED(hr))
+                    return hr;
+
+                const Image* img = temp.GetImage(0, 0, 0);
+                if (!img)
+                    return E_POINTER;
+
+                return ComputeMSE_(*img, image2, sum, blockMSE, flags);
+            }
         }
         else
         {
-            XMFLOAT4 _mseV;
-            XMStoreFloat4(&_mseV, v);
-            mse = _mseV.x + _mseV.y + _mseV.z + _mseV.w;
+            if (IsCompressed(image2.format))
+            {
+                // Case 3: image2 is compressed, expand to RGBA32F
+                ScratchImage temp;
+                HRESULT hr = Decompress(image2, DXGI_FORMAT_R32G32B32A32_FLOAT, temp);
+                if (FAILED(hr))
+                    return hr;
+
+                const Image* img = temp.GetImage(0, 0, 0);
+                if (!img)
+                    return E_POINTER;
+
+                return ComputeMSE_(image1, *img, sum, blockMSE, flags);
+            }
+            else
+            {
+                // Case 4: neither image is compressed
+                return ComputeMSE_(image1, image2, sum, blockMSE, flags);
+            }
         }
+    }
 
-        return S_OK;
+    //-------------------------------------------------------------------------------------
+    // MSE = sum[ (I1 - I2)^2 ] / w*h
+    //-------------------------------------------------------------------------------------
+    void StoreMSE(FXMVECTOR sum, size_t pixels, float& mse, _Out_writes_opt_(4) float* mseV)
+    {
+        XMVECTOR d = XMVectorReplicate(float(pixels));
+        XMVECTOR v = XMVectorDivide(sum, d);
+
+        XMFLOAT4 _mseV;
+        XMStoreFloat4(&_mseV, v);
+        mse = _mseV.x + _mseV.y + _mseV.z + _mseV.w;
+
+        if (mseV)
+        {
+            mseV[0] = _mseV.x;
+            mseV[1] = _mseV.y;
+            mseV[2] = _mseV.z;
+            mseV[3] = _mseV.w;
+        }
     }
 
     //-------------------------------------------------------------------------------------
@@ -386,79 +546,71 @@ HRESULT DirectX::ComputeMSE(
     float* mseV,
     DWORD flags)
 {
-    if (!image1.pixels || !image2.pixels)
-        return E_POINTER;
+    return ComputeMSE(image1, image2, mse, mseV, nullptr, flags);
+}
 
-    if (image1.width != image2.width || image1.height != image2.height)
-        return E_INVALIDARG;
+_Use_decl_annotations_
+HRESULT DirectX::ComputeMSE(
+    const Image& image1,
+    const Image& image2,
+    float& mse,
+    float* mseV,
+    float* blockMSE,
+    DWORD flags)
+{
+    XMVECTOR sum;
+    HRESULT hr = ComputeSquaredErrors(image1, image2, sum, blockMSE, flags);
+    if (FAILED(hr))
+        return hr;
+
+    StoreMSE(sum, image1.width * image1.height, mse, mseV);
 
-    if (!IsValid(image1.format) || !IsValid(image2.format))
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::ComputeMSE(
+    const Image* images1,
+    const Image* images2,
+    size_t nimages,
+    float& mse,
+    float* mseV,
+    float* imageMSE,
+    DWORD flags)
+{
+    if (!images1 || !images2 || !nimages)
         return E_INVALIDARG;
 
-    if (IsPlanar(image1.format) || IsPlanar(image2.format)
-        || IsPalettized(image1.format) || IsPalettized(image2.format)
-        || IsTypeless(image1.format) || IsTypeless(image2.format))
-        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+    XMVECTOR total = g_XMZero;
+    size_t pixels = 0;
 
-    if (IsCompressed(image1.format))
+    for (size_t index = 0; index < nimages; ++index)
     {
-        if (IsCompressed(image2.format))
-        {
-            // Case 1: both images are compressed, expand to RGBA32F
-            ScratchImage temp1;
-            HRESULT hr = Decompress(image1, DXGI_FORMAT_R32G32B32A32_FLOAT, temp1);
-            if (FAILED(hr))
-                return hr;
+        const Image& image1 = images1[index];
+        const Image& image2 = images2[index];
 
-            ScratchImage temp2;
-            hr = Decompress(image2, DXGI_FORMAT_R32G32B32A32_FLOAT, temp2);
-            if (FAILED(hr))
-                return hr;
+        XMVECTOR sum;
+        HRESULT hr = ComputeSquaredErrors(image1, image2, sum, nullptr, flags);
+        if (FAILED(hr))
+            return hr;
 
-            const Image* img1 = temp1.GetImage(0, 0, 0);
-            const Image* img2 = temp2.GetImage(0, 0, 0);
-            if (!img1 || !img2)
-                return E_POINTER;
+        const size_t count = image1.width * image1.height;
 
-            return ComputeMSE_(*img1, *img2, mse, mseV, flags);
-        }
-        else
+        if (imageMSE)
         {
-            // Case 2: image1 is compressed, expand to RGBA32F
-            ScratchImage temp;
-            HRESULT hr = Decompress(image1, DXGI_FORMAT_R32G32B32A32_FLOAT, temp);
-            if (FAILED(hr))
-                return hr;
-
-            const Image* img = temp.GetImage(0, 0, 0);
-            if (!img)
-                return E_POINTER;
-
-            return ComputeMSE_(*img, image2, mse, mseV, flags);
+            float imse;
+            StoreMSE(sum, count, imse, nullptr);
+            imageMSE[index] = imse;
         }
+
+        total = XMVectorAdd(total, sum);
+        pixels += count;
     }
-    else
-    {
-        if (IsCompressed(image2.format))
-        {
-            // Case 3: image2 is compressed, expand to RGBA32F
-            ScratchImage temp;
-            HRESULT hr = Decompress(image2, DXGI_FORMAT_R32G32B32A32_FLOAT, temp);
-            if (FAILED(hr))
-                return hr;
 
-            const Image* img = temp.GetImage(0, 0, 0);
-            if (!img)
-                return E_POINTER;
+    // Every pixel of every image counts equally, so small mips weigh less than the top level
+    StoreMSE(total, pixels, mse, mseV);
 
-            return ComputeMSE_(image1, *img, mse, mseV, flags);
-        }
-        else
-        {
-            // Case 4: neither image is compressed
-            return ComputeMSE_(image1, image2, mse, mseV, flags);
-        }
-    }
+    return S_OK;
 }
 
 
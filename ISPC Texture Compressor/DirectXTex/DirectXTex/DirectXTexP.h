@@ -176,6 +176,61 @@ namespace DirectX
         }
     }
 
+    //---------------------------------------------------------------------------------
+    // Threading helper functions
+    bool __cdecl _UseParallel();
+        // SetParallelProcessing is enabled and the caller isn't already inside an OpenMP parallel region
+
+    DWORD __cdecl _ScratchPitchFlags();
+        // CP_FLAGS_PAD_CRITICAL_STRIDE unless SetPadCriticalStride(false), for internal working images
+
+    size_t __cdecl _ScanlineStride(_In_ size_t width);
+        // Spacing in XMVECTORs between scanlines packed into one buffer, padded the same way as
+        // _ScratchPitchFlags pads image rows
+
+    const size_t c_RowBandHeight = 16;
+
+    // Destination rows are split into bands of c_RowBandHeight which fn(y0, y1, scanline) processes in
+    // parallel, each thread with its own buffer of 'scanlines' vectors. Every row is computed the same way
+    // as in a single pass over the image, so the results don't depend on the thread count
+    template<typename Fn>
+    HRESULT __cdecl _ProcessRowBands(_In_ size_t height, _In_ size_t scanlines, Fn& fn)
+    {
+        const size_t nbands = (height + c_RowBandHeight - 1) / c_RowBandHeight;
+
+        bool fail = false;
+        bool outOfMemory = false;
+
+#ifdef _OPENMP
+#pragma omp parallel if (nbands > 1 && _UseParallel())
+#endif
+        {
+            ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc((sizeof(XMVECTOR)*scanlines), 64)));
+            if (!scanline)
+                outOfMemory = true;
+
+#ifdef _OPENMP
+#pragma omp for
+#endif
+            for (int band = 0; band < static_cast<int>(nbands); ++band)
+            {
+                if (!scanline || fail)
+                    continue;
+
+                size_t y0 = size_t(band) * c_RowBandHeight;
+                size_t y1 = (height - y0 > c_RowBandHeight) ? (y0 + c_RowBandHeight) : height;
+
+                if (!fn(y0, y1, scanline.get()))
+                    fail = true;
+            }
+        }
+
+        if (outOfMemory)
+            return E_OUTOFMEMORY;
+
+        return (fail) ? E_FAIL : S_OK;
+    }
+
     //---------------------------------------------------------------------------------
     // Image helper functions
     _Success_(return != false) bool __cdecl _DetermineImageArray(
@@ -243,6 +298,44 @@ namespace DirectX
         _In_reads_bytes_(inSize) const void* pSource, _In_ size_t inSize,
         _In_ DXGI_FORMAT inFormat, _In_ DWORD flags);
 
+#if defined(_XM_SSE_INTRINSICS_)
+    // Widens 8-bit or 16-bit legacy pixels to 32 bits four at a time and passes them to fn, which returns the
+    // expanded pixels; returns the number of pixels processed so a scalar loop can finish the row
+    template<typename Fn>
+    inline size_t __cdecl _ExpandPixels8To32(
+        _Out_writes_(count) uint32_t* pDestination, _In_reads_(count) const uint8_t* pSource, _In_ size_t count, Fn fn)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const size_t n = count & ~size_t(15);
+        for (size_t i = 0; i < n; i += 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource + i));
+            __m128i lo = _mm_unpacklo_epi8(v, zero);
+            __m128i hi = _mm_unpackhi_epi8(v, zero);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination + i), fn(_mm_unpacklo_epi16(lo, zero)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination + i + 4), fn(_mm_unpackhi_epi16(lo, zero)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination + i + 8), fn(_mm_unpacklo_epi16(hi, zero)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination + i + 12), fn(_mm_unpackhi_epi16(hi, zero)));
+        }
+        return n;
+    }
+
+    template<typename Fn>
+    inline size_t __cdecl _ExpandPixels16To32(
+        _Out_writes_(count) uint32_t* pDestination, _In_reads_(count) const uint16_t* pSource, _In_ size_t count, Fn fn)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const size_t n = count & ~size_t(7);
+        for (size_t i = 0; i < n; i += 8)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination + i), fn(_mm_unpacklo_epi16(v, zero)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination + i + 4), fn(_mm_unpackhi_epi16(v, zero)));
+        }
+        return n;
+    }
+#endif
+
     _Success_(return != false) bool __cdecl _LoadScanline(
         _Out_writes_(count) XMVECTOR* pDestination, _In_ size_t count,
         _In_reads_bytes_(size) const void* pSource, _In_ size_t size, _In_ DXGI_FORMAT format);
@@ -259,6 +352,9 @@ namespace DirectX
         _Out_writes_bytes_(size) void* pDestination, _In_ size_t size, _In_ DXGI_FORMAT format,
         _Inout_updates_all_(count) XMVECTOR* pSource, _In_ size_t count, _In_ DWORD flags, _In_ float threshold = 0);
 
+    DWORD __cdecl _GetScanlineLinearFlags(_In_ DXGI_FORMAT format, _In_ DWORD flags);
+        // TEX_FILTER_SRGB_* flags as _LoadScanlineLinear/_StoreScanlineLinear apply them to the format
+
     _Success_(return != false) bool __cdecl _StoreScanlineDither(
         _Out_writes_bytes_(size) void* pDestination, _In_ size_t size, _In_ DXGI_FORMAT format,
         _Inout_updates_all_(count) XMVECTOR* pSource, _In_ size_t count, _In_ float threshold, size_t y, size_t z,
@@ -0,0 +1,323 @@
+//-------------------------------------------------------------------------------------
+// DirectXTexPool.cpp
+//
+// DirectX Texture Library - Image memory allocators
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248926
+//-------------------------------------------------------------------------------------
+
+#include "DirectXTexp.h"
+
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+#define USE_LARGE_PAGES
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+    // Smaller requests aren't worth caching and go straight to the heap
+    const size_t c_PoolMinBits = 16;
+    const size_t c_PoolMinSize = size_t(1) << c_PoolMinBits;
+
+    // Four size classes per power of two, so at most a quarter of a block goes unused
+    const size_t c_ClassesPerOctave = 4;
+    const size_t c_PoolBuckets = (sizeof(size_t) * 8 - c_PoolMinBits) * c_ClassesPerOctave;
+
+    //-------------------------------------------------------------------------------------
+    // Rounds a pool-sized request up to its size class
+    //-------------------------------------------------------------------------------------
+    size_t GetBucket(size_t size, size_t& blockSize)
+    {
+        assert(size >= c_PoolMinSize);
+
+        size_t log2 = c_PoolMinBits;
+        while ((size >> log2) > 1)
+            ++log2;
+
+        const size_t shift = log2 - 2;
+        const size_t step = size_t(1) << shift;
+
+        if (size > SIZE_MAX - step)
+        {
+            blockSize = 0;
+            return c_PoolBuckets;
+        }
+
+        blockSize = (size + step - 1) & ~(step - 1);
+
+        // A request which rounds up to the next power of two lands in that octave's first class
+        return (log2 - c_PoolMinBits) * c_ClassesPerOctave + (blockSize >> shift) - c_ClassesPerOctave;
+    }
+
+    //-------------------------------------------------------------------------------------
+    // Default allocator, as used before any allocator hook existed
+    //-------------------------------------------------------------------------------------
+    class HeapAllocator : public IImageAllocator
+    {
+    public:
+        void* __cdecl Allocate(size_t size) override
+        {
+            return _aligned_malloc(size, 64);
+        }
+
+        void __cdecl Free(void* ptr, size_t) override
+        {
+            _aligned_free(ptr);
+        }
+    };
+
+    HeapAllocator g_HeapAllocator;
+
+    IImageAllocator* g_Allocator = nullptr;
+}
+
+
+//=====================================================================================
+// Allocator hook
+//=====================================================================================
+
+_Use_decl_annotations_
+IImageAllocator* DirectX::SetImageAllocator(IImageAllocator* allocator)
+{
+    auto prev = static_cast<IImageAllocator*>(InterlockedExchangePointer(reinterpret_cast<void**>(&g_Allocator), allocator));
+    return (prev) ? prev : &g_HeapAllocator;
+}
+
+IImageAllocator* DirectX::GetImageAllocator()
+{
+    auto allocator = static_cast<IImageAllocator*>(InterlockedCompareExchangePointer(reinterpret_cast<void**>(&g_Allocator), nullptr, nullptr));
+    return (allocator) ? allocator : &g_HeapAllocator;
+}
+
+
+//=====================================================================================
+// ImagePool
+//=====================================================================================
+
+_Use_decl_annotations_
+ImagePool::ImagePool(size_t maxCachedBytes, DWORD flags) :
+    m_cache(c_PoolBuckets),
+    m_stats{},
+    m_maxCached(maxCachedBytes),
+    m_largePageMinimum(0)
+{
+    InitializeSRWLock(&m_lock);
+
+#ifdef USE_LARGE_PAGES
+    if (flags & IMAGE_POOL_LARGE_PAGES)
+    {
+        m_largePageMinimum = GetLargePageMinimum();
+    }
+#else
+    UNREFERENCED_PARAMETER(flags);
+#endif
+}
+
+ImagePool::~ImagePool()
+{
+    Trim();
+
+    // Every block handed out should have come back by now
+    assert(m_stats.bytesInUse == 0);
+}
+
+
+//-------------------------------------------------------------------------------------
+// Methods
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+void* ImagePool::Allocate(size_t size)
+{
+    if (!size)
+        return nullptr;
+
+    if (size < c_PoolMinSize)
+    {
+        void* ptr = _aligned_malloc(size, 64);
+        if (ptr)
+        {
+            AcquireSRWLockExclusive(&m_lock);
+            ++m_stats.allocations;
+            m_stats.bytesInUse += size;
+            m_stats.highWaterMark = std::max(m_stats.highWaterMark, m_stats.bytesInUse + m_stats.bytesCached);
+            ReleaseSRWLockExclusive(&m_lock);
+        }
+        return ptr;
+    }
+
+    size_t blockSize;
+    size_t bucket = GetBucket(size, blockSize);
+    if (bucket >= c_PoolBuckets)
+        return nullptr;
+
+    void* ptr = nullptr;
+
+    AcquireSRWLockExclusive(&m_lock);
+
+    ++m_stats.allocations;
+
+    auto& cache = m_cache[bucket];
+    if (!cache.empty())
+    {
+        ptr = cache.back();
+        cache.pop_back();
+
+        ++m_stats.cacheHits;
+        m_stats.bytesCached -= blockSize;
+        m_stats.bytesInUse += blockSize;
+    }
+
+    ReleaseSRWLockExclusive(&m_lock);
+
+    if (ptr)
+        return ptr;
+
+    // Allocate outside the lock; committing a large block is slow
+    bool largePage = false;
+
+#ifdef USE_LARGE_PAGES
+    if (m_largePageMinimum > 0 && blockSize >= m_largePageMinimum)
+    {
+        size_t largeSize = (blockSize + m_largePageMinimum - 1) & ~(m_largePageMinimum - 1);
+        ptr = VirtualAlloc(nullptr, largeSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        largePage = (ptr != nullptr);
+    }
+#endif
+
+    if (!ptr)
+    {
+        ptr = _aligned_malloc(blockSize, 64);
+        if (!ptr)
+            return nullptr;
+    }
+
+    AcquireSRWLockExclusive(&m_lock);
+
+    if (largePage)
+    {
+        m_largePages.push_back(ptr);
+        m_stats.largePageBlocks = m_largePages.size();
+    }
+
+    m_stats.bytesInUse += blockSize;
+    m_stats.highWaterMark = std::max(m_stats.highWaterMark, m_stats.bytesInUse + m_stats.bytesCached);
+
+    ReleaseSRWLockExclusive(&m_lock);
+
+    return ptr;
+}
+
+_Use_decl_annotations_
+void ImagePool::Free(void* ptr, size_t size)
+{
+    if (!ptr)
+        return;
+
+    if (size < c_PoolMinSize)
+    {
+        AcquireSRWLockExclusive(&m_lock);
+        m_stats.bytesInUse -= size;
+        ReleaseSRWLockExclusive(&m_lock);
+
+        _aligned_free(ptr);
+        return;
+    }
+
+    size_t blockSize;
+    size_t bucket = GetBucket(size, blockSize);
+    assert(bucket < c_PoolBuckets);
+
+    bool cached = false;
+
+    AcquireSRWLockExclusive(&m_lock);
+
+    m_stats.bytesInUse -= blockSize;
+
+    if (m_stats.bytesCached + blockSize <= m_maxCached)
+    {
+        m_cache[bucket].push_back(ptr);
+        m_stats.bytesCached += blockSize;
+        cached = true;
+    }
+
+    ReleaseSRWLockExclusive(&m_lock);
+
+    if (!cached)
+    {
+        ReleaseBlock(ptr);
+    }
+}
+
+void ImagePool::Trim()
+{
+    std::vector<void*> blocks;
+
+    AcquireSRWLockExclusive(&m_lock);
+
+    for (auto& cache : m_cache)
+    {
+        blocks.insert(blocks.end(), cache.begin(), cache.end());
+        cache.clear();
+    }
+
+    m_stats.bytesCached = 0;
+
+    ReleaseSRWLockExclusive(&m_lock);
+
+    for (auto ptr : blocks)
+    {
+        ReleaseBlock(ptr);
+    }
+}
+
+ImagePool::Stats ImagePool::GetStats() const
+{
+    AcquireSRWLockShared(&m_lock);
+    Stats stats = m_stats;
+    ReleaseSRWLockShared(&m_lock);
+
+    return stats;
+}
+
+void ImagePool::ResetHighWaterMark()
+{
+    AcquireSRWLockExclusive(&m_lock);
+    m_stats.highWaterMark = m_stats.bytesInUse + m_stats.bytesCached;
+    ReleaseSRWLockExclusive(&m_lock);
+}
+
+_Use_decl_annotations_
+void ImagePool::ReleaseBlock(void* ptr)
+{
+#ifdef USE_LARGE_PAGES
+    if (m_largePageMinimum > 0)
+    {
+        bool largePage = false;
+
+        AcquireSRWLockExclusive(&m_lock);
+
+        auto it = std::find(m_largePages.begin(), m_largePages.end(), ptr);
+        if (it != m_largePages.end())
+        {
+            *it = m_largePages.back();
+            m_largePages.pop_back();
+            m_stats.largePageBlocks = m_largePages.size();
+            largePage = true;
+        }
+
+        ReleaseSRWLockExclusive(&m_lock);
+
+        if (largePage)
+        {
+            VirtualFree(ptr, 0, MEM_RELEASE);
+            return;
+        }
+    }
+#endif
+
+    _aligned_free(ptr);
+}
@@ -13,6 +13,11 @@
 
 #include "filters.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#pragma warning(disable : 4616 6993)
+#endif
+
 using namespace DirectX;
 using Microsoft::WRL::ComPtr;
 
@@ -20,6 +25,7 @@ namespace DirectX
 {
     extern HRESULT _ResizeSeparateColorAndAlpha(_In_ IWICImagingFactory* pWIC, _In_ bool iswic2, _In_ IWICBitmap* original,
         _In_ size_t newWidth, _In_ size_t newHeight, _In_ DWORD filter, _Inout_ const Image* img);
+    extern HRESULT _ResizeTriangleFilter(_In_ const Image& srcImage, _In_ DWORD filter, _In_ const Image& destImage);
 }
 
 namespace
@@ -147,7 +153,7 @@ namespace
             return E_POINTER;
 
         ScratchImage rtemp;
-        hr = rtemp.Initialize2D(DXGI_FORMAT_R32G32B32A32_FLOAT, destImage.width, destImage.height, 1, 1);
+        hr = rtemp.Initialize2D(DXGI_FORMAT_R32G32B32A32_FLOAT, destImage.width, destImage.height, 1, 1, _ScratchPitchFlags());
         if (FAILED(hr))
             return hr;
 
@@ -190,6 +196,13 @@ namespace
             return false;
         }
 
+        if (filter & TEX_FILTER_SEPARATE_ALPHA)
+        {
+            // The custom filters already treat color and alpha as independent channels, so they give this result
+            // directly (and multithreaded) instead of resizing twice with WIC and merging
+            return false;
+        }
+
 #if defined(_XBOX_ONE) && defined(_TITLE)
         if (format == DXGI_FORMAT_R16G16B16A16_FLOAT
             || format == DXGI_FORMAT_R16_FLOAT)
@@ -250,55 +263,55 @@ namespace
         assert(srcImage.pixels && destImage.pixels);
         assert(srcImage.format == destImage.format);
 
-        // Allocate temporary space (2 scanlines)
-        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc(
-            (sizeof(XMVECTOR) * (srcImage.width + destImage.width)), 16)));
-        if (!scanline)
-            return E_OUTOFMEMORY;
+        const uint8_t* pSrc = srcImage.pixels;
+        size_t rowPitch = srcImage.rowPitch;
 
-        XMVECTOR* target = scanline.get();
+        size_t xinc = (srcImage.width << 16) / destImage.width;
+        size_t yinc = (srcImage.height << 16) / destImage.height;
 
-        XMVECTOR* row = target + destImage.width;
+        // Each band uses 2 scanlines
+        auto pointRows = [&](size_t y0, size_t y1, XMVECTOR* scanline) -> bool
+        {
+            XMVECTOR* target = scanline;
+
+            XMVECTOR* row = target + destImage.width;
 
 #ifdef _DEBUG
-        memset(row, 0xCD, sizeof(XMVECTOR)*srcImage.width);
+            memset(row, 0xCD, sizeof(XMVECTOR)*srcImage.width);
 #endif
 
-        const uint8_t* pSrc = srcImage.pixels;
-        uint8_t* pDest = destImage.pixels;
+            uint8_t* pDest = destImage.pixels + destImage.rowPitch * y0;
 
-        size_t rowPitch = srcImage.rowPitch;
+            size_t lasty = size_t(-1);
 
-        size_t xinc = (srcImage.width << 16) / destImage.width;
-        size_t yinc = (srcImage.height << 16) / destImage.height;
+            size_t sy = yinc * y0;
+            for (size_t y = y0; y < y1; ++y)
+            {
+                if ((lasty ^ sy) >> 16)
+                {
+                    if (!_LoadScanline(row, srcImage.width, pSrc + (rowPitch * (sy >> 16)), rowPitch, srcImage.format))
+                        return false;
+                    lasty = sy;
+                }
 
-        size_t lasty = size_t(-1);
+                size_t sx = 0;
+                for (size_t x = 0; x < destImage.width; ++x)
+                {
+                    target[x] = row[sx >> 16];
+                    sx += xinc;
+                }
 
-        size_t sy = 0;
-        for (size_t y = 0; y < destImage.height; ++y)
-        {
-            if ((lasty ^ sy) >> 16)
-            {
-                if (!_LoadScanline(row, srcImage.width, pSrc + (rowPitch * (sy >> 16)), rowPitch, srcImage.format))
-                    return E_FAIL;
-                lasty = sy;
-            }
+                if (!_StoreScanline(pDest, destImage.rowPitch, destImage.format, target, destImage.width))
+                    return false;
+                pDest += destImage.rowPitch;
 
-            size_t sx = 0;
-            for (size_t x = 0; x < destImage.width; ++x)
-            {
-                target[x] = row[sx >> 16];
-                sx += xinc;
+                sy += yinc;
             }
 
-            if (!_StoreScanline(pDest, destImage.rowPitch, destImage.format, target, destImage.width))
-                return E_FAIL;
-            pDest += destImage.rowPitch;
-
-            sy += yinc;
-        }
+            return true;
+        };
 
-        return S_OK;
+        return _ProcessRowBands(destImage.height, srcImage.width + destImage.width, pointRows);
     }
 
 
@@ -311,71 +324,64 @@ namespace
         if (((destImage.width << 1) != srcImage.width) || ((destImage.height << 1) != srcImage.height))
             return E_FAIL;
 
-        // Allocate temporary space (3 scanlines)
-        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc(
-            (sizeof(XMVECTOR) * (srcImage.width * 2 + destImage.width)), 16)));
-        if (!scanline)
-            return E_OUTOFMEMORY;
+        size_t rowPitch = srcImage.rowPitch;
 
-        XMVECTOR* target = scanline.get();
+        // Each band uses 3 scanlines
+        auto boxRows = [&](size_t y0, size_t y1, XMVECTOR* scanline) -> bool
+        {
+            XMVECTOR* target = scanline;
 
-        XMVECTOR* urow0 = target + destImage.width;
-        XMVECTOR* urow1 = urow0 + srcImage.width;
+            XMVECTOR* urow0 = target + destImage.width;
+            XMVECTOR* urow1 = urow0 + srcImage.width;
 
 #ifdef _DEBUG
-        memset(urow0, 0xCD, sizeof(XMVECTOR)*srcImage.width);
-        memset(urow1, 0xDD, sizeof(XMVECTOR)*srcImage.width);
+            memset(urow0, 0xCD, sizeof(XMVECTOR)*srcImage.width);
+            memset(urow1, 0xDD, sizeof(XMVECTOR)*srcImage.width);
 #endif
 
-        const XMVECTOR* urow2 = urow0 + 1;
-        const XMVECTOR* urow3 = urow1 + 1;
+            const XMVECTOR* urow2 = urow0 + 1;
+            const XMVECTOR* urow3 = urow1 + 1;
 
-        const uint8_t* pSrc = srcImage.pixels;
-        uint8_t* pDest = destImage.pixels;
-
-        size_t rowPitch = srcImage.rowPitch;
-
-        for (size_t y = 0; y < destImage.height; ++y)
-        {
-            if (!_LoadScanlineLinear(urow0, srcImage.width, pSrc, rowPitch, srcImage.format, filter))
-                return E_FAIL;
-            pSrc += rowPitch;
+            const uint8_t* pSrc = srcImage.pixels + rowPitch * y0 * 2;
+            uint8_t* pDest = destImage.pixels + destImage.rowPitch * y0;
 
-            if (urow0 != urow1)
+            for (size_t y = y0; y < y1; ++y)
             {
+                if (!_LoadScanlineLinear(urow0, srcImage.width, pSrc, rowPitch, srcImage.format, filter))
+                    return false;
+                pSrc += rowPitch;
+
                 if (!_LoadScanlineLinear(urow1, srcImage.width, pSrc, rowPitch, srcImage.format, filter))
-                    return E_FAIL;
+                    return false;
                 pSrc += rowPitch;
-            }
 
-            for (size_t x = 0; x < destImage.width; ++x)
-            {
-                size_t x2 = x << 1;
+                for (size_t x = 0; x < destImage.width; ++x)
+                {
+                    size_t x2 = x << 1;
+
+                    AVERAGE4(target[x], urow0[x2], urow1[x2], urow2[x2], urow3[x2]);
+                }
 
-                AVERAGE4(target[x], urow0[x2], urow1[x2], urow2[x2], urow3[x2]);
+                if (!_StoreScanlineLinear(pDest, destImage.rowPitch, destImage.format, target, destImage.width, filter))
+                    return false;
+                pDest += destImage.rowPitch;
             }
 
-            if (!_StoreScanlineLinear(pDest, destImage.rowPitch, destImage.format, target, destImage.width, filter))
-                return E_FAIL;
-            pDest += destImage.rowPitch;
-        }
+            return true;
+        };
 
-        return S_OK;
+        return _ProcessRowBands(destImage.height, srcImage.width * 2 + destImage.width, boxRows);
     }
 
 
     //--- Linear Filter ---
+    // Separable: each source row needed by a band is filtered horizontally once into a destination-width row,
+    // and destination rows are then blended from those (the same operations as BILINEAR_INTERPOLATE).
     HRESULT ResizeLinearFilter(const Image& srcImage, DWORD filter, const Image& destImage)
     {
         assert(srcImage.pixels && destImage.pixels);
         assert(srcImage.format == destImage.format);
 
-        // Allocate temporary space (3 scanlines, plus X and Y filters)
-        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc(
-            (sizeof(XMVECTOR) * (srcImage.width * 2 + destImage.width)), 16)));
-        if (!scanline)
-            return E_OUTOFMEMORY;
-
         std::unique_ptr<LinearFilter[]> lf(new (std::nothrow) LinearFilter[destImage.width + destImage.height]);
         if (!lf)
             return E_OUTOFMEMORY;
@@ -386,82 +392,97 @@ namespace
         _CreateLinearFilter(srcImage.width, destImage.width, (filter & TEX_FILTER_WRAP_U) != 0, lfX);
         _CreateLinearFilter(srcImage.height, destImage.height, (filter & TEX_FILTER_WRAP_V) != 0, lfY);
 
-        XMVECTOR* target = scanline.get();
+        const uint8_t* pSrc = srcImage.pixels;
+        size_t rowPitch = srcImage.rowPitch;
 
-        XMVECTOR* row0 = target + destImage.width;
-        XMVECTOR* row1 = row0 + srcImage.width;
+        // Each band uses 1 source scanline, plus 3 destination-width scanlines
+        auto linearRows = [&](size_t y0, size_t y1, XMVECTOR* scanline) -> bool
+        {
+            XMVECTOR* row = scanline;
+            XMVECTOR* target = row + srcImage.width;
+            XMVECTOR* hrow0 = target + destImage.width;
+            XMVECTOR* hrow1 = hrow0 + destImage.width;
 
 #ifdef _DEBUG
-        memset(row0, 0xCD, sizeof(XMVECTOR)*srcImage.width);
-        memset(row1, 0xDD, sizeof(XMVECTOR)*srcImage.width);
+            memset(hrow0, 0xCD, sizeof(XMVECTOR)*destImage.width);
+            memset(hrow1, 0xDD, sizeof(XMVECTOR)*destImage.width);
 #endif
 
-        const uint8_t* pSrc = srcImage.pixels;
-        uint8_t* pDest = destImage.pixels;
+            auto filterRow = [&](size_t u, XMVECTOR* hrow) -> bool
+            {
+                if (!_LoadScanlineLinear(row, srcImage.width, pSrc + (rowPitch * u), rowPitch, srcImage.format, filter))
+                    return false;
 
-        size_t rowPitch = srcImage.rowPitch;
+                for (size_t x = 0; x < destImage.width; ++x)
+                {
+                    auto& toX = lfX[x];
 
-        size_t u0 = size_t(-1);
-        size_t u1 = size_t(-1);
+                    hrow[x] = XMVectorAdd(XMVectorScale(row[toX.u0], toX.weight0), XMVectorScale(row[toX.u1], toX.weight1));
+                }
 
-        for (size_t y = 0; y < destImage.height; ++y)
-        {
-            auto& toY = lfY[y];
+                return true;
+            };
+
+            uint8_t* pDest = destImage.pixels + destImage.rowPitch * y0;
+
+            size_t u0 = size_t(-1);
+            size_t u1 = size_t(-1);
 
-            if (toY.u0 != u0)
+            for (size_t y = y0; y < y1; ++y)
             {
-                if (toY.u0 != u1)
-                {
-                    u0 = toY.u0;
+                auto& toY = lfY[y];
 
-                    if (!_LoadScanlineLinear(row0, srcImage.width, pSrc + (rowPitch * u0), rowPitch, srcImage.format, filter))
-                        return E_FAIL;
-                }
-                else
+                if (toY.u0 != u0)
                 {
-                    u0 = u1;
-                    u1 = size_t(-1);
+                    if (toY.u0 != u1)
+                    {
+                        u0 = toY.u0;
 
-                    std::swap(row0, row1);
+                        if (!filterRow(u0, hrow0))
+                            return false;
+                    }
+                    else
+                    {
+                        u0 = u1;
+                        u1 = size_t(-1);
+
+                        std::swap(hrow0, hrow1);
+                    }
                 }
-            }
 
-            if (toY.u1 != u1)
-            {
-                u1 = toY.u1;
+                if (toY.u1 != u1)
+                {
+                    u1 = toY.u1;
 
-                if (!_LoadScanlineLinear(row1, srcImage.width, pSrc + (rowPitch * u1), rowPitch, srcImage.format, filter))
-                    return E_FAIL;
-            }
+                    if (!filterRow(u1, hrow1))
+                        return false;
+                }
 
-            for (size_t x = 0; x < destImage.width; ++x)
-            {
-                auto& toX = lfX[x];
+                for (size_t x = 0; x < destImage.width; ++x)
+                {
+                    target[x] = XMVectorAdd(XMVectorScale(hrow0[x], toY.weight0), XMVectorScale(hrow1[x], toY.weight1));
+                }
 
-                BILINEAR_INTERPOLATE(target[x], toX, toY, row0, row1);
+                if (!_StoreScanlineLinear(pDest, destImage.rowPitch, destImage.format, target, destImage.width, filter))
+                    return false;
+                pDest += destImage.rowPitch;
             }
 
-            if (!_StoreScanlineLinear(pDest, destImage.rowPitch, destImage.format, target, destImage.width, filter))
-                return E_FAIL;
-            pDest += destImage.rowPitch;
-        }
+            return true;
+        };
 
-        return S_OK;
+        return _ProcessRowBands(destImage.height, srcImage.width + destImage.width * 3, linearRows);
     }
 
 
     //--- Cubic Filter ---
+    // Separable: each source row needed by a band is filtered horizontally once into a destination-width row,
+    // and destination rows are then interpolated from four of those.
     HRESULT ResizeCubicFilter(const Image& srcImage, DWORD filter, const Image& destImage)
     {
         assert(srcImage.pixels && destImage.pixels);
         assert(srcImage.format == destImage.format);
 
-        // Allocate temporary space (5 scanlines, plus X and Y filters)
-        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc(
-            (sizeof(XMVECTOR) * (srcImage.width * 4 + destImage.width)), 16)));
-        if (!scanline)
-            return E_OUTOFMEMORY;
-
         std::unique_ptr<CubicFilter[]> cf(new (std::nothrow) CubicFilter[destImage.width + destImage.height]);
         if (!cf)
             return E_OUTOFMEMORY;
@@ -472,320 +493,156 @@ namespace
         _CreateCubicFilter(srcImage.width, destImage.width, (filter & TEX_FILTER_WRAP_U) != 0, (filter & TEX_FILTER_MIRROR_U) != 0, cfX);
         _CreateCubicFilter(srcImage.height, destImage.height, (filter & TEX_FILTER_WRAP_V) != 0, (filter & TEX_FILTER_MIRROR_V) != 0, cfY);
 
-        XMVECTOR* target = scanline.get();
-
-        XMVECTOR* row0 = target + destImage.width;
-        XMVECTOR* row1 = row0 + srcImage.width;
-        XMVECTOR* row2 = row0 + srcImage.width * 2;
-        XMVECTOR* row3 = row0 + srcImage.width * 3;
-
-#ifdef _DEBUG
-        memset(row0, 0xCD, sizeof(XMVECTOR)*srcImage.width);
-        memset(row1, 0xDD, sizeof(XMVECTOR)*srcImage.width);
-        memset(row2, 0xED, sizeof(XMVECTOR)*srcImage.width);
-        memset(row3, 0xFD, sizeof(XMVECTOR)*srcImage.width);
-#endif
-
         const uint8_t* pSrc = srcImage.pixels;
-        uint8_t* pDest = destImage.pixels;
-
         size_t rowPitch = srcImage.rowPitch;
 
-        size_t u0 = size_t(-1);
-        size_t u1 = size_t(-1);
-        size_t u2 = size_t(-1);
-        size_t u3 = size_t(-1);
+        // Each band uses 1 source scanline, plus 5 destination-width scanlines
+        const size_t srcStride = _ScanlineStride(srcImage.width);
+        const size_t destStride = _ScanlineStride(destImage.width);
 
-        for (size_t y = 0; y < destImage.height; ++y)
+        auto cubicRows = [&](size_t y0, size_t y1, XMVECTOR* scanline) -> bool
         {
-            auto& toY = cfY[y];
-
-            // Scanline 1
-            if (toY.u0 != u0)
-            {
-                if (toY.u0 != u1 && toY.u0 != u2 && toY.u0 != u3)
-                {
-                    u0 = toY.u0;
-
-                    if (!_LoadScanlineLinear(row0, srcImage.width, pSrc + (rowPitch * u0), rowPitch, srcImage.format, filter))
-                        return E_FAIL;
-                }
-                else if (toY.u0 == u1)
-                {
-                    u0 = u1;
-                    u1 = size_t(-1);
-
-                    std::swap(row0, row1);
-                }
-                else if (toY.u0 == u2)
-                {
-                    u0 = u2;
-                    u2 = size_t(-1);
-
-                    std::swap(row0, row2);
-                }
-                else if (toY.u0 == u3)
-                {
-                    u0 = u3;
-                    u3 = size_t(-1);
+            XMVECTOR* row = scanline;
+            XMVECTOR* target = row + srcStride;
+            XMVECTOR* hrow0 = target + destStride;
+            XMVECTOR* hrow1 = hrow0 + destStride;
+            XMVECTOR* hrow2 = hrow0 + destStride * 2;
+            XMVECTOR* hrow3 = hrow0 + destStride * 3;
 
-                    std::swap(row0, row3);
-                }
-            }
-
-            // Scanline 2
-            if (toY.u1 != u1)
-            {
-                if (toY.u1 != u2 && toY.u1 != u3)
-                {
-                    u1 = toY.u1;
-
-                    if (!_LoadScanlineLinear(row1, srcImage.width, pSrc + (rowPitch * u1), rowPitch, srcImage.format, filter))
-                        return E_FAIL;
-                }
-                else if (toY.u1 == u2)
-                {
-                    u1 = u2;
-                    u2 = size_t(-1);
-
-                    std::swap(row1, row2);
-                }
-                else if (toY.u1 == u3)
-                {
-                    u1 = u3;
-                    u3 = size_t(-1);
-
-                    std::swap(row1, row3);
-                }
-            }
+#ifdef _DEBUG
+            memset(hrow0, 0xCD, sizeof(XMVECTOR)*destImage.width);
+            memset(hrow1, 0xDD, sizeof(XMVECTOR)*destImage.width);
+            memset(hrow2, 0xED, sizeof(XMVECTOR)*destImage.width);
+            memset(hrow3, 0xFD, sizeof(XMVECTOR)*destImage.width);
+#endif
 
-            // Scanline 3
-            if (toY.u2 != u2)
+            auto filterRow = [&](size_t u, XMVECTOR* hrow) -> bool
             {
-                if (toY.u2 != u3)
-                {
-                    u2 = toY.u2;
+                if (!_LoadScanlineLinear(row, srcImage.width, pSrc + (rowPitch * u), rowPitch, srcImage.format, filter))
+                    return false;
 
-                    if (!_LoadScanlineLinear(row2, srcImage.width, pSrc + (rowPitch * u2), rowPitch, srcImage.format, filter))
-                        return E_FAIL;
-                }
-                else
+                for (size_t x = 0; x < destImage.width; ++x)
                 {
-                    u2 = u3;
-                    u3 = size_t(-1);
+                    auto& toX = cfX[x];
 
-                    std::swap(row2, row3);
+                    CUBIC_INTERPOLATE(hrow[x], toX.x, row[toX.u0], row[toX.u1], row[toX.u2], row[toX.u3]);
                 }
-            }
-
-            // Scanline 4
-            if (toY.u3 != u3)
-            {
-                u3 = toY.u3;
-
-                if (!_LoadScanlineLinear(row3, srcImage.width, pSrc + (rowPitch * u3), rowPitch, srcImage.format, filter))
-                    return E_FAIL;
-            }
-
-            for (size_t x = 0; x < destImage.width; ++x)
-            {
-                auto& toX = cfX[x];
-
-                XMVECTOR C0, C1, C2, C3;
-
-                CUBIC_INTERPOLATE(C0, toX.x, row0[toX.u0], row0[toX.u1], row0[toX.u2], row0[toX.u3]);
-                CUBIC_INTERPOLATE(C1, toX.x, row1[toX.u0], row1[toX.u1], row1[toX.u2], row1[toX.u3]);
-                CUBIC_INTERPOLATE(C2, toX.x, row2[toX.u0], row2[toX.u1], row2[toX.u2], row2[toX.u3]);
-                CUBIC_INTERPOLATE(C3, toX.x, row3[toX.u0], row3[toX.u1], row3[toX.u2], row3[toX.u3]);
-
-                CUBIC_INTERPOLATE(target[x], toY.x, C0, C1, C2, C3);
-            }
-
-            if (!_StoreScanlineLinear(pDest, destImage.rowPitch, destImage.format, target, destImage.width, filter))
-                return E_FAIL;
-            pDest += destImage.rowPitch;
-        }
-
-        return S_OK;
-    }
-
-
-    //--- Triangle Filter ---
-    HRESULT ResizeTriangleFilter(const Image& srcImage, DWORD filter, const Image& destImage)
-    {
-        assert(srcImage.pixels && destImage.pixels);
-        assert(srcImage.format == destImage.format);
-
-        using namespace TriangleFilter;
-
-        // Allocate initial temporary space (1 scanline, accumulation rows, plus X and Y filters)
-        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * srcImage.width, 16)));
-        if (!scanline)
-            return E_OUTOFMEMORY;
-
-        std::unique_ptr<TriangleRow[]> rowActive(new (std::nothrow) TriangleRow[destImage.height]);
-        if (!rowActive)
-            return E_OUTOFMEMORY;
-
-        TriangleRow * rowFree = nullptr;
-
-        std::unique_ptr<Filter> tfX;
-        HRESULT hr = _Create(srcImage.width, destImage.width, (filter & TEX_FILTER_WRAP_U) != 0, tfX);
-        if (FAILED(hr))
-            return hr;
-
-        std::unique_ptr<Filter> tfY;
-        hr = _Create(srcImage.height, destImage.height, (filter & TEX_FILTER_WRAP_V) != 0, tfY);
-        if (FAILED(hr))
-            return hr;
-
-        XMVECTOR* row = scanline.get();
-
-#ifdef _DEBUG
-        memset(row, 0xCD, sizeof(XMVECTOR)*srcImage.width);
-#endif
-
-        auto xFromEnd = reinterpret_cast<const FilterFrom*>(reinterpret_cast<const uint8_t*>(tfX.get()) + tfX->sizeInBytes);
-        auto yFromEnd = reinterpret_cast<const FilterFrom*>(reinterpret_cast<const uint8_t*>(tfY.get()) + tfY->sizeInBytes);
-
-        // Count times rows get written
-        for (FilterFrom* yFrom = tfY->from; yFrom < yFromEnd; )
-        {
-            for (size_t j = 0; j < yFrom->count; ++j)
-            {
-                size_t v = yFrom->to[j].u;
-                assert(v < destImage.height);
-                ++rowActive[v].remaining;
-            }
 
-            yFrom = reinterpret_cast<FilterFrom*>(reinterpret_cast<uint8_t*>(yFrom) + yFrom->sizeInBytes);
-        }
+                return true;
+            };
 
-        // Filter image
-        const uint8_t* pSrc = srcImage.pixels;
-        size_t rowPitch = srcImage.rowPitch;
-        const uint8_t* pEndSrc = pSrc + rowPitch * srcImage.height;
+            uint8_t* pDest = destImage.pixels + destImage.rowPitch * y0;
 
-        uint8_t* pDest = destImage.pixels;
+            size_t u0 = size_t(-1);
+            size_t u1 = size_t(-1);
+            size_t u2 = size_t(-1);
+            size_t u3 = size_t(-1);
 
-        for (FilterFrom* yFrom = tfY->from; yFrom < yFromEnd; )
-        {
-            // Create accumulation rows as needed
-            for (size_t j = 0; j < yFrom->count; ++j)
+            for (size_t y = y0; y < y1; ++y)
             {
-                size_t v = yFrom->to[j].u;
-                assert(v < destImage.height);
-                TriangleRow* rowAcc = &rowActive[v];
+                auto& toY = cfY[y];
 
-                if (!rowAcc->scanline)
+                // Scanline 1
+                if (toY.u0 != u0)
                 {
-                    if (rowFree)
+                    if (toY.u0 != u1 && toY.u0 != u2 && toY.u0 != u3)
                     {
-                        // Steal and reuse scanline from 'free row' list
-                        assert(rowFree->scanline != nullptr);
-                        rowAcc->scanline.reset(rowFree->scanline.release());
-                        rowFree = rowFree->next;
+                        u0 = toY.u0;
+
+                        if (!filterRow(u0, hrow0))
+                            return false;
                     }
-                    else
+                    else if (toY.u0 == u1)
                     {
-                        rowAcc->scanline.reset(static_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * destImage.width, 16)));
-                        if (!rowAcc->scanline)
-                            return E_OUTOFMEMORY;
-                    }
+                        u0 = u1;
+                        u1 = size_t(-1);
 
-                    memset(rowAcc->scanline.get(), 0, sizeof(XMVECTOR) * destImage.width);
-                }
-            }
-
-            // Load source scanline
-            if ((pSrc + rowPitch) > pEndSrc)
-                return E_FAIL;
+                        std::swap(hrow0, hrow1);
+                    }
+                    else if (toY.u0 == u2)
+                    {
+                        u0 = u2;
+                        u2 = size_t(-1);
 
-            if (!_LoadScanlineLinear(row, srcImage.width, pSrc, rowPitch, srcImage.format, filter))
-                return E_FAIL;
+                        std::swap(hrow0, hrow2);
+                    }
+                    else if (toY.u0 == u3)
+                    {
+                        u0 = u3;
+                        u3 = size_t(-1);
 
-            pSrc += rowPitch;
+                        std::swap(hrow0, hrow3);
+                    }
+                }
 
-            // Process row
-            size_t x = 0;
-            for (FilterFrom* xFrom = tfX->from; xFrom < xFromEnd; ++x)
-            {
-                for (size_t j = 0; j < yFrom->count; ++j)
+                // Scanline 2
+                if (toY.u1 != u1)
                 {
-                    size_t v = yFrom->to[j].u;
-                    assert(v < destImage.height);
-                    float yweight = yFrom->to[j].weight;
-
-                    XMVECTOR* accPtr = rowActive[v].scanline.get();
-                    if (!accPtr)
-                        return E_POINTER;
+                    if (toY.u1 != u2 && toY.u1 != u3)
+                    {
+                        u1 = toY.u1;
 
-                    for (size_t k = 0; k < xFrom->count; ++k)
+                        if (!filterRow(u1, hrow1))
+                            return false;
+                    }
+                    else if (toY.u1 == u2)
                     {
-                        size_t u = xFrom->to[k].u;
-                        assert(u < destImage.width);
+                        u1 = u2;
+                        u2 = size_t(-1);
 
-                        XMVECTOR weight = XMVectorReplicate(yweight * xFrom->to[k].weight);
+                        std::swap(hrow1, hrow2);
+                    }
+                    else if (toY.u1 == u3)
+                    {
+                        u1 = u3;
+                        u3 = size_t(-1);
 
-                        assert(x < srcImage.width);
-                        accPtr[u] = XMVectorMultiplyAdd(row[x], weight, accPtr[u]);
+                        std::swap(hrow1, hrow3);
                     }
                 }
 
-                xFrom = reinterpret_cast<FilterFrom*>(reinterpret_cast<uint8_t*>(xFrom) + xFrom->sizeInBytes);
-            }
-
-            // Write completed accumulation rows
-            for (size_t j = 0; j < yFrom->count; ++j)
-            {
-                size_t v = yFrom->to[j].u;
-                assert(v < destImage.height);
-                TriangleRow* rowAcc = &rowActive[v];
-
-                assert(rowAcc->remaining > 0);
-                --rowAcc->remaining;
-
-                if (!rowAcc->remaining)
+                // Scanline 3
+                if (toY.u2 != u2)
                 {
-                    XMVECTOR* pAccSrc = rowAcc->scanline.get();
-                    if (!pAccSrc)
-                        return E_POINTER;
-
-                    switch (destImage.format)
+                    if (toY.u2 != u3)
                     {
-                    case DXGI_FORMAT_R10G10B10A2_UNORM:
-                    case DXGI_FORMAT_R10G10B10A2_UINT:
-                    {
-                        // Need to slightly bias results for floating-point error accumulation which can
-                        // be visible with harshly quantized values
-                        static const XMVECTORF32 Bias = { { { 0.f, 0.f, 0.f, 0.1f } } };
-
-                        XMVECTOR* ptr = pAccSrc;
-                        for (size_t i = 0; i < destImage.width; ++i, ++ptr)
-                        {
-                            *ptr = XMVectorAdd(*ptr, Bias);
-                        }
+                        u2 = toY.u2;
+
+                        if (!filterRow(u2, hrow2))
+                            return false;
                     }
-                    break;
+                    else
+                    {
+                        u2 = u3;
+                        u3 = size_t(-1);
 
-                    default:
-                        break;
+                        std::swap(hrow2, hrow3);
                     }
+                }
 
-                    // This performs any required clamping
-                    if (!_StoreScanlineLinear(pDest + (destImage.rowPitch * v), destImage.rowPitch, destImage.format, pAccSrc, destImage.width, filter))
-                        return E_FAIL;
+                // Scanline 4
+                if (toY.u3 != u3)
+                {
+                    u3 = toY.u3;
 
-                    // Put row on freelist to reuse it's allocated scanline
-                    rowAcc->next = rowFree;
-                    rowFree = rowAcc;
+                    if (!filterRow(u3, hrow3))
+                        return false;
                 }
+
+                for (size_t x = 0; x < destImage.width; ++x)
+                {
+                    CUBIC_INTERPOLATE(target[x], toY.x, hrow0[x], hrow1[x], hrow2[x], hrow3[x]);
+                }
+
+                if (!_StoreScanlineLinear(pDest, destImage.rowPitch, destImage.format, target, destImage.width, filter))
+                    return false;
+                pDest += destImage.rowPitch;
             }
 
-            yFrom = reinterpret_cast<FilterFrom*>(reinterpret_cast<uint8_t*>(yFrom) + yFrom->sizeInBytes);
-        }
+            return true;
+        };
 
-        return S_OK;
+        return _ProcessRowBands(destImage.height, srcStride + destStride * 5, cubicRows);
     }
 
 
@@ -820,7 +677,7 @@ namespace
             return ResizeCubicFilter(srcImage, filter, destImage);
 
         case TEX_FILTER_TRIANGLE:
-            return ResizeTriangleFilter(srcImage, filter, destImage);
+            return _ResizeTriangleFilter(srcImage, filter, destImage);
 
         default:
             return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
@@ -11,12 +11,17 @@
 
 #include "DirectXTexp.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#pragma warning(disable : 4616 6993)
+#endif
+
 //
 // The implementation here has the following limitations:
 //      * Does not support files that contain color maps (these are rare in practice)
 //      * Interleaved files are not supported (deprecated aspect of TGA format)
 //      * Only supports 8-bit grayscale; 16-, 24-, and 32-bit truecolor images
-//      * Always writes uncompressed files (i.e. can read RLE compression, but does not write it)
+//      * Writes uncompressed files unless TGA_FLAGS_RLE is given
 //
 
 using namespace DirectX;
@@ -250,325 +255,260 @@ namespace
 
 
     //-------------------------------------------------------------------------------------
-    // Uncompress pixel data from a TGA into the target image
+    // Records where each scanline starts in the RLE stream, validating every packet so
+    // the rows can then be decoded independently
     //-------------------------------------------------------------------------------------
-    HRESULT UncompressPixels(
-        _In_reads_bytes_(size) const void* pSource,
+    const size_t c_TGAParallelRows = 64;
+
+    HRESULT ScanRLEPackets(
+        _In_reads_bytes_(size) const uint8_t* pSource,
         size_t size,
-        _In_ const Image* image,
-        _In_ DWORD convFlags)
+        size_t width,
+        size_t height,
+        size_t bpp,
+        _Out_writes_(height) size_t* rowOffsets)
     {
-        assert(pSource && size > 0);
+        const uint8_t* sPtr = pSource;
+        const uint8_t* endPtr = pSource + size;
 
-        if (!image || !image->pixels)
-            return E_POINTER;
-
-        // Compute TGA image data pitch
-        size_t rowPitch;
-        if (convFlags & CONV_FLAGS_EXPAND)
+        for (size_t y = 0; y < height; ++y)
         {
-            rowPitch = image->width * 3;
-        }
-        else
-        {
-            size_t slicePitch;
-            HRESULT hr = ComputePitch(image->format, image->width, image->height, rowPitch, slicePitch, CP_FLAGS_NONE);
-            if (FAILED(hr))
-                return hr;
-        }
-
-        auto sPtr = static_cast<const uint8_t*>(pSource);
-        const uint8_t* endPtr = sPtr + size;
+            rowOffsets[y] = size_t(sPtr - pSource);
 
-        switch (image->format)
-        {
-        //--------------------------------------------------------------------------- 8-bit
-        case DXGI_FORMAT_R8_UNORM:
-            for (size_t y = 0; y < image->height; ++y)
+            for (size_t x = 0; x < width; )
             {
-                size_t offset = ((convFlags & CONV_FLAGS_INVERTX) ? (image->width - 1) : 0);
-                assert(offset < rowPitch);
-
-                uint8_t* dPtr = image->pixels
-                    + (image->rowPitch * ((convFlags & CONV_FLAGS_INVERTY) ? y : (image->height - y - 1)))
-                    + offset;
-
-                for (size_t x = 0; x < image->width; )
-                {
-                    if (sPtr >= endPtr)
-                        return E_FAIL;
-
-                    if (*sPtr & 0x80)
-                    {
-                        // Repeat
-                        size_t j = size_t(*sPtr & 0x7F) + 1;
-                        if (++sPtr >= endPtr)
-                            return E_FAIL;
+                if (sPtr >= endPtr)
+                    return E_FAIL;
 
-                        for (; j > 0; --j, ++x)
-                        {
-                            if (x >= image->width)
-                                return E_FAIL;
+                // Packets may not cross scanlines
+                size_t j = size_t(*sPtr & 0x7F) + 1;
+                size_t bytes = (*sPtr & 0x80) ? bpp : (j * bpp);
+                ++sPtr;
 
-                            *dPtr = *sPtr;
+                x += j;
+                if (x > width || bytes > size_t(endPtr - sPtr))
+                    return E_FAIL;
 
-                            if (convFlags & CONV_FLAGS_INVERTX)
-                                --dPtr;
-                            else
-                                ++dPtr;
-                        }
+                sPtr += bytes;
+            }
+        }
 
-                        ++sPtr;
-                    }
-                    else
-                    {
-                        // Literal
-                        size_t j = size_t(*sPtr & 0x7F) + 1;
-                        ++sPtr;
+        return S_OK;
+    }
 
-                        if (sPtr + j > endPtr)
-                            return E_FAIL;
 
-                        for (; j > 0; --j, ++x)
-                        {
-                            if (x >= image->width)
-                                return E_FAIL;
+    //-------------------------------------------------------------------------------------
+    // Decodes one validated scanline of 8-bit or 16-bit RLE packets; returns all the
+    // pixel values or'd together
+    //-------------------------------------------------------------------------------------
+    template<typename T>
+    T DecodeRLEScanline(
+        _In_ const uint8_t* sPtr,
+        _Out_writes_(width) T* dPtr,
+        size_t width,
+        bool invertX)
+    {
+        T accum = 0;
 
-                            *dPtr = *(sPtr++);
+        for (size_t x = 0; x < width; )
+        {
+            size_t j = size_t(*sPtr & 0x7F) + 1;
 
-                            if (convFlags & CONV_FLAGS_INVERTX)
-                                --dPtr;
-                            else
-                                ++dPtr;
-                        }
-                    }
+            if (*(sPtr++) & 0x80)
+            {
+                // Repeat
+                T t;
+                memcpy(&t, sPtr, sizeof(T));
+                sPtr += sizeof(T);
+                accum |= t;
+
+                if (invertX)
+                    std::fill_n(dPtr + (width - x - j), j, t);
+                else
+                    std::fill_n(dPtr + x, j, t);
+            }
+            else if (invertX)
+            {
+                // Literal
+                for (size_t k = 0; k < j; ++k)
+                {
+                    T t;
+                    memcpy(&t, sPtr, sizeof(T));
+                    sPtr += sizeof(T);
+                    accum |= t;
+                    dPtr[width - x - k - 1] = t;
                 }
             }
-            break;
-
-        //-------------------------------------------------------------------------- 16-bit
-        case DXGI_FORMAT_B5G5R5A1_UNORM:
-        {
-            bool nonzeroa = false;
-            for (size_t y = 0; y < image->height; ++y)
+            else
             {
-                size_t offset = ((convFlags & CONV_FLAGS_INVERTX) ? (image->width - 1) : 0);
-                assert(offset * 2 < rowPitch);
+                // Literal
+                memcpy(dPtr + x, sPtr, j * sizeof(T));
+                sPtr += j * sizeof(T);
 
-                auto dPtr = reinterpret_cast<uint16_t*>(image->pixels
-                    + (image->rowPitch * ((convFlags & CONV_FLAGS_INVERTY) ? y : (image->height - y - 1))))
-                    + offset;
+                for (size_t k = 0; k < j; ++k)
+                    accum |= dPtr[x + k];
+            }
 
-                for (size_t x = 0; x < image->width; )
-                {
-                    if (sPtr >= endPtr)
-                        return E_FAIL;
+            x += j;
+        }
 
-                    if (*sPtr & 0x80)
-                    {
-                        // Repeat
-                        size_t j = size_t(*sPtr & 0x7F) + 1;
-                        ++sPtr;
+        return accum;
+    }
 
-                        if (sPtr + 1 >= endPtr)
-                            return E_FAIL;
 
-                        auto t = static_cast<uint16_t>(unsigned(*sPtr) | (*(sPtr + 1u) << 8));
-                        if (t & 0x8000)
-                            nonzeroa = true;
-                        sPtr += 2;
+    //-------------------------------------------------------------------------------------
+    // Decodes one validated scanline of 24-bit or 32-bit RLE packets to RGBA; returns all
+    // the pixel values or'd together
+    //-------------------------------------------------------------------------------------
+    uint32_t DecodeRLEScanline32(
+        _In_ const uint8_t* sPtr,
+        _Out_writes_(width) uint32_t* dPtr,
+        size_t width,
+        bool invertX,
+        bool expand)
+    {
+        const size_t bpp = expand ? 3 : 4;
 
-                        for (; j > 0; --j, ++x)
-                        {
-                            if (x >= image->width)
-                                return E_FAIL;
+        uint32_t accum = 0;
 
-                            *dPtr = t;
+        for (size_t x = 0; x < width; )
+        {
+            size_t j = size_t(*sPtr & 0x7F) + 1;
 
-                            if (convFlags & CONV_FLAGS_INVERTX)
-                                --dPtr;
-                            else
-                                ++dPtr;
-                        }
-                    }
-                    else
-                    {
-                        // Literal
-                        size_t j = size_t(*sPtr & 0x7F) + 1;
-                        ++sPtr;
+            if (*(sPtr++) & 0x80)
+            {
+                // Repeat, BGR(A) -> RGBA
+                uint32_t t = (*sPtr << 16) | (*(sPtr + 1) << 8) | (*(sPtr + 2))
+                    | (expand ? 0xFF000000 : (uint32_t(*(sPtr + 3)) << 24));
+                sPtr += bpp;
+                accum |= t;
+
+                if (invertX)
+                    std::fill_n(dPtr + (width - x - j), j, t);
+                else
+                    std::fill_n(dPtr + x, j, t);
+            }
+            else
+            {
+                // Literal, BGR(A) -> RGBA
+                size_t k = 0;
 
-                        if (sPtr + (j * 2) > endPtr)
-                            return E_FAIL;
+#if defined(_XM_SSE_INTRINSICS_)
+                if (!expand && !invertX)
+                {
+                    const __m128i rbMask = _mm_set1_epi32(0x00FF00FF);
+                    const __m128i gaMask = _mm_set1_epi32(static_cast<int>(0xFF00FF00));
 
-                        for (; j > 0; --j, ++x)
-                        {
-                            if (x >= image->width)
-                                return E_FAIL;
-
-                            auto t = static_cast<uint16_t>(unsigned(*sPtr) | (*(sPtr + 1u) << 8));
-                            if (t & 0x8000)
-                                nonzeroa = true;
-                            sPtr += 2;
-                            *dPtr = t;
-
-                            if (convFlags & CONV_FLAGS_INVERTX)
-                                --dPtr;
-                            else
-                                ++dPtr;
-                        }
+                    __m128i vaccum = _mm_setzero_si128();
+                    for (; k + 4 <= j; k += 4)
+                    {
+                        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sPtr + k * 4));
+                        __m128i rb = _mm_and_si128(v, rbMask);
+                        v = _mm_or_si128(_mm_and_si128(v, gaMask), _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16)));
+                        vaccum = _mm_or_si128(vaccum, v);
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr + x + k), v);
                     }
+
+                    vaccum = _mm_or_si128(vaccum, _mm_srli_si128(vaccum, 8));
+                    vaccum = _mm_or_si128(vaccum, _mm_srli_si128(vaccum, 4));
+                    accum |= static_cast<uint32_t>(_mm_cvtsi128_si32(vaccum));
                 }
-            }
+#endif
 
-            // If there are no non-zero alpha channel entries, we'll assume alpha is not used and force it to opaque
-            if (!nonzeroa)
-            {
-                HRESULT hr = SetAlphaChannelToOpaque(image);
-                if (FAILED(hr))
-                    return hr;
-            }
-        }
-        break;
+                for (; k < j; ++k)
+                {
+                    const uint8_t* pPixel = sPtr + k * bpp;
+                    uint32_t t = (*pPixel << 16) | (*(pPixel + 1) << 8) | (*(pPixel + 2))
+                        | (expand ? 0xFF000000 : (uint32_t(*(pPixel + 3)) << 24));
+                    accum |= t;
 
-        //----------------------------------------------------------------------- 24/32-bit
-        case DXGI_FORMAT_R8G8B8A8_UNORM:
-        {
-            bool nonzeroa = false;
-            for (size_t y = 0; y < image->height; ++y)
-            {
-                size_t offset = ((convFlags & CONV_FLAGS_INVERTX) ? (image->width - 1) : 0);
+                    dPtr[invertX ? (width - x - k - 1) : (x + k)] = t;
+                }
 
-                auto dPtr = reinterpret_cast<uint32_t*>(image->pixels
-                    + (image->rowPitch * ((convFlags & CONV_FLAGS_INVERTY) ? y : (image->height - y - 1))))
-                    + offset;
+                sPtr += j * bpp;
+            }
 
-                for (size_t x = 0; x < image->width; )
-                {
-                    if (sPtr >= endPtr)
-                        return E_FAIL;
+            x += j;
+        }
 
-                    if (*sPtr & 0x80)
-                    {
-                        // Repeat
-                        size_t j = size_t(*sPtr & 0x7F) + 1;
-                        ++sPtr;
+        return accum;
+    }
 
-                        DWORD t;
-                        if (convFlags & CONV_FLAGS_EXPAND)
-                        {
-                            assert(offset * 3 < rowPitch);
 
-                            if (sPtr + 2 >= endPtr)
-                                return E_FAIL;
+    //-------------------------------------------------------------------------------------
+    // Uncompress pixel data from a TGA into the target image
+    //-------------------------------------------------------------------------------------
+    HRESULT UncompressPixels(
+        _In_reads_bytes_(size) const void* pSource,
+        size_t size,
+        _In_ const Image* image,
+        _In_ DWORD convFlags)
+    {
+        assert(pSource && size > 0);
 
-                            // BGR -> RGBA
-                            t = (*sPtr << 16) | (*(sPtr + 1) << 8) | (*(sPtr + 2)) | 0xFF000000;
-                            sPtr += 3;
+        if (!image || !image->pixels)
+            return E_POINTER;
 
-                            nonzeroa = true;
-                        }
-                        else
-                        {
-                            assert(offset * 4 < rowPitch);
+        size_t bpp;
+        switch (image->format)
+        {
+        case DXGI_FORMAT_R8_UNORM:          bpp = 1; break;
+        case DXGI_FORMAT_B5G5R5A1_UNORM:    bpp = 2; break;
+        case DXGI_FORMAT_R8G8B8A8_UNORM:    bpp = (convFlags & CONV_FLAGS_EXPAND) ? 3 : 4; break;
+        default:
+            return E_FAIL;
+        }
 
-                            if (sPtr + 3 >= endPtr)
-                                return E_FAIL;
+        // Sequential prepass over the packet headers to find the start of each scanline
+        std::unique_ptr<size_t[]> rowOffsets(new (std::nothrow) size_t[image->height]);
+        if (!rowOffsets)
+            return E_OUTOFMEMORY;
 
-                            // BGRA -> RGBA
-                            t = (*sPtr << 16) | (*(sPtr + 1) << 8) | (*(sPtr + 2)) | (*(sPtr + 3) << 24);
+        auto sPtr = static_cast<const uint8_t*>(pSource);
 
-                            if (*(sPtr + 3) > 0)
-                                nonzeroa = true;
+        HRESULT hr = ScanRLEPackets(sPtr, size, image->width, image->height, bpp, rowOffsets.get());
+        if (FAILED(hr))
+            return hr;
 
-                            sPtr += 4;
-                        }
+        // Decode the scanlines in parallel
+        const bool invertX = (convFlags & CONV_FLAGS_INVERTX) != 0;
+        const bool expand = (convFlags & CONV_FLAGS_EXPAND) != 0;
 
-                        for (; j > 0; --j, ++x)
-                        {
-                            if (x >= image->width)
-                                return E_FAIL;
+        uint32_t accum = 0;
 
-                            *dPtr = t;
+#ifdef _OPENMP
+#pragma omp parallel for reduction(|:accum) if (image->height >= c_TGAParallelRows && _UseParallel())
+#endif
+        for (int y = 0; y < static_cast<int>(image->height); ++y)
+        {
+            const uint8_t* pRow = sPtr + rowOffsets[size_t(y)];
 
-                            if (convFlags & CONV_FLAGS_INVERTX)
-                                --dPtr;
-                            else
-                                ++dPtr;
-                        }
-                    }
-                    else
-                    {
-                        // Literal
-                        size_t j = size_t(*sPtr & 0x7F) + 1;
-                        ++sPtr;
-
-                        if (convFlags & CONV_FLAGS_EXPAND)
-                        {
-                            if (sPtr + (j * 3) > endPtr)
-                                return E_FAIL;
-                        }
-                        else
-                        {
-                            if (sPtr + (j * 4) > endPtr)
-                                return E_FAIL;
-                        }
-
-                        for (; j > 0; --j, ++x)
-                        {
-                            if (x >= image->width)
-                                return E_FAIL;
-
-                            if (convFlags & CONV_FLAGS_EXPAND)
-                            {
-                                assert(offset * 3 < rowPitch);
-
-                                if (sPtr + 2 >= endPtr)
-                                    return E_FAIL;
-
-                                // BGR -> RGBA
-                                *dPtr = (*sPtr << 16) | (*(sPtr + 1) << 8) | (*(sPtr + 2)) | 0xFF000000;
-                                sPtr += 3;
-
-                                nonzeroa = true;
-                            }
-                            else
-                            {
-                                assert(offset * 4 < rowPitch);
-
-                                if (sPtr + 3 >= endPtr)
-                                    return E_FAIL;
-
-                                // BGRA -> RGBA
-                                *dPtr = (*sPtr << 16) | (*(sPtr + 1) << 8) | (*(sPtr + 2)) | (*(sPtr + 3) << 24);
-
-                                if (*(sPtr + 3) > 0)
-                                    nonzeroa = true;
-
-                                sPtr += 4;
-                            }
-
-                            if (convFlags & CONV_FLAGS_INVERTX)
-                                --dPtr;
-                            else
-                                ++dPtr;
-                        }
-                    }
-                }
-            }
+            uint8_t* pDest = image->pixels
+                + (image->rowPitch * ((convFlags & CONV_FLAGS_INVERTY) ? size_t(y) : (image->height - size_t(y) - 1)));
 
-            // If there are no non-zero alpha channel entries, we'll assume alpha is not used and force it to opaque
-            if (!nonzeroa)
+            switch (bpp)
             {
-                HRESULT hr = SetAlphaChannelToOpaque(image);
-                if (FAILED(hr))
-                    return hr;
+            case 1:
+                (void)DecodeRLEScanline<uint8_t>(pRow, pDest, image->width, invertX);
+                break;
+
+            case 2:
+                accum |= DecodeRLEScanline<uint16_t>(pRow, reinterpret_cast<uint16_t*>(pDest), image->width, invertX);
+                break;
+
+            default:
+                accum |= DecodeRLEScanline32(pRow, reinterpret_cast<uint32_t*>(pDest), image->width, invertX, expand);
+                break;
             }
         }
-        break;
 
-        //---------------------------------------------------------------------------------
-        default:
-            return E_FAIL;
+        // If there are no non-zero alpha channel entries, we'll assume alpha is not used and force it to opaque
+        const uint32_t alphaMask = (bpp == 2) ? 0x8000 : 0xFF000000;
+        if (bpp > 1 && !(accum & alphaMask))
+        {
+            hr = SetAlphaChannelToOpaque(image);
+            if (FAILED(hr))
+                return hr;
         }
 
         return S_OK;
@@ -842,6 +782,211 @@ namespace
             }
         }
     }
+
+
+    //-------------------------------------------------------------------------------------
+    // Flags the pixels of a TGA scanline that match their right neighbor: eq[x] is
+    // non-zero when pixel x equals pixel x + 1
+    //-------------------------------------------------------------------------------------
+    void FindEqualPixels(
+        _In_reads_bytes_(width * bpp) const uint8_t* pRow,
+        size_t width,
+        size_t bpp,
+        _Out_writes_(width) uint8_t* eq)
+    {
+        size_t x = 0;
+
+#if defined(_XM_SSE_INTRINSICS_)
+        switch (bpp)
+        {
+        case 1:
+            for (; x + 16 < width; x += 16)
+            {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow + x));
+                __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow + x + 1));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(eq + x), _mm_cmpeq_epi8(a, b));
+            }
+            break;
+
+        case 2:
+            for (; x + 8 < width; x += 8)
+            {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow + x * 2));
+                __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow + x * 2 + 2));
+                __m128i m = _mm_cmpeq_epi16(a, b);
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(eq + x), _mm_packs_epi16(m, m));
+            }
+            break;
+
+        case 4:
+            for (; x + 4 < width; x += 4)
+            {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow + x * 4));
+                __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow + x * 4 + 4));
+                __m128i m = _mm_cmpeq_epi32(a, b);
+                m = _mm_packs_epi32(m, m);
+                m = _mm_packs_epi16(m, m);
+                uint32_t t = static_cast<uint32_t>(_mm_cvtsi128_si32(m));
+                memcpy(eq + x, &t, sizeof(t));
+            }
+            break;
+
+        default:
+            break;
+        }
+#endif
+
+        for (; x + 1 < width; ++x)
+        {
+            eq[x] = (memcmp(pRow + x * bpp, pRow + (x + 1) * bpp, bpp) == 0) ? 0xFF : 0;
+        }
+
+        eq[width - 1] = 0;
+    }
+
+
+    //-------------------------------------------------------------------------------------
+    // RLE encodes one TGA scanline; returns the number of bytes written, which is at most
+    // width * bpp + (width + 127) / 128
+    //-------------------------------------------------------------------------------------
+    size_t EncodeRLEScanline(
+        _In_reads_bytes_(width * bpp) const uint8_t* pRow,
+        size_t width,
+        size_t bpp,
+        _In_reads_(width) const uint8_t* eq,
+        _Out_writes_bytes_(width * bpp + (width + 127) / 128) uint8_t* pDest)
+    {
+        // A repeat packet only saves space for a run of at least two pixels (three for 8-bit pixels)
+        const size_t minRun = (bpp == 1) ? 3 : 2;
+
+        auto startsRun = [&](size_t x) -> bool
+        {
+            return eq[x] && (minRun == 2 || (x + 1 < width && eq[x + 1]));
+        };
+
+        uint8_t* dPtr = pDest;
+
+        for (size_t x = 0; x < width; )
+        {
+            if (startsRun(x))
+            {
+                // Repeat
+                size_t j = 1;
+                while (j < 128 && eq[x + j - 1])
+                    ++j;
+
+                *(dPtr++) = static_cast<uint8_t>(0x80 | (j - 1));
+                memcpy(dPtr, pRow + x * bpp, bpp);
+                dPtr += bpp;
+                x += j;
+            }
+            else
+            {
+                // Literal
+                size_t j = 1;
+                while (j < 128 && (x + j) < width && !startsRun(x + j))
+                    ++j;
+
+                *(dPtr++) = static_cast<uint8_t>(j - 1);
+                memcpy(dPtr, pRow + x * bpp, j * bpp);
+                dPtr += j * bpp;
+                x += j;
+            }
+        }
+
+        return size_t(dPtr - pDest);
+    }
+
+
+    //-------------------------------------------------------------------------------------
+    // RLE encodes an image into a TGA blob, compressing the scanlines in parallel into
+    // worst-case sized slots and then packing them together
+    //-------------------------------------------------------------------------------------
+    HRESULT CompressPixels(
+        _In_ const Image& image,
+        _In_ const TGA_HEADER& header,
+        _In_ DWORD convFlags,
+        size_t rowPitch,
+        _Out_ Blob& blob)
+    {
+        if (!image.width || rowPitch < image.width)
+            return E_INVALIDARG;
+
+        const size_t bpp = rowPitch / image.width;
+        const size_t maxRow = rowPitch + (image.width + 127) / 128;
+
+        uint64_t maxSize = uint64_t(maxRow) * uint64_t(image.height);
+        if (maxSize > SIZE_MAX)
+            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+        std::unique_ptr<uint8_t[]> rows(new (std::nothrow) uint8_t[static_cast<size_t>(maxSize)]);
+        std::unique_ptr<size_t[]> rowSizes(new (std::nothrow) size_t[image.height]);
+        if (!rows || !rowSizes)
+            return E_OUTOFMEMORY;
+
+        bool outOfMemory = false;
+
+#ifdef _OPENMP
+#pragma omp parallel if (image.height >= c_TGAParallelRows && _UseParallel())
+#endif
+        {
+            std::unique_ptr<uint8_t[]> temp(new (std::nothrow) uint8_t[rowPitch + image.width]);
+            if (!temp)
+                outOfMemory = true;
+
+#ifdef _OPENMP
+#pragma omp for
+#endif
+            for (int y = 0; y < static_cast<int>(image.height); ++y)
+            {
+                if (!temp)
+                    continue;
+
+                const uint8_t* pPixels = image.pixels + size_t(y) * image.rowPitch;
+                uint8_t* pRow = temp.get();
+                uint8_t* eq = pRow + rowPitch;
+
+                if (convFlags & CONV_FLAGS_888)
+                {
+                    Copy24bppScanline(pRow, rowPitch, pPixels, image.rowPitch);
+                }
+                else if (convFlags & CONV_FLAGS_SWIZZLE)
+                {
+                    _SwizzleScanline(pRow, rowPitch, pPixels, image.rowPitch, image.format, TEXP_SCANLINE_NONE);
+                }
+                else
+                {
+                    _CopyScanline(pRow, rowPitch, pPixels, image.rowPitch, image.format, TEXP_SCANLINE_NONE);
+                }
+
+                FindEqualPixels(pRow, image.width, bpp, eq);
+                rowSizes[size_t(y)] = EncodeRLEScanline(pRow, image.width, bpp, eq, rows.get() + size_t(y) * maxRow);
+            }
+        }
+
+        if (outOfMemory)
+            return E_OUTOFMEMORY;
+
+        size_t total = sizeof(TGA_HEADER);
+        for (size_t y = 0; y < image.height; ++y)
+            total += rowSizes[y];
+
+        HRESULT hr = blob.Initialize(total);
+        if (FAILED(hr))
+            return hr;
+
+        auto dPtr = static_cast<uint8_t*>(blob.GetBufferPointer());
+        memcpy(dPtr, &header, sizeof(TGA_HEADER));
+        dPtr += sizeof(TGA_HEADER);
+
+        for (size_t y = 0; y < image.height; ++y)
+        {
+            memcpy(dPtr, rows.get() + y * maxRow, rowSizes[y]);
+            dPtr += rowSizes[y];
+        }
+
+        return S_OK;
+    }
 }
 
 
@@ -1248,6 +1393,12 @@ HRESULT DirectX::LoadFromTGAFile(
 //-------------------------------------------------------------------------------------
 _Use_decl_annotations_
 HRESULT DirectX::SaveToTGAMemory(const Image& image, Blob& blob)
+{
+    return SaveToTGAMemory(image, TGA_FLAGS_NONE, blob);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::SaveToTGAMemory(const Image& image, DWORD flags, Blob& blob)
 {
     if (!image.pixels)
         return E_POINTER;
@@ -1274,6 +1425,13 @@ HRESULT DirectX::SaveToTGAMemory(const Image& image, Blob& blob)
             return hr;
     }
 
+    if (flags & TGA_FLAGS_RLE)
+    {
+        tga_header.bImageType = (tga_header.bImageType == TGA_BLACK_AND_WHITE) ? TGA_BLACK_AND_WHITE_RLE : TGA_TRUECOLOR_RLE;
+
+        return CompressPixels(image, tga_header, convFlags, rowPitch, blob);
+    }
+
     hr = blob.Initialize(sizeof(TGA_HEADER) + slicePitch);
     if (FAILED(hr))
         return hr;
@@ -1316,6 +1474,12 @@ HRESULT DirectX::SaveToTGAMemory(const Image& image, Blob& blob)
 //-------------------------------------------------------------------------------------
 _Use_decl_annotations_
 HRESULT DirectX::SaveToTGAFile(const Image& image, const wchar_t* szFile)
+{
+    return SaveToTGAFile(image, TGA_FLAGS_NONE, szFile);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::SaveToTGAFile(const Image& image, DWORD flags, const wchar_t* szFile)
 {
     if (!szFile)
         return E_INVALIDARG;
@@ -1367,15 +1531,19 @@ HRESULT DirectX::SaveToTGAFile(const Image& image, const wchar_t* szFile)
             return hr;
     }
 
-    if (slicePitch < 65535)
+    if (slicePitch < 65535 || (flags & TGA_FLAGS_RLE))
     {
-        // For small images, it is better to create an in-memory file and write it out
+        // For small images, it is better to create an in-memory file and write it out; RLE data
+        // is always encoded in memory so its rows can be compressed in parallel
         Blob blob;
 
-        hr = SaveToTGAMemory(image, blob);
+        hr = SaveToTGAMemory(image, flags, blob);
         if (FAILED(hr))
             return hr;
 
+        if (blob.GetBufferSize() > UINT32_MAX)
+            return HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE);
+
         // Write blob
         const DWORD bytesToWrite = static_cast<DWORD>(blob.GetBufferSize());
         DWORD bytesWritten;
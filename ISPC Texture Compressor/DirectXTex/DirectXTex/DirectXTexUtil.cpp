@@ -11,6 +11,15 @@
 
 #include "DirectXTexp.h"
 
+#if defined(_XM_SSE_INTRINSICS_) && !defined(_XM_F16C_INTRINSICS_)
+#include <intrin.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#pragma warning(disable : 4616 6993)
+#endif
+
 #if defined(_XBOX_ONE) && defined(_TITLE)
 static_assert(XBOX_DXGI_FORMAT_R10G10B10_7E3_A2_FLOAT == DXGI_FORMAT_R10G10B10_7E3_A2_FLOAT, "Xbox One XDK mismatch detected");
 static_assert(XBOX_DXGI_FORMAT_R10G10B10_6E4_A2_FLOAT == DXGI_FORMAT_R10G10B10_6E4_A2_FLOAT, "Xbox One XDK mismatch detected");
@@ -264,6 +273,98 @@ REFGUID DirectX::GetWICCodec(WICCodecs codec)
 }
 
 
+//-------------------------------------------------------------------------------------
+// Multithreading opt-in
+//-------------------------------------------------------------------------------------
+namespace
+{
+    LONG g_ParallelProcessing = 0;
+}
+
+_Use_decl_annotations_
+bool DirectX::SetParallelProcessing(bool enable)
+{
+    return InterlockedExchange(&g_ParallelProcessing, (enable) ? 1 : 0) != 0;
+}
+
+bool DirectX::GetParallelProcessing()
+{
+    return InterlockedCompareExchange(&g_ParallelProcessing, 0, 0) != 0;
+}
+
+bool DirectX::_UseParallel()
+{
+#ifdef _OPENMP
+    return GetParallelProcessing() && !omp_in_parallel();
+#else
+    return false;
+#endif
+}
+
+
+//-------------------------------------------------------------------------------------
+// Working image padding
+//-------------------------------------------------------------------------------------
+namespace
+{
+    LONG g_PadCriticalStride = 1;
+}
+
+_Use_decl_annotations_
+bool DirectX::SetPadCriticalStride(bool enable)
+{
+    return InterlockedExchange(&g_PadCriticalStride, (enable) ? 1 : 0) != 0;
+}
+
+DWORD DirectX::_ScratchPitchFlags()
+{
+    return (InterlockedCompareExchange(&g_PadCriticalStride, 0, 0) != 0) ? CP_FLAGS_PAD_CRITICAL_STRIDE : CP_FLAGS_NONE;
+}
+
+_Use_decl_annotations_
+size_t DirectX::_ScanlineStride(size_t width)
+{
+    if (!(_ScratchPitchFlags() & CP_FLAGS_PAD_CRITICAL_STRIDE))
+        return width;
+
+    // Same rule as ComputePitch: whole cache lines (4 vectors), one more if that is a multiple of 512 bytes
+    size_t stride = (width + 3) & ~size_t(3);
+    if (!(stride & 31))
+        stride += 4;
+    return stride;
+}
+
+
+//-------------------------------------------------------------------------------------
+// CPU feature detection
+//-------------------------------------------------------------------------------------
+bool DirectX::IsF16CSupported()
+{
+#if defined(_XM_F16C_INTRINSICS_)
+    return true;
+#elif defined(_XM_SSE_INTRINSICS_)
+    static const bool s_hasF16C = []() -> bool
+    {
+        int info[4] = {};
+        __cpuid(info, 0);
+        if (info[0] < 1)
+            return false;
+
+        __cpuid(info, 1);
+
+        // F16C (bit 29) and AVX (bit 28) with OS support for saving YMM state (OSXSAVE, bit 27)
+        if ((info[2] & 0x38000000) != 0x38000000)
+            return false;
+
+        return (_xgetbv(0) & 0x6) == 0x6;
+    }();
+    return s_hasF16C;
+#else
+    return false;
+#endif
+}
+
+
 //-------------------------------------------------------------------------------------
 // Singleton function for WIC factory
 //-------------------------------------------------------------------------------------
@@ -1010,9 +1111,19 @@ HRESULT DirectX::ComputePitch(DXGI_FORMAT fmt, size_t width, size_t height,
             if (!bpp)
                 return E_INVALIDARG;
 
-            if (flags & (CP_FLAGS_LEGACY_DWORD | CP_FLAGS_PARAGRAPH | CP_FLAGS_YMM | CP_FLAGS_ZMM | CP_FLAGS_PAGE4K))
+            if (flags & (CP_FLAGS_LEGACY_DWORD | CP_FLAGS_PARAGRAPH | CP_FLAGS_YMM | CP_FLAGS_ZMM | CP_FLAGS_PAGE4K | CP_FLAGS_PAD_CRITICAL_STRIDE))
             {
-                if (flags & CP_FLAGS_PAGE4K)
+                if (flags & CP_FLAGS_PAD_CRITICAL_STRIDE)
+                {
+                    // Whole cache lines, plus one more whenever the pitch is a multiple of 512 bytes. Such
+                    // pitches map successive rows onto only a few L1 sets (a single set at 4K multiples),
+                    // which vertical filter passes would otherwise thrash; the extra line staggers them
+                    pitch = ((uint64_t(width) * bpp + 511u) / 512u) * 64u;
+                    if (!(pitch & 511u))
+                        pitch += 64u;
+                    slice = pitch * uint64_t(height);
+                }
+                else if (flags & CP_FLAGS_PAGE4K)
                 {
                     pitch = ((uint64_t(width) * bpp + 32767u) / 32768u) * 4096u;
                     slice = pitch * uint64_t(height);
@@ -1444,9 +1555,13 @@ Blob& Blob::operator= (Blob&& moveFrom) noexcept
 
         m_buffer = moveFrom.m_buffer;
         m_size = moveFrom.m_size;
+        m_allocSize = moveFrom.m_allocSize;
+        m_allocator = moveFrom.m_allocator;
 
         moveFrom.m_buffer = nullptr;
         moveFrom.m_size = 0;
+        moveFrom.m_allocSize = 0;
+        moveFrom.m_allocator = nullptr;
     }
     return *this;
 }
@@ -1455,11 +1570,13 @@ void Blob::Release()
 {
     if (m_buffer)
     {
-        _aligned_free(m_buffer);
+        m_allocator->Free(m_buffer, m_allocSize);
         m_buffer = nullptr;
     }
 
     m_size = 0;
+    m_allocSize = 0;
+    m_allocator = nullptr;
 }
 
 _Use_decl_annotations_
@@ -1470,14 +1587,15 @@ HRESULT Blob::Initialize(size_t size)
 
     Release();
 
-    m_buffer = _aligned_malloc(size, 16);
+    m_allocator = GetImageAllocator();
+    m_buffer = m_allocator->Allocate(size);
     if (!m_buffer)
     {
         Release();
         return E_OUTOFMEMORY;
     }
 
-    m_size = size;
+    m_size = m_allocSize = size;
 
     return S_OK;
 }
@@ -18,6 +18,8 @@ struct aligned_deleter { void operator()(void* p) { _aligned_free(p); } };
 
 typedef std::unique_ptr<float[], aligned_deleter> ScopedAlignedArrayFloat;
 
+typedef std::unique_ptr<uint8_t[], aligned_deleter> ScopedAlignedArrayUint8;
+
 typedef std::unique_ptr<DirectX::XMVECTOR[], aligned_deleter> ScopedAlignedArrayXMVECTOR;
 
 //---------------------------------------------------------------------------------
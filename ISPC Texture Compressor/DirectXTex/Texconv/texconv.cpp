@@ -104,6 +104,7 @@ enum OPTIONS
     OPT_FILELIST,
     OPT_ROTATE_COLOR,
     OPT_PAPER_WHITE_NITS,
+    OPT_NO_PAD,
     OPT_MAX
 };
 
@@ -189,6 +190,7 @@ const SValue g_pOptions[] =
     { L"flist",         OPT_FILELIST },
     { L"rotatecolor",   OPT_ROTATE_COLOR },
     { L"nits",          OPT_PAPER_WHITE_NITS },
+    { L"nopad",         OPT_NO_PAD },
     { nullptr,          0 }
 };
 
@@ -728,9 +730,10 @@ namespace
         wprintf(L"\n                       (DDS output only)\n");
         wprintf(L"   -dx10               Force use of 'DX10' extended header\n");
         wprintf(L"\n   -nologo             suppress copyright message\n");
-        wprintf(L"   -timing             Display elapsed processing time\n\n");
+        wprintf(L"   -timing             Display elapsed processing time\n");
+        wprintf(L"   -nopad              Do not pad the rows of internal working images (compare with -timing)\n\n");
 #ifdef _OPENMP
-        wprintf(L"   -singleproc         Do not use multi-threaded compression\n");
+        wprintf(L"   -singleproc         Do not use multi-threading for compression or processing\n");
 #endif
         wprintf(L"   -gpu <adapter>      Select GPU for DirectCompute-based codecs (0 is default)\n");
         wprintf(L"   -nogpu              Do not use DirectCompute-based codecs\n");
@@ -1610,6 +1613,19 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
     if (~dwOptions & (DWORD64(1) << OPT_NOLOGO))
         PrintLogo();
 
+#ifdef _OPENMP
+    // Lets resizing, mipmap generation, and file loading use multiple threads as well
+    if (!(dwOptions & (DWORD64(1) << OPT_FORCE_SINGLEPROC)))
+    {
+        SetParallelProcessing(true);
+    }
+#endif
+
+    if (dwOptions & (DWORD64(1) << OPT_NO_PAD))
+    {
+        SetPadCriticalStride(false);
+    }
+
     // Work out out filename prefix and suffix
     if (szOutputDir[0] && (L'\\' != szOutputDir[wcslen(szOutputDir) - 1]))
         wcscat_s(szOutputDir, MAX_PATH, L"\\");
@@ -2491,9 +2507,11 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             }
         }
 
-        if ((!tMips || info.mipLevels != tMips) && (info.mipLevels != 1))
+        const bool genMips = (tMips != 1) && (info.width > 1 || info.height > 1 || info.depth > 1);
+
+        if ((!tMips || info.mipLevels != tMips) && (info.mipLevels != 1) && !genMips)
         {
-            // Mips generation only works on a single base image, so strip off existing mip levels
+            // Strip off the existing mip levels (when regenerating them, the top level is viewed in place instead)
             std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
             if (!timage)
             {
@@ -2581,7 +2599,7 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             }
         }
 
-        if ((!tMips || info.mipLevels != tMips) && (info.width > 1 || info.height > 1 || info.depth > 1))
+        if ((!tMips || info.mipLevels != tMips) && genMips)
         {
             std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
             if (!timage)
@@ -2590,13 +2608,22 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 return 1;
             }
 
+            // Mips generation only works on a single base image, so view just the top level of any existing chain
+            ScratchImageView baseView;
+            hr = baseView.Initialize(*image, 0, 1);
+            if (FAILED(hr))
+            {
+                wprintf(L" FAILED [mipmaps] (%x)\n", hr);
+                return 1;
+            }
+
             if (info.dimension == TEX_DIMENSION_TEXTURE3D)
             {
-                hr = GenerateMipMaps3D(image->GetImages(), image->GetImageCount(), image->GetMetadata(), dwFilter3D | dwFilterOpts, tMips, *timage);
+                hr = GenerateMipMaps3D(baseView, dwFilter3D | dwFilterOpts, tMips, *timage);
             }
             else
             {
-                hr = GenerateMipMaps(image->GetImages(), image->GetImageCount(), image->GetMetadata(), dwFilter | dwFilterOpts, tMips, *timage);
+                hr = GenerateMipMaps(baseView, dwFilter | dwFilterOpts, tMips, *timage);
             }
             if (FAILED(hr))
             {
@@ -2620,14 +2647,34 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
         }
 
         // --- Premultiplied alpha (if requested) --------------------------------------
+        DWORD dwPipeline = TEX_PIPELINE_DEFAULT;
         if ((dwOptions & (DWORD64(1) << OPT_PREMUL_ALPHA))
             && HasAlpha(info.format)
             && info.format != DXGI_FORMAT_A8_UNORM)
         {
+            bool gpucodec = false;
+            switch (tformat)
+            {
+            case DXGI_FORMAT_BC6H_TYPELESS:
+            case DXGI_FORMAT_BC6H_UF16:
+            case DXGI_FORMAT_BC6H_SF16:
+            case DXGI_FORMAT_BC7_TYPELESS:
+            case DXGI_FORMAT_BC7_UNORM:
+            case DXGI_FORMAT_BC7_UNORM_SRGB:
+                gpucodec = !(dwOptions & (DWORD64(1) << OPT_NOGPU));
+                break;
+            }
+
             if (info.IsPMAlpha())
             {
                 printf("\nWARNING: Image is already using premultiplied alpha\n");
             }
+            else if (IsCompressed(tformat) && (FileType == CODEC_DDS) && !gpucodec)
+            {
+                // Premultiply as part of the CPU compression pass instead of creating another full copy
+                dwPipeline |= TEX_PIPELINE_PMALPHA;
+                cimage.reset();
+            }
             else
             {
                 auto img = image->GetImage(0, 0, 0);
@@ -2752,6 +2799,10 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 {
                     hr = Compress(pDevice.Get(), img, nimg, info, tformat, dwCompress | dwSRGB, alphaWeight, *timage);
                 }
+                else if (dwPipeline)
+                {
+                    hr = CompressPipeline(img, nimg, info, dwPipeline, nullptr, tformat, cflags | dwSRGB, TEX_THRESHOLD_DEFAULT, *timage);
+                }
                 else
                 {
                     hr = Compress(img, nimg, info, tformat, cflags | dwSRGB, TEX_THRESHOLD_DEFAULT, *timage);
@@ -2765,6 +2816,7 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 auto& tinfo = timage->GetMetadata();
 
                 info.format = tinfo.format;
+                info.miscFlags2 = tinfo.miscFlags2;
                 assert(info.width == tinfo.width);
                 assert(info.height == tinfo.height);
                 assert(info.depth == tinfo.depth);